@@ -0,0 +1,214 @@
+#include "assets.hpp"
+
+#include "http/common/http_detector.hpp"
+#include "http/common/http_encoding.hpp"
+#include "utils/backport/string.hpp"
+#include "utils/fileops/filesystem.hpp"
+#include "utils/logger/logger.hpp"
+
+#ifdef WFX_HAS_ZLIB
+    #include <zlib.h>
+#endif
+
+#ifdef WFX_HAS_BROTLI
+    #include <brotli/encode.h>
+#endif
+
+#include <vector>
+
+namespace WFX::CLI {
+
+using namespace WFX::Utils; // For 'Logger', 'FileSystem', ...
+using namespace WFX::Http;  // For 'MimeDetector'
+
+// vvv Internal Helpers vvv
+namespace {
+
+// Anything smaller barely fits in a packet anyways, headers would eat what we save
+constexpr std::uint64_t MIN_ASSET_SIZE = 256;
+
+// Nobody is shipping 64MB of js, and whole file is read into memory
+constexpr std::uint64_t MAX_ASSET_SIZE = 64 * 1024 * 1024;
+
+// Sidecar has to save at least ~5%, otherwise plain file is just as good
+constexpr double MAX_RATIO = 0.95;
+
+using ByteBuffer = std::vector<unsigned char>;
+
+bool IsCompressible(std::string_view path)
+{
+    // Already compressed sidecars / archives
+    if(EndsWith(path, ".br") || EndsWith(path, ".gz"))
+        return false;
+
+    return HttpEncoding::IsCompressibleMime(MimeDetector::DetectMimeFromExt(path));
+}
+
+bool ReadWholeFile(const std::string& path, std::uint64_t size, ByteBuffer& out)
+{
+    auto inFile = FileSystem::OpenFileRead(path.c_str(), true);
+    if(!inFile)
+        return false;
+
+    out.resize(size);
+
+    std::uint64_t done = 0;
+    while(done < size) {
+        std::int64_t got = inFile->Read(out.data() + done, static_cast<std::size_t>(size - done));
+        if(got <= 0)
+            return false;
+        done += static_cast<std::uint64_t>(got);
+    }
+    return true;
+}
+
+// Writes to a temporary file first, so engine never sees a half written sidecar
+bool WriteSidecar(const std::string& path, const ByteBuffer& data)
+{
+    std::string tmpPath = path + ".tmp";
+
+    auto outFile = FileSystem::OpenFileWrite(tmpPath.c_str(), true);
+    if(!outFile)
+        return false;
+
+    if(outFile->Write(data.data(), data.size()) != static_cast<std::int64_t>(data.size())) {
+        outFile->Close();
+        FileSystem::DeleteFile(tmpPath.c_str());
+        return false;
+    }
+    outFile->Close();
+
+    return FileSystem::RenameFile(tmpPath.c_str(), path.c_str());
+}
+
+#ifdef WFX_HAS_ZLIB
+bool CompressGzip(const ByteBuffer& in, ByteBuffer& out)
+{
+    z_stream stream{};
+
+    // 15 + 16 -> max window with gzip header / trailer instead of raw zlib one
+    if(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    out.resize(deflateBound(&stream, static_cast<uLong>(in.size())) + 32);
+
+    stream.next_in   = const_cast<Bytef*>(in.data());
+    stream.avail_in  = static_cast<uInt>(in.size());
+    stream.next_out  = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return result == Z_STREAM_END;
+}
+#endif
+
+#ifdef WFX_HAS_BROTLI
+bool CompressBrotli(const ByteBuffer& in, ByteBuffer& out, bool isText)
+{
+    std::size_t outSize = BrotliEncoderMaxCompressedSize(in.size());
+    if(outSize == 0)
+        return false;
+
+    out.resize(outSize);
+
+    if(!BrotliEncoderCompress(
+        BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW,
+        isText ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC,
+        in.size(), in.data(), &outSize, out.data()
+    ))
+        return false;
+
+    out.resize(outSize);
+    return true;
+}
+#endif
+
+// Sidecar which is newer than its file was built from the same content already
+bool IsUpToDate(const std::string& sidecarPath, const FileStats& source)
+{
+    FileStats stats;
+    return FileSystem::GetFileStats(sidecarPath.c_str(), stats)
+        && stats.type == FileType::REG
+        && stats.modifiedNs >= source.modifiedNs;
+}
+
+// Keeps sidecar only if it actually saves something, stale one is removed either way so-
+// -engine doesn't end up serving old content for a file which stopped compressing well
+bool StoreSidecar(const std::string& sidecarPath, const ByteBuffer& data, std::uint64_t sourceSize)
+{
+    if(data.size() > static_cast<std::uint64_t>(sourceSize * MAX_RATIO)) {
+        FileSystem::DeleteFile(sidecarPath.c_str());
+        return true;
+    }
+
+    return WriteSidecar(sidecarPath, data);
+}
+
+} // namespace
+
+// vvv Main Functions vvv
+std::size_t PrecompressAssets(const std::string& dir)
+{
+    auto& logger = Logger::GetInstance();
+
+#if !defined(WFX_HAS_ZLIB) && !defined(WFX_HAS_BROTLI)
+    logger.Warn("[WFX]: Built without zlib and brotli, no sidecars can be generated for '", dir, '\'');
+    return 0;
+#else
+    std::size_t written = 0;
+    std::size_t failed  = 0;
+    ByteBuffer  source;
+    ByteBuffer  compressed;
+
+    FileSystem::ListDirectory(dir, true, [&](std::string path) {
+        FileStats stats;
+        if(!FileSystem::GetFileStats(path.c_str(), stats) || stats.type != FileType::REG)
+            return;
+
+        if(stats.size < MIN_ASSET_SIZE || stats.size > MAX_ASSET_SIZE || !IsCompressible(path))
+            return;
+
+        bool        loaded = false;
+        std::string mime{MimeDetector::DetectMimeFromExt(path)};
+
+        // Only read the file if at least one of its sidecars is out of date
+        auto loadSource = [&]() {
+            if(!loaded)
+                loaded = ReadWholeFile(path, stats.size, source);
+            return loaded;
+        };
+
+    #ifdef WFX_HAS_BROTLI
+        if(std::string brPath = path + ".br"; !IsUpToDate(brPath, stats)) {
+            if(loadSource() && CompressBrotli(source, compressed, mime.starts_with("text/"))
+                && StoreSidecar(brPath, compressed, stats.size))
+                written++;
+            else {
+                logger.Error("[WFX]: Failed to generate brotli sidecar for '", path, '\'');
+                failed++;
+            }
+        }
+    #endif
+
+    #ifdef WFX_HAS_ZLIB
+        if(std::string gzPath = path + ".gz"; !IsUpToDate(gzPath, stats)) {
+            if(loadSource() && CompressGzip(source, compressed)
+                && StoreSidecar(gzPath, compressed, stats.size))
+                written++;
+            else {
+                logger.Error("[WFX]: Failed to generate gzip sidecar for '", path, '\'');
+                failed++;
+            }
+        }
+    #endif
+    });
+
+    logger.Info("[WFX]: Precompressed assets in '", dir, "', ", written, " sidecar(s) updated");
+    return failed;
+#endif
+}
+
+}  // namespace WFX::CLI
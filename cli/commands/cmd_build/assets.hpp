@@ -0,0 +1,15 @@
+#ifndef WFX_CLI_COMMANDS_ASSETS_HPP
+#define WFX_CLI_COMMANDS_ASSETS_HPP
+
+#include <string>
+
+namespace WFX::CLI {
+
+// Writes '.br' / '.gz' sidecars next to every compressible file under 'dir' (recursively)
+// Engine picks them up at runtime based on 'Accept-Encoding', no per request compression
+// Returns number of files which failed to compress
+std::size_t PrecompressAssets(const std::string& dir);
+
+}  // namespace WFX::CLI
+
+#endif  // WFX_CLI_COMMANDS_ASSETS_HPP
@@ -1,4 +1,5 @@
 #include "build.hpp"
+#include "assets.hpp"
 
 #include "cli/commands/common/common.hpp"
 #include "config/config.hpp"
@@ -42,9 +43,17 @@ int BuildProject(const std::string& project, const std::string& buildType, bool
         return 0;
     }
 
+    // '.br' / '.gz' sidecars for '/public/' and static templates, so run templates first
+    if(buildType == "assets") {
+        std::size_t failed = PrecompressAssets(config.projectConfig.publicDir)
+                           + PrecompressAssets(TemplateEngine::GetInstance().GetStaticOutputDir());
+
+        return failed > 0 ? 1 : 0;
+    }
+
     // Invalid type
     logger.Fatal(
-        "[WFX]: Wrong build type provided: ", buildType.c_str(), ". Supported types: 'templates', 'source'"
+        "[WFX]: Wrong build type provided: ", buildType.c_str(), ". Supported types: 'templates', 'source', 'assets'"
     );
 
     // Not that this will ever get triggered but yeah
@@ -175,10 +175,12 @@ preferred_generator = "Unix Makefiles" # Exact CMake generator used to configure
 send_buffer_max              = 2048    # Max total send buffer size per connection (in bytes)
 recv_buffer_max              = 16384   # Max total recv buffer size per connection (in bytes)
 recv_buffer_incr             = 4096    # Buffer growth step (in bytes)
+zero_copy_threshold          = 0       # Min send size for zero copy transmit, 0 disables it (in bytes, Linux only)
 header_reserve_hint          = 512     # Initial header allocation hint size (in bytes)
 max_header_size              = 8192    # Max total size of all headers (in bytes)
 max_header_count             = 64      # Max number of headers allowed
 max_body_size                = 8192    # Max size of request body (in bytes)
+max_stream_body_size         = 67108864 # Max size of request body for streaming routes (in bytes)
 header_timeout               = 15      # Max time limit for entire header to arrive (in seconds)
 body_timeout                 = 20      # Max time limit for entire body to arrive (in seconds)
 idle_timeout                 = 40      # Max time limit for a connection to stay idle (in seconds)
@@ -214,18 +216,25 @@ worker_processes = 2      # Max simultaneous worker connections
 backlog          = 1024   # Max pending connections in OS listen queue
 
 [Linux.IoUring]
-accept_slots     = 64     # Max simultaneous connections being accepted
-queue_depth      = 4096   # Internal connection queue depth
-batch_size       = 64     # How many connections to process per iteration
-file_chunk_size  = 65536  # How big of a file chunk to send at once
+queue_depth       = 4096   # Internal connection queue depth
+batch_size        = 64     # How many connections to process per iteration
+file_chunk_size   = 65536  # How big of a file chunk to send at once
+recv_buffer_count = 1024   # Shared receive buffers (power of 2)
+recv_buffer_size  = 4096   # Size of each shared receive buffer (in bytes)
 
 [Linux.Epoll]
 max_events       = 1024   # How many events should epoll handle at a time
 
 [Misc]
-file_cache_size     = 20     # Number of files cached for efficiency (LFU)
-template_chunk_size = 16384  # Max chunk size to read / write at once when compiling templates (in bytes)
-cache_chunk_size    = 2048   # Max chunk size to read / write from template cache file (in bytes)
+file_cache_size       = 20      # Number of files cached for efficiency (LFU)
+template_chunk_size   = 16384   # Max chunk size to read / write at once when compiling templates (in bytes)
+cache_chunk_size      = 2048    # Max chunk size to read / write from template cache file (in bytes)
+static_cache_size     = 8388608 # Memory for small '/public/' files served without touching disk, 0 disables it (in bytes)
+static_cache_max_file = 65536   # Only files up to this size are kept in memory (in bytes)
+body_spill_dir        = "/tmp"  # Directory where streamed request bodies get spilled to
+
+stream_compression_level    = 6    # gzip / zstd level for streamed responses (1 - 9), 0 disables it
+stream_compression_min_size = 1024 # Streamed responses smaller than this are sent uncompressed (in bytes)
 )");
 
     // 3. Bridge between engine and user code
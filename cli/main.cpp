@@ -40,7 +40,7 @@ int WFXEntryPoint(int argc, char* argv[]) {
            const std::vector<std::string>& positionalArgs) -> int {
             if(positionalArgs.size() != 2)
                 Logger::GetInstance().Fatal(
-                    "[WFX]: Build type is required. Usage: wfx build <project-folder-name> [templates|source]"
+                    "[WFX]: Build type is required. Usage: wfx build <project-folder-name> [templates|source|assets]"
                 );
 
             return CLI::BuildProject(positionalArgs[0], positionalArgs[1], options.count("--debug") > 0);
@@ -0,0 +1,65 @@
+# -------------------------------
+# Compression libraries (optional)
+# -------------------------------
+# zlib   : '.gz' sidecars built by 'wfx build <project> assets', gzip / deflate for streams
+# brotli : '.br' sidecars built by 'wfx build <project> assets'
+# zstd   : zstd for streams
+# Engine itself never compresses static files, it only picks whichever sidecar client accepts
+# Chunked streams (dynamic templates, 'Stream()') are compressed on the fly as they go out
+# All are optional, missing ones just mean that encoding is never produced
+
+option(WFX_USE_ZLIB   "Use zlib if found (gzip sidecars)"     ON)
+option(WFX_USE_BROTLI "Use brotli if found (brotli sidecars)" ON)
+option(WFX_USE_ZSTD   "Use zstd if found (zstd streams)"      ON)
+
+# ---------------- zlib ----------------
+if(WFX_USE_ZLIB)
+    find_package(ZLIB QUIET)
+
+    if(ZLIB_FOUND)
+        target_compile_definitions(wfx PRIVATE WFX_HAS_ZLIB)
+        target_link_libraries(wfx PRIVATE ZLIB::ZLIB)
+        set(WFX_ZLIB_STATUS "ON")
+    else()
+        message(WARNING "zlib not found, gzip sidecars / streams won't be generated")
+        set(WFX_ZLIB_STATUS "OFF (not found)")
+    endif()
+else()
+    set(WFX_ZLIB_STATUS "OFF")
+endif()
+
+# ---------------- brotli ----------------
+if(WFX_USE_BROTLI)
+    find_path(BROTLI_INCLUDE_DIR brotli/encode.h)
+    find_library(BROTLI_ENC_LIBRARY NAMES brotlienc)
+
+    if(BROTLI_INCLUDE_DIR AND BROTLI_ENC_LIBRARY)
+        target_include_directories(wfx PRIVATE ${BROTLI_INCLUDE_DIR})
+        target_compile_definitions(wfx PRIVATE WFX_HAS_BROTLI)
+        target_link_libraries(wfx PRIVATE ${BROTLI_ENC_LIBRARY})
+        set(WFX_BROTLI_STATUS "ON")
+    else()
+        message(WARNING "brotli (libbrotlienc) not found, brotli sidecars won't be generated")
+        set(WFX_BROTLI_STATUS "OFF (not found)")
+    endif()
+else()
+    set(WFX_BROTLI_STATUS "OFF")
+endif()
+
+# ---------------- zstd ----------------
+if(WFX_USE_ZSTD)
+    find_path(ZSTD_INCLUDE_DIR zstd.h)
+    find_library(ZSTD_LIBRARY NAMES zstd)
+
+    if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+        target_include_directories(wfx PRIVATE ${ZSTD_INCLUDE_DIR})
+        target_compile_definitions(wfx PRIVATE WFX_HAS_ZSTD)
+        target_link_libraries(wfx PRIVATE ${ZSTD_LIBRARY})
+        set(WFX_ZSTD_STATUS "ON")
+    else()
+        message(STATUS "zstd not found, streams will only be compressed with gzip / deflate")
+        set(WFX_ZSTD_STATUS "OFF (not found)")
+    endif()
+else()
+    set(WFX_ZSTD_STATUS "OFF")
+endif()
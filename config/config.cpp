@@ -51,9 +51,11 @@ void Config::LoadCoreSettings(std::string_view path)
         ExtractValue(tbl, "Network", "send_buffer_max",             networkConfig.maxSendBufferSize);
         ExtractValue(tbl, "Network", "recv_buffer_max",             networkConfig.maxRecvBufferSize);
         ExtractValue(tbl, "Network", "recv_buffer_incr",            networkConfig.bufferIncrSize);
+        ExtractValue(tbl, "Network", "zero_copy_threshold",         networkConfig.zeroCopyThreshold);
         ExtractValue(tbl, "Network", "header_reserve_hint",         networkConfig.headerReserveHintSize);
         ExtractValue(tbl, "Network", "max_header_size",             networkConfig.maxHeaderTotalSize);
         ExtractValue(tbl, "Network", "max_body_size",               networkConfig.maxBodyTotalSize);
+        ExtractValue(tbl, "Network", "max_stream_body_size",        networkConfig.maxStreamBodySize);
         ExtractValue(tbl, "Network", "max_header_count",            networkConfig.maxHeaderTotalCount);
         ExtractValue(tbl, "Network", "header_timeout",              networkConfig.headerTimeout);
         ExtractValue(tbl, "Network", "body_timeout",                networkConfig.bodyTimeout);
@@ -90,19 +92,25 @@ void Config::LoadCoreSettings(std::string_view path)
         ExtractValue(tbl, "Linux", "backlog",          osSpecificConfig.backlog);
         
         #ifdef WFX_LINUX_USE_IO_URING
-            ExtractValue(tbl, "Linux.IoUring", "accept_slots",    osSpecificConfig.acceptSlots);
-            ExtractValue(tbl, "Linux.IoUring", "queue_depth",     osSpecificConfig.queueDepth);
-            ExtractValue(tbl, "Linux.IoUring", "batch_size",      osSpecificConfig.batchSize);
-            ExtractValue(tbl, "Linux.IoUring", "file_chunk_size", osSpecificConfig.fileChunkSize);
+            ExtractValue(tbl, "Linux.IoUring", "queue_depth",       osSpecificConfig.queueDepth);
+            ExtractValue(tbl, "Linux.IoUring", "batch_size",        osSpecificConfig.batchSize);
+            ExtractValue(tbl, "Linux.IoUring", "file_chunk_size",   osSpecificConfig.fileChunkSize);
+            ExtractValue(tbl, "Linux.IoUring", "recv_buffer_count", osSpecificConfig.recvBufferCount);
+            ExtractValue(tbl, "Linux.IoUring", "recv_buffer_size",  osSpecificConfig.recvBufferSize);
         #else
             ExtractValue(tbl, "Linux.Epoll", "max_events", osSpecificConfig.maxEvents);
         #endif // WFX_LINUX_USE_IO_URING
     #endif // _WIN32
 
         // vvv Misc vvv
-        ExtractValue(tbl, "Misc", "file_cache_size",      miscConfig.fileCacheSize);
-        ExtractValue(tbl, "Misc", "cache_chunk_size",     miscConfig.cacheChunkSize);
-        ExtractValue(tbl, "Misc", "template_chunk_size",  miscConfig.templateChunkSize);
+        ExtractValue(tbl, "Misc", "file_cache_size",             miscConfig.fileCacheSize);
+        ExtractValue(tbl, "Misc", "cache_chunk_size",            miscConfig.cacheChunkSize);
+        ExtractValue(tbl, "Misc", "template_chunk_size",         miscConfig.templateChunkSize);
+        ExtractValue(tbl, "Misc", "static_cache_size",           miscConfig.staticCacheSize);
+        ExtractValue(tbl, "Misc", "static_cache_max_file",       miscConfig.staticCacheMaxFile);
+        ExtractValue(tbl, "Misc", "stream_compression_level",    miscConfig.streamCompressLevel);
+        ExtractValue(tbl, "Misc", "stream_compression_min_size", miscConfig.streamCompressMinSize);
+        ExtractValue(tbl, "Misc", "body_spill_dir",              miscConfig.bodySpillDir);
     }
     catch(const toml::parse_error& err) {
         logger.Fatal("[Config]: File -> 'wfx.toml', Error -> ", err.what());
@@ -26,9 +26,11 @@ struct NetworkConfig {
     std::uint32_t maxSendBufferSize  = 2 * 1024;
     std::uint32_t maxRecvBufferSize  = 16 * 1024;
     std::uint32_t bufferIncrSize     = 4 * 1024;
+    std::uint32_t zeroCopyThreshold  = 0; // 0 = Disabled, otherwise min send size (in bytes) for zero copy
 
     std::uint32_t maxHeaderTotalSize    = 8 * 1024;
     std::uint32_t maxBodyTotalSize      = 8 * 1024;
+    std::uint64_t maxStreamBodySize     = 64 * 1024 * 1024; // Only for routes which stream their body
     std::uint16_t maxHeaderTotalCount   = 64;
     std::uint16_t headerReserveHintSize = 512;
 
@@ -78,7 +80,8 @@ struct OSSpecificConfig {
     
     #ifdef WFX_LINUX_USE_IO_URING
         std::uint16_t batchSize       = 64;
-        std::uint16_t acceptSlots     = 64;
+        std::uint16_t recvBufferCount = 1024;     // Provided buffer ring entries, must be a power of 2
+        std::uint32_t recvBufferSize  = 4 * 1024; // Size of each provided buffer
         std::uint32_t queueDepth      = 4096;
         std::uint32_t fileChunkSize   = 64 * 1024;
     #else
@@ -88,9 +91,14 @@ struct OSSpecificConfig {
 };
 
 struct MiscConfig {
-    std::uint16_t fileCacheSize     = 20;
-    std::uint16_t cacheChunkSize    = 2 * 1024;
-    std::uint32_t templateChunkSize = 16 * 1024;
+    std::uint16_t fileCacheSize         = 20;
+    std::uint16_t cacheChunkSize        = 2 * 1024;
+    std::uint32_t templateChunkSize     = 16 * 1024;
+    std::uint32_t staticCacheSize       = 8 * 1024 * 1024; // Byte budget for small '/public/' files kept in memory
+    std::uint32_t staticCacheMaxFile    = 64 * 1024;       // Anything bigger always goes through sendfile
+    std::uint16_t streamCompressLevel   = 6;               // On the fly compression of chunked streams, 0 disables it
+    std::uint32_t streamCompressMinSize = 1024;            // Streams ending before this many bytes go out as is
+    std::string   bodySpillDir          = "/tmp";          // Where streamed bodies get spilled to (if asked)
 };
 
 // Main Config loader
@@ -1,11 +1,16 @@
 #include "core_engine.hpp"
+#include "template_engine.hpp"
 
 #include "http/response.hpp"
+#include "http/common/http_encoding.hpp"
 #include "http/common/http_error_msgs.hpp"
+#include "http/common/http_validators.hpp"
 #include "http/formatters/parser/http_parser.hpp"
 #include "http/formatters/serializer/http_serializer.hpp"
+#include "http/request/http_body_reader.hpp"
 #include "shared/apis/master_api.hpp"
 #include "utils/backport/string.hpp"
+#include "utils/fileops/filecache.hpp"
 #include "utils/fileops/filesystem.hpp"
 #include "utils/process/process.hpp"
 
@@ -38,8 +43,21 @@ CoreEngine::CoreEngine(const char* dllPath, bool useHttps)
     // Load user's DLL file which we compiled / is cached
     HandleUserDLLInjection(dllPath);
 
+    // Every route is in by now, compile them into their lookup form
+    router_.Freeze();
+
     // Now that user code is available to us, load middleware in proper order
     HandleMiddlewareLoading();
+
+    // Small '/public/' files get served straight out of memory
+    staticCache_.Init(config_.miscConfig.staticCacheSize, config_.miscConfig.staticCacheMaxFile);
+
+    // Deploys / template rebuilds replace files under these, cached fds (and in memory copies)-
+    // -of them are dropped right away instead of serving old content till they get evicted
+    auto& fileCache = FileCache::GetInstance();
+    fileCache.SetInvalidationListener([this](std::string_view path) { staticCache_.Invalidate(path); });
+    fileCache.Watch(config_.projectConfig.publicDir);
+    fileCache.Watch(TemplateEngine::GetInstance().GetStaticOutputDir());
 }
 
 void CoreEngine::Listen(const std::string& host, int port)
@@ -67,6 +85,31 @@ void CoreEngine::Stop()
 // vvv Internal Functions vvv
 void CoreEngine::HandleRequest(ConnectionContext* ctx)
 {
+    // Pipelined requests already sitting in read buffer get answered one after the other right-
+    // -here, 'ContinuePipeline' only asks for it so the stack doesn't grow with each of them
+    ConnectionContext* prevCtx   = pipelineCtx_;
+    std::uint32_t      prevBatch = pipelineBatch_;
+
+    pipelineCtx_   = ctx;
+    pipelineBatch_ = 0;
+
+    do {
+        pipelineNext_ = false;
+        ProcessRequest(ctx);
+    } while(pipelineNext_);
+
+    pipelineCtx_   = prevCtx;
+    pipelineBatch_ = prevBatch;
+}
+
+void CoreEngine::ProcessRequest(ConnectionContext* ctx)
+{
+    // Handler is suspended waiting on its streamed body, whatever came in is for it and not the parser
+    if(ctx->isBodyWait) {
+        HandleBodyData(ctx);
+        return;
+    }
+
     // This will be transmitted through all the layers (from here to middleware to user)
     if(!ctx->responseInfo)
         ctx->responseInfo = new HttpResponse{};
@@ -83,20 +126,25 @@ void CoreEngine::HandleRequest(ConnectionContext* ctx)
             ctx->SetConnectionState(ConnectionState::CONNECTION_ALIVE);
             connHandler_->RefreshExpiry(ctx, state == HttpParseState::PARSE_INCOMPLETE_HEADERS ?
                                             networkConfig.headerTimeout : networkConfig.bodyTimeout);
-            connHandler_->ResumeReceive(ctx);
+
+            // Responses of earlier pipelined requests are still in write buffer, get them out while-
+            // -we wait for the rest of this one. Connection handler resumes receive once its done
+            if(!FlushPipelined(ctx))
+                connHandler_->ResumeReceive(ctx);
             return;
         
         case HttpParseState::PARSE_EXPECT_100:
             ctx->SetConnectionState(ConnectionState::CONNECTION_ALIVE);
             connHandler_->RefreshExpiry(ctx, networkConfig.bodyTimeout);
-            connHandler_->Write(ctx, "HTTP/1.1 100 Continue\r\n\r\n");
+            WriteMessage(ctx, "HTTP/1.1 100 Continue\r\n\r\n");
             return;
         
         case HttpParseState::PARSE_EXPECT_417:
             ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
-            connHandler_->Write(ctx, "HTTP/1.1 417 Expectation Failed\r\n\r\n");
+            WriteMessage(ctx, "HTTP/1.1 417 Expectation Failed\r\n\r\n");
             return;
 
+        case HttpParseState::PARSE_BODY_TOO_LARGE:
         case HttpParseState::PARSE_SUCCESS:
         {
             // After parsing, ctx->trackBytes becomes the compact state register used by-
@@ -109,13 +157,13 @@ void CoreEngine::HandleRequest(ConnectionContext* ctx)
             res.version = ctx->requestInfo->version;
 
             auto& reqInfo    = *ctx->requestInfo;
-            auto  connHeader = reqInfo.headers.GetHeader("Connection");
+            auto  connHeader = reqInfo.headers.GetHeader(Http::KnownHeader::CONNECTION);
             auto  connMask   = HandleConnectionHeader(connHeader);
 
             // RFC violation, close connection
             if(connMask & ConnectionHeader::ERROR) {
                 ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
-                connHandler_->Write(ctx, HttpError::badRequest);
+                WriteMessage(ctx, HttpError::badRequest);
                 return;
             }
 
@@ -132,7 +180,7 @@ void CoreEngine::HandleRequest(ConnectionContext* ctx)
                 shouldClose = connMask & ConnectionHeader::CLOSE;
 
             // Set the 'connection' header ourselves in final response
-            res.Set("Connection", shouldClose ? "close" : "keep-alive");
+            res.headers.SetHeaderLine(shouldClose ? Http::HeaderLine::CONNECTION_CLOSE : Http::HeaderLine::CONNECTION_KEEP);
 
             // Set the connection state according to this right now, later if we have any issue, it-
             // -will be overridden
@@ -142,27 +190,76 @@ void CoreEngine::HandleRequest(ConnectionContext* ctx)
                 : ConnectionState::CONNECTION_ALIVE
             );
 
+            // Body didn't fit in read buffer, only routes which asked for it get it streamed
+            if(state == HttpParseState::PARSE_BODY_TOO_LARGE && !StreamBody(ctx)) {
+                ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+                WriteMessage(ctx, reqInfo.bodyState.expectContinue
+                                    ? "HTTP/1.1 417 Expectation Failed\r\n\r\n"
+                                    : HttpError::payloadTooLarge);
+                return;
+            }
+
             // A bit of shortcut if its public route (starts with '/public/')
             if(StartsWith(reqInfo.path, "/public/")) {
+                // Static files are read only
+                if(reqInfo.method != HttpMethod::GET && reqInfo.method != HttpMethod::HEAD) {
+                    res.Status(reqInfo.method == HttpMethod::OPTIONS ? HttpStatus::NO_CONTENT : HttpStatus::METHOD_NOT_ALLOWED)
+                        .Set("Allow", "GET, HEAD, OPTIONS");
+                    if(reqInfo.method != HttpMethod::OPTIONS)
+                        res.SendText("405: Method not allowed");
+                    goto __HandleResponse;
+                }
+
                 // Skip the '/public' part (7 chars)
                 std::string_view relativePath = reqInfo.path.substr(7); 
                 std::string fullRoute = config_.projectConfig.publicDir + std::string(relativePath);
 
+                // Small enough to be kept in memory, no fd / sendfile needed for these
+                // Range requests skip it, slicing is done on the file path (see 'HandleRangeRequest')
+                // Same for clients which take one of its precompressed sidecars (see 'NegotiateEncoding')
+                StaticFilePtr file;
+                if(!reqInfo.headers.HasHeader(KnownHeader::RANGE))
+                    file = staticCache_.Get(fullRoute);
+
+                if(file && file->sidecars != FileSidecar::NONE
+                    && (file->sidecars & HttpEncoding::ParseAcceptEncoding(reqInfo.headers.GetHeader(KnownHeader::ACCEPT_ENCODING))))
+                    file.reset();
+
+                if(file)
+                    res.Status(HttpStatus::OK)
+                        .SendStaticFile(std::move(file));
+
                 // Send the file
-                res.Status(HttpStatus::OK)
-                    .SendFile(std::move(fullRoute), true);
+                else
+                    res.Status(HttpStatus::OK)
+                        .SendFile(std::move(fullRoute), true);
             }
             else {
                 // Get the callback for the route we got, if it doesn't exist, we display error
-                auto node = router_.MatchRoute(
-                                    reqInfo.method,
-                                    reqInfo.path,
-                                    reqInfo.pathSegments
-                                );
+                // Streamed ones were already matched in 'StreamBody'
+                auto node = static_cast<const TrieNode*>(reqInfo.routeNode_);
+                if(!node)
+                    node = router_.MatchRoute(
+                                reqInfo.method,
+                                reqInfo.path,
+                                reqInfo.pathSegments
+                            );
 
                 if(!node) {
-                    res.Status(HttpStatus::NOT_FOUND)
-                        .SendText("404: Route not found :(");
+                    // Path might still exist under some other method, which makes it 405 (or an-
+                    // -answer to OPTIONS) instead of 404
+                    std::string_view allowed = router_.GetAllowedMethods(reqInfo.path);
+
+                    if(allowed.empty())
+                        res.Status(HttpStatus::NOT_FOUND)
+                            .SendText("404: Route not found :(");
+                    else if(reqInfo.method == HttpMethod::OPTIONS)
+                        res.Status(HttpStatus::NO_CONTENT)
+                            .Set("Allow", std::string(allowed));
+                    else
+                        res.Status(HttpStatus::METHOD_NOT_ALLOWED)
+                            .Set("Allow", std::string(allowed))
+                            .SendText("405: Method not allowed");
                     goto __HandleResponse;
                 }
 
@@ -181,13 +278,14 @@ void CoreEngine::HandleRequest(ConnectionContext* ctx)
 
         case HttpParseState::PARSE_ERROR:
             ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
-            connHandler_->Write(ctx, HttpError::badRequest);
+            WriteMessage(ctx, HttpError::badRequest);
             return;
 
+        // Parser only hands out partial bodies to 'HttpBodyReader', never here
         case HttpParseState::PARSE_STREAMING_BODY:
         default:
             ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
-            connHandler_->Write(ctx, HttpError::notImplemented);
+            WriteMessage(ctx, HttpError::notImplemented);
             return;
     }
 }
@@ -196,27 +294,73 @@ void CoreEngine::HandleResponse(ConnectionContext* ctx)
 {
     HttpResponse& res = *ctx->responseInfo;
 
+    // Handler didn't read its streamed body till the end, rest of it is still on its way so-
+    // -connection can't be reused for anything else
+    if(auto* req = ctx->requestInfo; req && req->bodyState.streamed && req->bodyState.phase != BODY_DONE) {
+        ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+        res.headers.SetHeaderLine(Http::HeaderLine::CONNECTION_CLOSE);
+    }
+
+    // HEAD gets everything GET would, except for the body. Headers (Content-Length included) stay-
+    // -as handler set them, serializer and us just never send anything after them
+    res.skipBody = ctx->requestInfo && ctx->requestInfo->method == HttpMethod::HEAD;
+
+    // Files with precompressed sidecars go out as whichever one client accepts. Has to come first-
+    // -as sidecar has its own validators and size, which is what conditionals / ranges look at
+    if(auto* req = ctx->requestInfo; req && res.IsFileOperation() && res.status == HttpStatus::OK
+        && (req->method == HttpMethod::GET || req->method == HttpMethod::HEAD))
+        res.NegotiateEncoding(HttpEncoding::ParseAcceptEncoding(req->headers.GetHeader(KnownHeader::ACCEPT_ENCODING)));
+
+    // Client already has what we are about to send, a header only 304 does it
+    if(HandleConditionalRequest(ctx))
+        res.skipBody = true;
+
+    // Only a part of the file was asked for (206 / 416), might turn the file into a stream
+    ByteRange range{0, UINT64_MAX};
+    if(!res.skipBody && res.IsFileOperation())
+        HandleRangeRequest(ctx, range);
+
+    // Dynamic templates / user streams, compressed on the fly as the socket drains
+    if(auto* req = ctx->requestInfo; req && !res.skipBody && res.GetOperation() == OperationType::STREAM_CHUNKED) {
+        auto& miscConfig = config_.miscConfig;
+        res.CompressStream(
+            HttpEncoding::ParseAcceptEncoding(req->headers.GetHeader(KnownHeader::ACCEPT_ENCODING)),
+            miscConfig.streamCompressLevel, miscConfig.streamCompressMinSize
+        );
+    }
+
     auto&& [serializeResult, bodyView] = HttpSerializer::SerializeToBuffer(res, ctx->rwBuffer);
 
     switch(serializeResult) {
+        // Headers didn't fit in write buffer in one go, connection handler serializes the rest-
+        // -each time the buffer drains, before moving on to the file / stream / body
+        case SerializeResult::SERIALIZE_BUFFER_INSUFFICIENT:
+            ctx->isPartialResponse = 1;
+            [[fallthrough]];
+
         case SerializeResult::SERIALIZE_SUCCESS:
-            if(res.IsFileOperation())
-                connHandler_->WriteFile(ctx, std::move(bodyView));
+            if(res.skipBody) {
+                if(CanPipeline(ctx))
+                    ContinuePipeline(ctx);
+                else
+                    connHandler_->Write(ctx, {});
+            }
+            else if(res.IsFileOperation())
+                connHandler_->WriteFile(ctx, std::move(bodyView), range.offset, range.length);
             else if(res.IsStreamOperation())
                 connHandler_->Stream(
                     ctx, std::move(std::get<StreamGenerator>(res.body)),
                     res.GetOperation() == OperationType::STREAM_CHUNKED
                 );
+            // Another request is already waiting right behind this one, keep the response in-
+            // -write buffer and answer that one as well, all of it goes out in a single write
+            else if(CanPipeline(ctx))
+                ContinuePipeline(ctx);
             else
                 connHandler_->Write(ctx, {});
 
             return;
 
-        // TODO: For insufficient cases, we need to be able to stream the remaining response
-        case SerializeResult::SERIALIZE_BUFFER_INSUFFICIENT:
-            connHandler_->Write(ctx, {});
-            return;
-
         default:
             logger_.Error("[CoreEngine]: Failed to serialize response");
             connHandler_->Close(ctx);
@@ -255,6 +399,7 @@ void CoreEngine::HandleSuccess(ConnectionContext* ctx)
             // Its async, let scheduler do its job at the backend
             ctx->parentCoro = std::move(task);
             FinishRequest(ctx);
+            FlushPipelined(ctx);
             return;
         }
         // Update 'eLevel' to be 'RESPONSE' level so the next time this shits called, we-
@@ -286,6 +431,7 @@ void CoreEngine::HandleSuccess(ConnectionContext* ctx)
         if(!coro.IsFinished()) {
             ctx->parentCoro = std::move(coro);
             FinishRequest(ctx);
+            FlushPipelined(ctx);
             return;
         }
 
@@ -301,10 +447,39 @@ void CoreEngine::HandleSuccess(ConnectionContext* ctx)
     }
 
 __HandleResponse:
+    // Earlier pipelined responses might still be going out (flushed when handler suspended), this-
+    // -one goes right behind them and finishes the request like any other response
+    ctx->isPipelineFlush = 0;
+
     FinishRequest(ctx);
     HandleResponse(ctx);
 }
 
+void CoreEngine::HandleBodyData(ConnectionContext* ctx)
+{
+    ctx->isBodyWait = 0;
+
+    // Still nothing handler can use, reader is already waiting for more
+    if(!HttpBodyReader::OnBodyData(ctx, connHandler_.get()))
+        return;
+
+    switch(ctx->TryFinishCoroutines()) {
+        case Async::Status::COMPLETED:
+            HandleSuccess(ctx);
+            return;
+
+        // Still running (or waiting on more body)
+        case Async::Status::NONE:
+            return;
+
+        // Errors
+        default:
+            ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+            connHandler_->Write(ctx, HttpError::internalError);
+            return;
+    }
+}
+
 // vvv Helper Functions vvv
 void CoreEngine::FinishRequest(ConnectionContext* ctx)
 {
@@ -312,6 +487,193 @@ void CoreEngine::FinishRequest(ConnectionContext* ctx)
     connHandler_->RefreshExpiry(ctx, config_.networkConfig.idleTimeout);
 }
 
+void CoreEngine::WriteMessage(ConnectionContext* ctx, std::string_view msg)
+{
+    auto& rwBuffer = ctx->rwBuffer;
+
+    // If connection stays alive (100-continue), request is still in progress so it must not be-
+    // -cleared once message is out
+    ctx->isPipelineFlush = ctx->GetConnectionState() == ConnectionState::CONNECTION_ALIVE;
+
+    // Nothing is queued up, static messages are fire and forget
+    if(!rwBuffer.HasPendingWrite()) {
+        connHandler_->Write(ctx, msg);
+        return;
+    }
+
+    // Responses of earlier pipelined requests are still in write buffer, so message has to go-
+    // -behind them
+    (void)rwBuffer.AppendData(msg.data(), static_cast<std::uint32_t>(msg.size()));
+    connHandler_->Write(ctx, {});
+}
+
+bool CoreEngine::StreamBody(ConnectionContext* ctx)
+{
+    auto& reqInfo = *ctx->requestInfo;
+    auto  node    = router_.MatchRoute(reqInfo.method, reqInfo.path, reqInfo.pathSegments);
+
+    if(!node || !node->streamBody)
+        return false;
+
+    // From here on, body is read by handler itself (see 'HttpBodyReader')
+    reqInfo.routeNode_          = node;
+    reqInfo.bodyState.streamed  = true;
+    reqInfo.bodyState.handedOut = false;
+    return true;
+}
+
+bool CoreEngine::HandleConditionalRequest(ConnectionContext* ctx)
+{
+    auto* req = ctx->requestInfo;
+    auto& res = *ctx->responseInfo;
+
+    // Only successful GET / HEAD responses can be revalidated
+    if(!req || res.status != HttpStatus::OK
+        || (req->method != HttpMethod::GET && req->method != HttpMethod::HEAD))
+        return false;
+
+    // Files (SendFile, static templates, '/public/') carry these, handlers can set them as well
+    std::string_view etag         = res.headers.GetHeader("ETag");
+    std::string_view lastModified = res.headers.GetHeader("Last-Modified");
+
+    if(etag.empty() && lastModified.empty())
+        return false;
+
+    if(!HttpValidators::IsNotModified(req->headers, etag, lastModified))
+        return false;
+
+    // Headers stay as they are, Content-Length included (which is allowed as long as its what-
+    // -a 200 would have said)
+    res.Status(HttpStatus::NOT_MODIFIED);
+    return true;
+}
+
+void CoreEngine::HandleRangeRequest(ConnectionContext* ctx, ByteRange& range)
+{
+    auto* req = ctx->requestInfo;
+    auto& res = *ctx->responseInfo;
+
+    // Range only means something for GET (RFC 9110 14.2)
+    if(!req || req->method != HttpMethod::GET || res.status != HttpStatus::OK)
+        return;
+
+    auto [hasRange, rangeHeader] = req->headers.CheckAndGetHeader(KnownHeader::RANGE);
+    if(!hasRange)
+        return;
+
+    std::string_view etag         = res.headers.GetHeader("ETag");
+    std::string_view lastModified = res.headers.GetHeader("Last-Modified");
+
+    // File changed since client got its first part, whole new file it is
+    auto [hasIfRange, ifRange] = req->headers.CheckAndGetHeader(KnownHeader::IF_RANGE);
+    if(hasIfRange && !HttpRange::IfRangeMatches(*ifRange, etag, lastModified))
+        return;
+
+    // Validator gives us the size without another stat
+    std::string path{res.GetFilePath()};
+
+    FileValidator validator;
+
+    if(!FileCache::GetInstance().GetValidator(path, validator))
+        return;
+
+    ByteRanges ranges;
+    switch(HttpRange::Parse(*rangeHeader, validator.size, ranges)) {
+        case RangeResult::IGNORE:
+            return;
+
+        case RangeResult::UNSATISFIABLE:
+            res.Status(HttpStatus::RANGE_NOT_SATISFIABLE)
+                .Set("Content-Range", "bytes */" + std::to_string(validator.size));
+            res.headers.SetContentLength(0);
+            res.skipBody = true;
+            return;
+
+        case RangeResult::SATISFIABLE:
+            break;
+    }
+
+    res.Status(HttpStatus::PARTIAL_CONTENT);
+
+    // Single range is still sendfile, just starting somewhere else and stopping earlier
+    if(ranges.size() == 1) {
+        range.offset = ranges[0].offset;
+        range.length = ranges[0].length;
+
+        res.Set("Content-Range", HttpRange::ContentRange(ranges[0], validator.size));
+        res.headers.SetContentLength(range.length);
+        return;
+    }
+
+    // Multiple ranges, every part needs its own headers in between so its streamed instead
+    auto [fd, size] = FileCache::GetInstance().GetFileDesc(path);
+    if(fd == WFX_INVALID_FILE) {
+        res.Status(HttpStatus::OK);
+        return;
+    }
+
+    std::string   contentType{res.headers.GetHeader("Content-Type")};
+    std::string   boundary      = HttpRange::MakeBoundary();
+    std::uint64_t contentLength = 0;
+
+    StreamGenerator generator = HttpRange::MakeMultipartGenerator(
+        fd, validator.size, ranges, contentType, boundary, contentLength
+    );
+
+    res.Set("Content-Type", "multipart/byteranges; boundary=" + boundary);
+    res.headers.SetContentLength(contentLength);
+    res.Stream(std::move(generator), false, true);
+}
+
+bool CoreEngine::CanPipeline(ConnectionContext* ctx)
+{
+    auto* writeMeta = ctx->rwBuffer.GetWriteMeta();
+
+    return pipelineBatch_ < MAX_PIPELINE_BATCH
+        && !ctx->isPartialResponse
+        && ctx->GetConnectionState() == ConnectionState::CONNECTION_ALIVE
+        && writeMeta
+        && !writeMeta->bodyData                                // Attached body must be the last thing we send
+        && writeMeta->dataLength <= writeMeta->bufferSize / 2  // Leave room for the next response
+        && HttpParser::HasPipelinedRequest(ctx);
+}
+
+void CoreEngine::ContinuePipeline(ConnectionContext* ctx)
+{
+    // Response is entirely inside of write buffer now (body included), so nothing references the-
+    // -request data anymore and it can be dropped from read buffer
+    ctx->rwBuffer.ConsumeReadData(ctx->requestInfo->requestLength);
+    HttpBodyReader::Release(*ctx->requestInfo);
+    ctx->requestInfo->ClearInfo();
+    ctx->responseInfo->ClearInfo();
+    ctx->parentCoro.Reset();
+    ctx->trackBytes         = 0;
+    ctx->expectedBodyLength = 0;
+
+    pipelineBatch_++;
+
+    // Already inside of 'HandleRequest' for this connection, its loop picks the next one up
+    if(pipelineCtx_ == ctx) {
+        pipelineNext_ = true;
+        return;
+    }
+
+    // Async handler finished from the backend, nothing to return to
+    HandleRequest(ctx);
+}
+
+bool CoreEngine::FlushPipelined(ConnectionContext* ctx)
+{
+    // Responses coalesced for earlier pipelined requests shouldn't wait on the current one, send-
+    // -them now. Request stays in progress, so connection handler only clears what went out
+    if(!ctx->rwBuffer.HasPendingWrite())
+        return false;
+
+    ctx->isPipelineFlush = 1;
+    connHandler_->Write(ctx, {});
+    return true;
+}
+
 std::uint8_t CoreEngine::HandleConnectionHeader(std::string_view header)
 {
     std::uint8_t mask  = ConnectionHeader::NONE;
@@ -406,6 +768,9 @@ void CoreEngine::HandleMiddlewareLoading()
 {
     middleware_.LoadMiddlewareFromConfig(config_.projectConfig.middlewareList);
 
+    // Global + per route middleware become one flat chain per route, no lookups per request
+    middleware_.BuildChains();
+
     // After we load the middleware, we no longer need the map thingy as all the stuff is properly loaded-
     // -inside of middlewareCallbacks_ stack
     // K I L L
@@ -2,6 +2,8 @@
 #define WFX_CORE_ENGINE_HPP
 
 #include "config/config.hpp"
+#include "http/common/http_range.hpp"
+#include "http/common/http_static_cache.hpp"
 #include "http/connection/http_connection_factory.hpp"
 #include "http/middleware/http_middleware.hpp"
 #include "http/routing/router.hpp"
@@ -21,11 +23,20 @@ public: // Main Stuff
 
 private: // Internal Functions
     void HandleRequest(ConnectionContext* ctx);
+    void ProcessRequest(ConnectionContext* ctx);
     void HandleResponse(ConnectionContext* ctx);
     void HandleSuccess(ConnectionContext* ctx);
+    void HandleBodyData(ConnectionContext* ctx);
 
 private: // Helper Functions
     void         FinishRequest(ConnectionContext* ctx);
+    void         WriteMessage(ConnectionContext* ctx, std::string_view msg);
+    bool         StreamBody(ConnectionContext* ctx);
+    bool         HandleConditionalRequest(ConnectionContext* ctx);
+    void         HandleRangeRequest(ConnectionContext* ctx, ByteRange& range);
+    bool         CanPipeline(ConnectionContext* ctx);
+    void         ContinuePipeline(ConnectionContext* ctx);
+    bool         FlushPipelined(ConnectionContext* ctx);
     std::uint8_t HandleConnectionHeader(std::string_view header);
     void         HandleUserDLLInjection(const char* dllDir);
     void         HandleMiddlewareLoading();
@@ -34,10 +45,18 @@ private:
     Logger& logger_ = Logger::GetInstance();
     Config& config_ = Config::GetInstance();
     
-    HttpMiddleware middleware_;
-    Router         router_;
+    HttpMiddleware  middleware_;
+    Router          router_;
+    StaticFileCache staticCache_;
 
     std::unique_ptr<HttpConnectionHandler> connHandler_;
+
+    // Pipelined requests answered back to back by 'HandleRequest', capped so their responses go-
+    // -out every once in a while and one connection doesn't hog the worker
+    static constexpr std::uint32_t MAX_PIPELINE_BATCH = 32;
+    std::uint32_t                  pipelineBatch_     = 0;
+    ConnectionContext*             pipelineCtx_       = nullptr;
+    bool                           pipelineNext_      = false;
 };
 
 } // namespace WFX
@@ -295,6 +295,11 @@ TemplateMeta* TemplateEngine::GetTemplate(std::string&& relPath)
     return nullptr;
 }
 
+std::string TemplateEngine::GetStaticOutputDir() const
+{
+    return Config::GetInstance().projectConfig.projectName + STATIC_FOLDER;
+}
+
 // vvv Helper Functions vvv
 TemplateResult TemplateEngine::CompileTemplate(BaseFilePtr inTemplate, BaseFilePtr outTemplate)
 {
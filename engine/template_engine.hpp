@@ -46,6 +46,7 @@ public:
     TemplateCompilationResult PreCompileTemplates();          // -|
     void                      LoadDynamicTemplatesFromLib();  // -| > To be called in master process only
     TemplateMeta*             GetTemplate(std::string&& relPath);
+    std::string               GetStaticOutputDir() const;     // Where static templates are compiled to
 
 private: // Nested helper types for the parser
     enum class TagType : std::uint8_t {
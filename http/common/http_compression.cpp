@@ -0,0 +1,394 @@
+#include "http_compression.hpp"
+
+#include "utils/logger/logger.hpp"
+
+#ifdef WFX_HAS_ZLIB
+    #include <zlib.h>
+#endif
+
+#ifdef WFX_HAS_ZSTD
+    #include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace WFX::Http {
+
+using namespace WFX::Utils; // For 'Logger'
+
+struct CompressorState {
+    std::uint8_t            encoding = ContentEncoding::IDENTITY;
+    int                     level    = 0;
+    std::unique_ptr<char[]> input{new char[HttpCompression::INPUT_BUFFER_SIZE]};
+
+#ifdef WFX_HAS_ZLIB
+    z_stream   zlib{};
+    bool       zlibReady = false;
+#endif
+
+#ifdef WFX_HAS_ZSTD
+    ZSTD_CCtx* zstd = nullptr;
+#endif
+
+    ~CompressorState()
+    {
+    #ifdef WFX_HAS_ZLIB
+        if(zlibReady)
+            deflateEnd(&zlib);
+    #endif
+    #ifdef WFX_HAS_ZSTD
+        ZSTD_freeCCtx(zstd);
+    #endif
+    }
+};
+
+// vvv Internal Helpers vvv
+namespace {
+
+// Library specific setup for a brand new state, false if it can't be had
+bool InitState(CompressorState& state)
+{
+    switch(state.encoding) {
+    #ifdef WFX_HAS_ZLIB
+        case ContentEncoding::GZIP:
+        case ContentEncoding::DEFLATE:
+        {
+            // 15 is the max window, +16 wraps it in gzip header / trailer instead of zlib one
+            int windowBits  = state.encoding == ContentEncoding::GZIP ? 15 + 16 : 15;
+            state.zlibReady = deflateInit2(
+                &state.zlib, state.level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY
+            ) == Z_OK;
+            return state.zlibReady;
+        }
+    #endif
+    #ifdef WFX_HAS_ZSTD
+        case ContentEncoding::ZSTD:
+            state.zstd = ZSTD_createCCtx();
+            return state.zstd
+                && !ZSTD_isError(ZSTD_CCtx_setParameter(state.zstd, ZSTD_c_compressionLevel, state.level));
+    #endif
+        default:
+            return false;
+    }
+}
+
+// Pooled state from an earlier stream, same allocations just a fresh session
+bool ResetState(CompressorState& state, int level)
+{
+    switch(state.encoding) {
+    #ifdef WFX_HAS_ZLIB
+        case ContentEncoding::GZIP:
+        case ContentEncoding::DEFLATE:
+            if(deflateReset(&state.zlib) != Z_OK)
+                return false;
+            if(state.level != level && deflateParams(&state.zlib, level, Z_DEFAULT_STRATEGY) != Z_OK)
+                return false;
+            break;
+    #endif
+    #ifdef WFX_HAS_ZSTD
+        case ContentEncoding::ZSTD:
+            if(ZSTD_isError(ZSTD_CCtx_reset(state.zstd, ZSTD_reset_session_only)))
+                return false;
+            if(state.level != level
+                && ZSTD_isError(ZSTD_CCtx_setParameter(state.zstd, ZSTD_c_compressionLevel, level)))
+                return false;
+            break;
+    #endif
+        default:
+            return false;
+    }
+
+    state.level = level;
+    return true;
+}
+
+// Runs compressor over 'in' into 'out'. 'finish' ends the stream, 'done' is set once all of it-
+// -(trailer included) has been written out. false on library errors
+bool Step(
+    CompressorState& state, const char* in, std::size_t inLen, char* out, std::size_t outLen,
+    bool finish, std::size_t& consumed, std::size_t& produced, bool& done
+)
+{
+    switch(state.encoding) {
+    #ifdef WFX_HAS_ZLIB
+        case ContentEncoding::GZIP:
+        case ContentEncoding::DEFLATE:
+        {
+            z_stream& zs = state.zlib;
+
+            // Both are bounded by 'INPUT_BUFFER_SIZE' / backend's write buffer, way below uInt max
+            zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+            zs.avail_in  = static_cast<uInt>(inLen);
+            zs.next_out  = reinterpret_cast<Bytef*>(out);
+            zs.avail_out = static_cast<uInt>(outLen);
+
+            int result = deflate(&zs, finish ? Z_FINISH : Z_NO_FLUSH);
+
+            consumed = inLen  - zs.avail_in;
+            produced = outLen - zs.avail_out;
+            done     = result == Z_STREAM_END;
+
+            // Z_BUF_ERROR only means no progress was possible this time around
+            return result == Z_OK || result == Z_STREAM_END || result == Z_BUF_ERROR;
+        }
+    #endif
+    #ifdef WFX_HAS_ZSTD
+        case ContentEncoding::ZSTD:
+        {
+            ZSTD_inBuffer  inBuf{in, inLen, 0};
+            ZSTD_outBuffer outBuf{out, outLen, 0};
+
+            std::size_t remaining = ZSTD_compressStream2(
+                state.zstd, &outBuf, &inBuf, finish ? ZSTD_e_end : ZSTD_e_continue
+            );
+            if(ZSTD_isError(remaining))
+                return false;
+
+            consumed = inBuf.pos;
+            produced = outBuf.pos;
+            done     = finish && remaining == 0;
+            return true;
+        }
+    #endif
+        default:
+            return false;
+    }
+}
+
+// Broken generator output / compressor failure, backend closes the connection on this-
+// -same as it would for a bad plain stream, a half compressed body can't be recovered anyways
+constexpr StreamResult ABORT_STREAM{0, StreamAction::CONTINUE};
+
+// Generator wrapper doing the actual work. Output of inner generator is collected in state's-
+// -input buffer and compressed into whatever buffer backend gives us, inner generator is called-
+// -as many times as needed to fill it up (compressor holds on to small inputs)
+class CompressingGenerator {
+public:
+    CompressingGenerator(
+        CompressorPtr state, StreamGenerator inner, std::size_t pending, bool innerDone, StreamAction finalAction
+    )
+        : state_(std::move(state)), inner_(std::move(inner)), inLen_(pending),
+          innerDone_(innerDone), finalAction_(finalAction)
+    {}
+
+    StreamResult operator()(StreamBuffer out)
+    {
+        std::size_t produced = 0;
+
+        while(true) {
+            if(finished_)
+                return produced > 0 ? StreamResult{produced, StreamAction::CONTINUE}
+                                    : StreamResult{0, finalAction_};
+
+            if(produced == out.size)
+                return { produced, StreamAction::CONTINUE };
+
+            // Everything we had is in the compressor, get more of body
+            if(inPos_ == inLen_ && !innerDone_) {
+                auto result = inner_({ state_->input.get(), HttpCompression::INPUT_BUFFER_SIZE });
+
+                // Same rule as backend, data returned along with STOP_... is not part of the body
+                if(result.action != StreamAction::CONTINUE) {
+                    innerDone_   = true;
+                    finalAction_ = result.action;
+                    inner_       = {};
+                }
+                else if(result.writtenBytes == 0 || result.writtenBytes > HttpCompression::INPUT_BUFFER_SIZE)
+                    return ABORT_STREAM;
+
+                else {
+                    inPos_ = 0;
+                    inLen_ = result.writtenBytes;
+                }
+            }
+
+            std::size_t consumed = 0;
+            std::size_t written  = 0;
+            bool        done     = false;
+
+            if(!Step(
+                *state_, state_->input.get() + inPos_, inLen_ - inPos_,
+                out.buffer + produced, out.size - produced, innerDone_, consumed, written, done
+            ))
+                return ABORT_STREAM;
+
+            inPos_   += consumed;
+            produced += written;
+
+            // Hand the state back right away, rest of the stream doesn't need it
+            if(done) {
+                finished_ = true;
+                state_.reset();
+            }
+        }
+    }
+
+private:
+    CompressorPtr   state_;
+    StreamGenerator inner_;
+    std::size_t     inPos_       = 0;
+    std::size_t     inLen_       = 0;
+    bool            innerDone_   = false;
+    bool            finished_    = false;
+    StreamAction    finalAction_ = StreamAction::CONTINUE;
+};
+
+} // namespace
+
+// vvv Compressor Pool vvv
+void CompressorRelease::operator()(CompressorState* state) const noexcept
+{
+    CompressorPool::GetInstance().Release(state);
+}
+
+CompressorPool& CompressorPool::GetInstance()
+{
+    static CompressorPool pool;
+    return pool;
+}
+
+CompressorPool::~CompressorPool()
+{
+    for(auto* state : idle_)
+        delete state;
+}
+
+CompressorPtr CompressorPool::Acquire(std::uint8_t encoding, int level)
+{
+    // Most recently released first, its memory is most likely still in cache
+    for(std::size_t i = idle_.size(); i-- > 0;) {
+        CompressorState* state = idle_[i];
+        if(state->encoding != encoding)
+            continue;
+
+        idle_[i] = idle_.back();
+        idle_.pop_back();
+
+        if(ResetState(*state, level))
+            return CompressorPtr{state};
+
+        delete state;
+        break;
+    }
+
+    auto* state     = new CompressorState{};
+    state->encoding = encoding;
+    state->level    = level;
+
+    if(!InitState(*state)) {
+        Logger::GetInstance().Error(
+            "[CompressorPool]: Failed to set up '", HttpEncoding::ToToken(encoding), "' compressor"
+        );
+        delete state;
+        return nullptr;
+    }
+
+    return CompressorPtr{state};
+}
+
+void CompressorPool::Release(CompressorState* state) noexcept
+{
+    if(!state)
+        return;
+
+    if(idle_.size() >= MAX_IDLE) {
+        delete state;
+        return;
+    }
+
+    idle_.push_back(state);
+}
+
+namespace HttpCompression {
+
+// vvv Main Functions vvv
+std::uint8_t Available() noexcept
+{
+    std::uint8_t available = ContentEncoding::IDENTITY;
+
+#ifdef WFX_HAS_ZLIB
+    available |= ContentEncoding::GZIP | ContentEncoding::DEFLATE;
+#endif
+#ifdef WFX_HAS_ZSTD
+    available |= ContentEncoding::ZSTD;
+#endif
+
+    return available;
+}
+
+std::uint8_t Pick(std::uint8_t acceptedEncodings) noexcept
+{
+    std::uint8_t usable = acceptedEncodings & Available();
+
+    // zstd compresses better than gzip at the same speed, deflate is only there for old clients
+    if(usable & ContentEncoding::ZSTD)
+        return ContentEncoding::ZSTD;
+    if(usable & ContentEncoding::GZIP)
+        return ContentEncoding::GZIP;
+    if(usable & ContentEncoding::DEFLATE)
+        return ContentEncoding::DEFLATE;
+
+    return ContentEncoding::IDENTITY;
+}
+
+StreamGenerator Compress(StreamGenerator generator, std::uint8_t& encoding, int level, std::size_t minSize)
+{
+    CompressorPtr state = CompressorPool::GetInstance().Acquire(encoding, level);
+    if(!state) {
+        encoding = ContentEncoding::IDENTITY;
+        return generator;
+    }
+
+    // Generator still needs decent sized buffers after the look ahead
+    minSize = std::min(minSize, INPUT_BUFFER_SIZE / 2);
+
+    char*        input  = state->input.get();
+    std::size_t  have   = 0;
+    StreamAction action = StreamAction::CONTINUE;
+
+    // Look ahead, headers aren't out yet so whether body is worth compressing can still be decided
+    while(have < minSize) {
+        auto result = generator({ input + have, INPUT_BUFFER_SIZE - have });
+
+        if(result.action != StreamAction::CONTINUE) {
+            action = result.action;
+            break;
+        }
+
+        if(result.writtenBytes == 0 || result.writtenBytes > INPUT_BUFFER_SIZE - have) {
+            encoding = ContentEncoding::IDENTITY;
+            return [](StreamBuffer) { return ABORT_STREAM; };
+        }
+
+        have += result.writtenBytes;
+    }
+
+    bool innerDone = action != StreamAction::CONTINUE;
+
+    // Whole body is smaller than 'minSize', compressed one wouldn't be any faster to send
+    // Generator is done by now, so simply replay what it gave us
+    if(innerDone && have < minSize) {
+        encoding = ContentEncoding::IDENTITY;
+
+        return [pending = std::string(input, have), offset = std::size_t{0}, action](StreamBuffer out) mutable {
+            if(offset == pending.size())
+                return StreamResult{ 0, action };
+
+            std::size_t toCopy = std::min(out.size, pending.size() - offset);
+            std::memcpy(out.buffer, pending.data() + offset, toCopy);
+            offset += toCopy;
+
+            return StreamResult{ toCopy, StreamAction::CONTINUE };
+        };
+    }
+
+    return CompressingGenerator{
+        std::move(state), innerDone ? StreamGenerator{} : std::move(generator), have, innerDone, action
+    };
+}
+
+} // namespace HttpCompression
+
+} // namespace WFX::Http
@@ -0,0 +1,71 @@
+#ifndef WFX_HTTP_COMPRESSION_HPP
+#define WFX_HTTP_COMPRESSION_HPP
+
+#include "http/common/http_encoding.hpp"
+#include "http/common/http_route_common.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace WFX::Http {
+
+// zlib / zstd stream along with the input buffer generator output lands in, defined in .cpp
+struct CompressorState;
+
+struct CompressorRelease {
+    void operator()(CompressorState* state) const noexcept;
+};
+
+// Dropping it hands the state back to 'CompressorPool' instead of freeing it
+using CompressorPtr = std::unique_ptr<CompressorState, CompressorRelease>;
+
+// Compressor states are expensive to set up (deflate alone allocates ~256KB), so they are reused-
+// -across responses. A connection holds one only while its stream is being compressed
+// One per worker process, so no locking needed
+class CompressorPool {
+public:
+    static CompressorPool& GetInstance();
+
+    // Idle state for 'encoding' (or a new one), ready for a fresh stream at 'level'
+    // nullptr if 'encoding' isn't compiled in or library failed to allocate
+    CompressorPtr Acquire(std::uint8_t encoding, int level);
+
+private:
+    friend struct CompressorRelease;
+    void Release(CompressorState* state) noexcept;
+
+private:
+    CompressorPool()  = default;
+    ~CompressorPool();
+
+    CompressorPool(const CompressorPool&)            = delete;
+    CompressorPool& operator=(const CompressorPool&) = delete;
+
+private:
+    // Enough for bursts of concurrent streams, anything past it is freed instead of kept around
+    static constexpr std::size_t MAX_IDLE = 64;
+
+    std::vector<CompressorState*> idle_;
+};
+
+namespace HttpCompression {
+    // Generator output is collected here before being compressed, also the most generator gets per call
+    constexpr std::size_t INPUT_BUFFER_SIZE = 16 * 1024;
+
+    // 'ContentEncoding' bits we can produce on the fly (gzip / deflate need zlib, zstd needs libzstd)
+    std::uint8_t Available() noexcept;
+
+    // Best of 'acceptedEncodings' we can produce on the fly, IDENTITY if none. zstd > gzip > deflate
+    std::uint8_t Pick(std::uint8_t acceptedEncodings) noexcept;
+
+    // Wraps 'generator' so whatever it produces comes out compressed with 'encoding', straight-
+    // -into the buffer backend hands out (chunk buffer for chunked streams)
+    // Generator is called up front till 'minSize' bytes are in hand, body which ends before that-
+    // -goes out as is and 'encoding' is set to IDENTITY (same if no compressor could be had)
+    StreamGenerator Compress(StreamGenerator generator, std::uint8_t& encoding, int level, std::size_t minSize);
+} // namespace HttpCompression
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_COMPRESSION_HPP
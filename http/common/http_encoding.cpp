@@ -0,0 +1,140 @@
+#include "http_encoding.hpp"
+
+#include "utils/crypt/string.hpp"
+#include "utils/fileops/filecache.hpp"
+
+namespace WFX::Http {
+
+static_assert(ContentEncoding::BROTLI == WFX::Utils::FileSidecar::BROTLI, "Encoding bits must match sidecar bits");
+static_assert(ContentEncoding::GZIP   == WFX::Utils::FileSidecar::GZIP,   "Encoding bits must match sidecar bits");
+
+namespace HttpEncoding {
+
+using WFX::Utils::StringCanonical::InsensitiveStringCompare;
+
+// vvv Internal Helpers vvv
+namespace {
+
+std::string_view TrimSpaces(std::string_view str)
+{
+    while(!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+        str.remove_prefix(1);
+    while(!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+        str.remove_suffix(1);
+    return str;
+}
+
+// 'q=0', 'q=0.', 'q=0.000' all mean 'never send me this'
+bool IsZeroQuality(std::string_view params)
+{
+    while(!params.empty()) {
+        std::size_t      semi  = params.find(';');
+        std::string_view param = TrimSpaces(params.substr(0, semi));
+        params = semi == std::string_view::npos ? std::string_view{} : params.substr(semi + 1);
+
+        if(param.size() < 3 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=')
+            continue;
+
+        std::string_view value = param.substr(2);
+        if(value.empty() || value[0] != '0')
+            return false;
+
+        for(char c : value.substr(1))
+            if(c != '.' && c != '0')
+                return false;
+
+        return true;
+    }
+    return false;
+}
+
+std::uint8_t TokenToEncoding(std::string_view token)
+{
+    if(InsensitiveStringCompare(token, "br"))
+        return ContentEncoding::BROTLI;
+    if(InsensitiveStringCompare(token, "gzip") || InsensitiveStringCompare(token, "x-gzip"))
+        return ContentEncoding::GZIP;
+    if(InsensitiveStringCompare(token, "zstd"))
+        return ContentEncoding::ZSTD;
+    if(InsensitiveStringCompare(token, "deflate"))
+        return ContentEncoding::DEFLATE;
+
+    return ContentEncoding::IDENTITY;
+}
+
+} // namespace
+
+// vvv Main Functions vvv
+std::uint8_t ParseAcceptEncoding(std::string_view header)
+{
+    constexpr std::uint8_t ALL = ContentEncoding::BROTLI | ContentEncoding::GZIP
+                               | ContentEncoding::ZSTD   | ContentEncoding::DEFLATE;
+
+    std::uint8_t accepted = 0;
+    std::uint8_t rejected = 0;
+    bool         wildcard = false;
+
+    while(!header.empty()) {
+        std::size_t      comma = header.find(',');
+        std::string_view item  = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+
+        std::size_t      semi  = item.find(';');
+        std::string_view token = TrimSpaces(item.substr(0, semi));
+        bool             zero  = semi != std::string_view::npos && IsZeroQuality(item.substr(semi + 1));
+
+        if(token == "*") {
+            wildcard = !zero;
+            continue;
+        }
+
+        std::uint8_t encoding = TokenToEncoding(token);
+        if(zero)
+            rejected |= encoding;
+        else
+            accepted |= encoding;
+    }
+
+    // '*' covers whatever wasn't named explicitly
+    if(wildcard)
+        accepted |= ALL & ~rejected;
+
+    return accepted & ~rejected;
+}
+
+std::string_view ToToken(std::uint8_t encoding)
+{
+    switch(encoding) {
+        case ContentEncoding::BROTLI:  return "br";
+        case ContentEncoding::GZIP:    return "gzip";
+        case ContentEncoding::ZSTD:    return "zstd";
+        case ContentEncoding::DEFLATE: return "deflate";
+        default:                       return "identity";
+    }
+}
+
+std::string_view SidecarExtension(std::uint8_t encoding)
+{
+    switch(encoding) {
+        case ContentEncoding::BROTLI: return ".br";
+        case ContentEncoding::GZIP:   return ".gz";
+        default:                      return {};
+    }
+}
+
+bool IsCompressibleMime(std::string_view mime)
+{
+    mime = TrimSpaces(mime.substr(0, mime.find(';')));
+
+    return mime.starts_with("text/")
+        || mime.find("javascript") != std::string_view::npos
+        || mime.find("json")       != std::string_view::npos
+        || mime.find("xml")        != std::string_view::npos // Covers svg as well
+        || mime == "application/wasm"
+        || mime == "font/ttf" || mime == "font/otf"
+        || mime == "image/x-icon" || mime == "image/vnd.microsoft.icon";
+}
+
+} // namespace HttpEncoding
+
+} // namespace WFX::Http
@@ -0,0 +1,36 @@
+#ifndef WFX_HTTP_ENCODING_HPP
+#define WFX_HTTP_ENCODING_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace WFX::Http {
+
+// Content codings we know how to serve, as bits so a whole 'Accept-Encoding' fits in one byte
+// Same bits as 'FileSidecar' for the ones which can come out of a sidecar file
+namespace ContentEncoding {
+    constexpr std::uint8_t IDENTITY = 0;
+    constexpr std::uint8_t BROTLI   = 1 << 0;
+    constexpr std::uint8_t GZIP     = 1 << 1;
+    constexpr std::uint8_t ZSTD     = 1 << 2; // Only produced on the fly, never a sidecar
+    constexpr std::uint8_t DEFLATE  = 1 << 3; // Same
+} // namespace ContentEncoding
+
+namespace HttpEncoding {
+    // 'ContentEncoding' bits client takes, anything with 'q=0' doesn't count
+    std::uint8_t ParseAcceptEncoding(std::string_view header);
+
+    // 'Content-Encoding' value of a single 'ContentEncoding' bit ('br', 'gzip', ...)
+    std::string_view ToToken(std::uint8_t encoding);
+
+    // Suffix of the sidecar file holding that encoding ('.br', '.gz')
+    std::string_view SidecarExtension(std::uint8_t encoding);
+
+    // Text-ish stuff (html, css, js, json, svg, wasm, fonts, ...), parameters after ';' are ignored
+    // Images / videos / archives are compressed already, running them through again only costs cpu
+    bool IsCompressibleMime(std::string_view mime);
+} // namespace HttpEncoding
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_ENCODING_HPP
@@ -0,0 +1,305 @@
+#include "http_range.hpp"
+
+#include "http_validators.hpp"
+#include "utils/backport/string.hpp"
+#include "utils/crypt/string.hpp"
+#include "utils/fileops/filesystem.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+namespace WFX::Http {
+
+namespace HttpRange {
+
+using namespace WFX::Utils; // For 'FileSystem', 'StrToUInt64', ...
+
+// vvv Internal Helpers vvv
+namespace {
+
+std::string_view TrimSpaces(std::string_view str)
+{
+    while(!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+        str.remove_prefix(1);
+    while(!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+        str.remove_suffix(1);
+    return str;
+}
+
+void AppendNumber(std::string& out, std::uint64_t value, int base = 10)
+{
+    char digits[20];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value, base);
+    out.append(digits, end);
+}
+
+// One part of multipart body, its header (boundary + part headers) goes right before its bytes
+struct MultipartPart {
+    std::string   header;
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+
+} // namespace
+
+// vvv Main Functions vvv
+RangeResult Parse(std::string_view header, std::uint64_t fileSize, ByteRanges& out)
+{
+    out.clear();
+    header = TrimSpaces(header);
+
+    // Bytes is the only range unit there is, anything else we don't know about is ignored
+    if(header.size() < 6 || !StringCanonical::InsensitiveStringCompare(header.substr(0, 6), "bytes="))
+        return RangeResult::IGNORE;
+
+    header.remove_prefix(6);
+
+    bool sawRange = false;
+
+    while(!header.empty()) {
+        std::size_t      comma = header.find(',');
+        std::string_view spec  = TrimSpaces(header.substr(0, comma));
+        header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+
+        // Empty list elements are legal ('bytes=0-1,,5-6')
+        if(spec.empty())
+            continue;
+
+        // No point in going through thousands of specs just to ignore them later on
+        if(out.size() >= MAX_RANGES * 4)
+            return RangeResult::IGNORE;
+
+        std::size_t dash = spec.find('-');
+        if(dash == std::string_view::npos)
+            return RangeResult::IGNORE;
+
+        std::string_view first = spec.substr(0, dash);
+        std::string_view last  = spec.substr(dash + 1);
+        sawRange = true;
+
+        // '-N', last N bytes of the file
+        if(first.empty()) {
+            std::uint64_t suffix = 0;
+            if(!StrToUInt64(last, suffix))
+                return RangeResult::IGNORE;
+
+            if(suffix == 0 || fileSize == 0)
+                continue;
+
+            std::uint64_t offset = suffix >= fileSize ? 0 : fileSize - suffix;
+            out.push_back({offset, fileSize - offset});
+            continue;
+        }
+
+        // 'A-' or 'A-B'
+        std::uint64_t start = 0;
+        std::uint64_t end   = fileSize > 0 ? fileSize - 1 : 0;
+
+        if(!StrToUInt64(first, start))
+            return RangeResult::IGNORE;
+
+        if(!last.empty()) {
+            std::uint64_t lastPos = 0;
+            if(!StrToUInt64(last, lastPos) || lastPos < start)
+                return RangeResult::IGNORE;
+
+            end = std::min(end, lastPos);
+        }
+
+        // Starts past the end, this one can't be satisfied but others still might be
+        if(start >= fileSize)
+            continue;
+
+        out.push_back({start, end - start + 1});
+    }
+
+    if(!sawRange)
+        return RangeResult::IGNORE;
+
+    if(out.empty())
+        return RangeResult::UNSATISFIABLE;
+
+    // Sort and merge whatever overlaps / touches, clients asking for the same bytes twice get-
+    // -them once (RFC 9110 14.2 lets us)
+    std::sort(out.begin(), out.end(), [](const ByteRange& lhs, const ByteRange& rhs) {
+        return lhs.offset < rhs.offset;
+    });
+
+    std::size_t merged = 0;
+    for(std::size_t i = 1; i < out.size(); i++) {
+        ByteRange& prev = out[merged];
+        std::uint64_t prevEnd = prev.offset + prev.length;
+
+        if(out[i].offset <= prevEnd)
+            prev.length = std::max(prevEnd, out[i].offset + out[i].length) - prev.offset;
+        else
+            out[++merged] = out[i];
+    }
+    out.resize(merged + 1);
+
+    if(out.size() > MAX_RANGES) {
+        out.clear();
+        return RangeResult::IGNORE;
+    }
+
+    return RangeResult::SATISFIABLE;
+}
+
+bool IfRangeMatches(std::string_view ifRange, std::string_view etag, std::string_view lastModified)
+{
+    ifRange = TrimSpaces(ifRange);
+
+    // Weak validators never match for ranges, bytes from two different versions can't be mixed
+    if(ifRange.starts_with("W/"))
+        return false;
+
+    if(ifRange.starts_with('"'))
+        return !etag.empty() && !etag.starts_with("W/") && ifRange == etag;
+
+    if(lastModified.empty())
+        return false;
+
+    std::int64_t date     = HttpValidators::ParseHttpDate(ifRange);
+    std::int64_t modified = HttpValidators::ParseHttpDate(lastModified);
+
+    return date >= 0 && date == modified;
+}
+
+std::string ContentRange(const ByteRange& range, std::uint64_t fileSize)
+{
+    std::string value;
+    value.reserve(64);
+
+    value.append("bytes ");
+    AppendNumber(value, range.offset);
+    value.push_back('-');
+    AppendNumber(value, range.offset + range.length - 1);
+    value.push_back('/');
+    AppendNumber(value, fileSize);
+
+    return value;
+}
+
+std::string MakeBoundary()
+{
+    // Per process counter mixed with time through splitmix64, unique enough for a delimiter
+    static std::uint64_t counter = 0;
+
+    std::uint64_t x = static_cast<std::uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count()
+    ) + (++counter * 0x9E3779B97F4A7C15ULL);
+
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x = x ^ (x >> 31);
+
+    std::string boundary = "wfx_";
+    AppendNumber(boundary, x, 16);
+
+    return boundary;
+}
+
+StreamGenerator MakeMultipartGenerator(
+    WFXFileDescriptor fd, std::uint64_t fileSize, const ByteRanges& ranges,
+    std::string_view contentType, std::string_view boundary, std::uint64_t& contentLength
+)
+{
+    std::vector<MultipartPart> parts;
+    parts.reserve(ranges.size());
+
+    contentLength = 0;
+
+    for(const ByteRange& range : ranges) {
+        MultipartPart part;
+        part.offset = range.offset;
+        part.length = range.length;
+
+        // Delimiter's leading CRLF belongs to it, so first one (right at the start) skips it
+        if(!parts.empty())
+            part.header.append("\r\n");
+
+        part.header.append("--").append(boundary).append("\r\n");
+        if(!contentType.empty())
+            part.header.append("Content-Type: ").append(contentType).append("\r\n");
+        part.header.append("Content-Range: ").append(ContentRange(range, fileSize)).append("\r\n\r\n");
+
+        contentLength += part.header.size() + part.length;
+        parts.push_back(std::move(part));
+    }
+
+    std::string trailer;
+    trailer.append("\r\n--").append(boundary).append("--\r\n");
+    contentLength += trailer.size();
+
+    // Same thing 'SendTemplate' does, fd belongs to 'FileCache' so wrapper won't close it
+    return [
+        inFile  = FileSystem::OpenFileExisting(fd, static_cast<std::size_t>(fileSize)),
+        parts   = std::move(parts),
+        trailer = std::move(trailer),
+        index   = std::size_t{0},
+        cursor  = std::uint64_t{0},
+        inBody  = false
+    ](StreamBuffer buffer) mutable -> StreamResult {
+        if(!inFile)
+            return { 0, StreamAction::STOP_AND_CLOSE_CONN };
+
+        std::size_t written = 0;
+
+        while(written < buffer.size) {
+            // Every part is out, only the closing delimiter is left
+            if(index == parts.size()) {
+                if(cursor == trailer.size())
+                    return written > 0
+                        ? StreamResult{ written, StreamAction::CONTINUE }
+                        : StreamResult{ 0, StreamAction::STOP_AND_ALIVE_CONN };
+
+                std::size_t count = std::min<std::size_t>(trailer.size() - cursor, buffer.size - written);
+                std::memcpy(buffer.buffer + written, trailer.data() + cursor, count);
+
+                cursor  += count;
+                written += count;
+                continue;
+            }
+
+            MultipartPart& part = parts[index];
+
+            if(!inBody) {
+                std::size_t count = std::min<std::size_t>(part.header.size() - cursor, buffer.size - written);
+                std::memcpy(buffer.buffer + written, part.header.data() + cursor, count);
+
+                cursor  += count;
+                written += count;
+
+                if(cursor == part.header.size()) {
+                    inBody = true;
+                    cursor = 0;
+                }
+                continue;
+            }
+
+            std::uint64_t toRead = std::min<std::uint64_t>(part.length - cursor, buffer.size - written);
+            std::int64_t  got    = inFile->ReadAt(buffer.buffer + written, toRead, part.offset + cursor);
+
+            // File got shorter under us, Content-Length can't be kept anymore
+            if(got <= 0)
+                return { 0, StreamAction::STOP_AND_CLOSE_CONN };
+
+            cursor  += static_cast<std::uint64_t>(got);
+            written += static_cast<std::size_t>(got);
+
+            if(cursor == part.length) {
+                index++;
+                inBody = false;
+                cursor = 0;
+            }
+        }
+
+        return { written, StreamAction::CONTINUE };
+    };
+}
+
+} // namespace HttpRange
+
+} // namespace WFX::Http
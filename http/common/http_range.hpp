@@ -0,0 +1,54 @@
+#ifndef WFX_HTTP_RANGE_HPP
+#define WFX_HTTP_RANGE_HPP
+
+#include "http/common/http_route_common.hpp"
+#include "utils/common/file.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace WFX::Http {
+
+struct ByteRange {
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+};
+
+using ByteRanges = std::vector<ByteRange>;
+
+enum class RangeResult : std::uint8_t {
+    IGNORE,       // No / malformed / unsupported 'Range', whole file goes out as usual
+    SATISFIABLE,  // At least one range, sorted and coalesced
+    UNSATISFIABLE // Syntactically fine but nothing in it overlaps the file, 416
+};
+
+namespace HttpRange {
+    // More than this (after coalescing) is way past what seeking / resuming needs, whole file-
+    // -is cheaper for both sides than a hundred tiny parts
+    constexpr std::size_t MAX_RANGES = 16;
+
+    // 'bytes=0-99,200-,-50' -> ranges clamped to 'fileSize'. Overlapping / adjacent ones are merged
+    RangeResult Parse(std::string_view header, std::uint64_t fileSize, ByteRanges& out);
+
+    // 'If-Range' holds either an ETag (strong comparison) or a date (exact match)
+    bool IfRangeMatches(std::string_view ifRange, std::string_view etag, std::string_view lastModified);
+
+    // 'bytes 0-99/1000'
+    std::string ContentRange(const ByteRange& range, std::uint64_t fileSize);
+
+    // Boundary for 'multipart/byteranges', differs every call so it can't be guessed up front
+    std::string MakeBoundary();
+
+    // 'multipart/byteranges' body for 'ranges' of file behind 'fd', read as the socket drains
+    // 'contentLength' is set to exact size of the body, so it can go out without chunking
+    StreamGenerator MakeMultipartGenerator(
+        WFXFileDescriptor fd, std::uint64_t fileSize, const ByteRanges& ranges,
+        std::string_view contentType, std::string_view boundary, std::uint64_t& contentLength
+    );
+} // namespace HttpRange
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_RANGE_HPP
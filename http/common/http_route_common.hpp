@@ -46,6 +46,13 @@ struct StreamBuffer {
 
 using StreamGenerator = WFX::Utils::MoveOnlyFunction<StreamResult(StreamBuffer)>;
 
+// vvv Inbound Streaming vvv
+enum class BodyReadState : std::uint8_t {
+    READY,   // Got something (empty chunk means body is over)
+    PENDING, // Nothing yet, handler gets resumed once more of body arrives
+    FAILED   // Malformed / too large body or temp file couldn't be written to
+};
+
 // vvv Middleware (Sync & Async) vvv
 enum class MiddlewareAction : std::uint8_t {
     CONTINUE,  // Continue to next middleware
@@ -53,13 +60,6 @@ enum class MiddlewareAction : std::uint8_t {
     SKIP_NEXT  // Skip the next middleware in chain if any
 };
 
-// So for async routes we need this to determine whether we are executing global-
-// -mw or per route middleware
-enum class MiddlewareLevel : std::uint8_t {
-    GLOBAL,
-    PER_ROUTE
-};
-
 using SyncMiddlewareType  = MiddlewareAction (*)(WFX::Http::HttpRequest&, Response);
 using AsyncMiddlewareType = Async::Task<MiddlewareAction> (*)(WFX::Http::HttpRequest&, Response);
 using HttpMiddlewareType  = std::variant<std::monostate, SyncMiddlewareType, AsyncMiddlewareType>;
@@ -0,0 +1,234 @@
+#include "http_static_cache.hpp"
+
+#include "http_detector.hpp"
+#include "http_validators.hpp"
+#include "utils/fileops/filecache.hpp"
+#include "utils/fileops/filesystem.hpp"
+
+#ifndef _WIN32
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <charconv>
+#include <chrono>
+#include <climits>
+
+namespace WFX::Http {
+
+using namespace WFX::Utils; // For 'FileSystem', 'FileCache', 'FileStats', ...
+
+// vvv Internal Helpers vvv
+namespace {
+
+// Watched entries never need a stat, their 'revalidateAt' is never reached
+constexpr std::int64_t NEVER_REVALIDATE = INT64_MAX;
+
+std::int64_t SteadyMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+bool IsSameFile(const FileValidator& cached, const FileValidator& current)
+{
+    // Windows has no inode without opening the file, our copy never got one
+#ifdef _WIN32
+    return cached.size == current.size && cached.modifiedNs == current.modifiedNs;
+#else
+    return cached.inode == current.inode && cached.size == current.size && cached.modifiedNs == current.modifiedNs;
+#endif
+}
+
+} // namespace
+
+// vvv Main Functions vvv
+void StaticFileCache::Init(std::size_t budget, std::size_t maxFileSize)
+{
+    budget_      = budget;
+    maxFileSize_ = maxFileSize < budget ? maxFileSize : budget;
+}
+
+StaticFilePtr StaticFileCache::Get(const std::string& path)
+{
+    if(budget_ == 0)
+        return nullptr;
+
+    auto it = index_.find(path);
+    if(it != index_.end()) {
+        if(Revalidate(*it->second)) {
+            // Move it to the front, nothing is copied, only list links change
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->file;
+        }
+
+        // Changed on disk (or gone) since we loaded it, stale bytes and ETag have to go
+        Invalidate(path);
+    }
+
+    FileValidator validator;
+    StaticFilePtr file = Load(path, validator);
+    if(!file)
+        return nullptr;
+
+    // Only possible with a tiny budget, serve it but don't wipe the whole cache for it
+    std::size_t cost = file->data.size() + path.size();
+    if(cost > budget_)
+        return file;
+
+    Evict(cost);
+
+    std::int64_t revalidateAt = FileCache::GetInstance().IsWatched(path)
+                                ? NEVER_REVALIDATE
+                                : SteadyMs() + FileCache::REVALIDATE_INTERVAL_MS;
+
+    lru_.push_front(Entry{path, file, cost, validator, revalidateAt});
+    index_.emplace(lru_.front().path, lru_.begin());
+    used_ += cost;
+
+    return file;
+}
+
+void StaticFileCache::Invalidate(std::string_view path)
+{
+    if(path.empty()) {
+        index_.clear();
+        lru_.clear();
+        used_ = 0;
+        return;
+    }
+
+    auto it = index_.find(path);
+    if(it == index_.end())
+        return;
+
+    // Responses still being written hold their own reference, this only drops ours
+    used_ -= it->second->cost;
+    lru_.erase(it->second);
+    index_.erase(it);
+}
+
+// vvv Helper Functions vvv
+StaticFilePtr StaticFileCache::Load(const std::string& path, FileValidator& validator)
+{
+    std::uint64_t inode      = 0;
+    std::uint64_t size       = 0;
+    std::int64_t  modifiedNs = 0;
+
+#ifdef _WIN32
+    FileStats stats;
+    if(!FileSystem::GetFileStats(path.c_str(), stats) || stats.type != FileType::REG)
+        return nullptr;
+
+    size       = stats.size;
+    modifiedNs = stats.modifiedNs;
+
+    if(size > maxFileSize_)
+        return nullptr;
+
+    auto inFile = FileSystem::OpenFileRead(path.c_str(), true);
+    if(!inFile)
+        return nullptr;
+#else
+    // Same rules as 'FileCache', no following symlinks and only regular files
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if(fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || static_cast<std::uint64_t>(st.st_size) > maxFileSize_) {
+        close(fd);
+        return nullptr;
+    }
+
+    inode      = static_cast<std::uint64_t>(st.st_ino);
+    size       = static_cast<std::uint64_t>(st.st_size);
+    modifiedNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000LL + st.st_mtim.tv_nsec;
+#endif
+
+    auto file = std::make_shared<StaticFile>();
+
+    // vvv Header lines vvv
+    std::string& data = file->data;
+    char         lengthStr[20];
+    auto [lengthEnd, ec] = std::to_chars(lengthStr, lengthStr + sizeof(lengthStr), size);
+
+    data.append("Content-Type: ").append(MimeDetector::DetectMimeFromExt(path)).append("\r\n");
+    data.append("Content-Length: ").append(lengthStr, lengthEnd).append("\r\n");
+    data.append("Accept-Ranges: bytes\r\n");
+
+    // Only plain file is kept in here, but response still depends on 'Accept-Encoding' as soon-
+    // -as precompressed copies of it exist
+    file->sidecars = FileCache::ProbeSidecars(path);
+    if(file->sidecars != FileSidecar::NONE)
+        data.append("Vary: Accept-Encoding\r\n");
+
+    data.append("ETag: ").append(HttpValidators::MakeETag(inode, size, modifiedNs)).append("\r\n");
+    data.append("Last-Modified: ")
+        .append(HttpValidators::FormatHttpDate(modifiedNs / 1'000'000'000LL))
+        .append("\r\n");
+
+    file->headerLen = static_cast<std::uint32_t>(data.size());
+
+    // vvv Body vvv
+    data.resize(file->headerLen + size);
+
+    char*         dst  = data.data() + file->headerLen;
+    std::uint64_t done = 0;
+
+    while(done < size) {
+#ifdef _WIN32
+        std::int64_t got = inFile->ReadAt(dst + done, static_cast<std::size_t>(size - done), done);
+#else
+        std::int64_t got = pread(fd, dst + done, static_cast<std::size_t>(size - done), static_cast<off_t>(done));
+#endif
+        // File got shorter (or errored) while we were reading it, let the usual path deal with it
+        if(got <= 0)
+            break;
+
+        done += static_cast<std::uint64_t>(got);
+    }
+
+#ifndef _WIN32
+    close(fd);
+#endif
+
+    if(done != size)
+        return nullptr;
+
+    validator.inode      = inode;
+    validator.size       = size;
+    validator.modifiedNs = modifiedNs;
+
+    return file;
+}
+
+bool StaticFileCache::Revalidate(Entry& entry)
+{
+    std::int64_t now = SteadyMs();
+    if(now < entry.revalidateAt)
+        return true;
+
+    FileValidator current;
+    if(!FileCache::StatValidator(entry.path, current) || !IsSameFile(entry.validator, current))
+        return false;
+
+    entry.revalidateAt = now + FileCache::REVALIDATE_INTERVAL_MS;
+    return true;
+}
+
+void StaticFileCache::Evict(std::size_t needed)
+{
+    // Least recently used ones go first, till 'needed' fits in
+    while(!lru_.empty() && used_ + needed > budget_) {
+        Entry& victim = lru_.back();
+
+        used_ -= victim.cost;
+        index_.erase(victim.path);
+        lru_.pop_back();
+    }
+}
+
+} // namespace WFX::Http
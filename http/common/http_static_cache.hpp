@@ -0,0 +1,78 @@
+#ifndef WFX_HTTP_STATIC_CACHE_HPP
+#define WFX_HTTP_STATIC_CACHE_HPP
+
+#include "utils/fileops/filecache.hpp"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace WFX::Http {
+
+// A small file kept entirely in memory, already in the shape it goes out in
+// Header lines ('Content-Type', 'Content-Length', 'Accept-Ranges', 'ETag', 'Last-Modified')-
+// -followed by the body, in a single allocation
+struct StaticFile {
+    std::string   data;
+    std::uint32_t headerLen = 0;
+    std::uint8_t  sidecars  = 0; // 'FileSidecar' bits, clients accepting one of them skip the cache
+
+    std::string_view Headers() const noexcept { return std::string_view{data}.substr(0, headerLen); }
+    std::string_view Body()    const noexcept { return std::string_view{data}.substr(headerLen); }
+};
+
+// Shared, so an entry evicted while its response is still being written stays alive till then
+using StaticFilePtr = std::shared_ptr<const StaticFile>;
+
+// Content cache for '/public/' files below a size limit, LRU under a byte budget
+// Hits skip open / fstat / sendfile entirely, headers + body go out of write buffer in one go
+// One per worker process (owned by 'CoreEngine'), so no locking needed
+class StaticFileCache {
+public:
+    // 'budget' of 0 disables the cache, every 'Get' misses then
+    void Init(std::size_t budget, std::size_t maxFileSize);
+
+    // Cached copy of file at 'path', loaded on a miss. nullptr if file doesn't exist, isn't a-
+    // -regular file, is too big to be cached or the cache is disabled. Caller falls back to the-
+    // -usual 'SendFile' path then
+    // Files under watched directories are dropped by 'Invalidate' the moment they change, rest-
+    // -of the hits lstat the file at most once every 'FileCache::REVALIDATE_INTERVAL_MS'
+    StaticFilePtr Get(const std::string& path);
+
+    // Drops cached copy of 'path', empty 'path' drops everything. Fed by 'FileCache' watches
+    void Invalidate(std::string_view path);
+
+    std::size_t BytesUsed() const noexcept { return used_; }
+
+private:
+    struct Entry {
+        std::string               path;
+        StaticFilePtr             file;
+        std::size_t               cost;         // What this entry counts for against 'budget_'
+        WFX::Utils::FileValidator validator;    // What the file looked like when it was loaded
+        std::int64_t              revalidateAt; // When to lstat it again (steady ms), never if its watched
+    };
+
+    using EntryList = std::list<Entry>;
+
+    StaticFilePtr Load(const std::string& path, WFX::Utils::FileValidator& validator);
+    bool          Revalidate(Entry& entry); // false if file changed since it was loaded
+    void          Evict(std::size_t needed);
+
+private:
+    std::size_t budget_      = 0;
+    std::size_t maxFileSize_ = 0;
+    std::size_t used_        = 0;
+
+    EntryList lru_; // Most recently used at the front
+
+    // Keys view into 'Entry::path', list nodes never move so they stay valid
+    std::unordered_map<std::string_view, EntryList::iterator> index_;
+};
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_STATIC_CACHE_HPP
@@ -0,0 +1,187 @@
+#include "http_validators.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace WFX::Http {
+
+namespace HttpValidators {
+
+// vvv Internal Helpers vvv
+namespace {
+
+constexpr const char* DAY_NAMES[]   = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+constexpr const char* MONTH_NAMES[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+void AppendHex(std::string& out, std::uint64_t value)
+{
+    char digits[16];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value, 16);
+    out.append(digits, end);
+}
+
+void AppendTwoDigits(std::string& out, unsigned value)
+{
+    out.push_back(static_cast<char>('0' + value / 10));
+    out.push_back(static_cast<char>('0' + value % 10));
+}
+
+bool ParseDigits(std::string_view str, std::size_t pos, std::size_t count, int& out)
+{
+    out = 0;
+    for(std::size_t i = pos; i < pos + count; i++) {
+        if(str[i] < '0' || str[i] > '9')
+            return false;
+        out = out * 10 + (str[i] - '0');
+    }
+    return true;
+}
+
+std::string_view TrimSpaces(std::string_view str)
+{
+    while(!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+        str.remove_prefix(1);
+    while(!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+        str.remove_suffix(1);
+    return str;
+}
+
+// Weak comparison (RFC 9110 8.8.3.2), 'W/' prefix doesn't matter for GET revalidation
+bool ETagEquals(std::string_view lhs, std::string_view rhs)
+{
+    if(lhs.starts_with("W/"))
+        lhs.remove_prefix(2);
+    if(rhs.starts_with("W/"))
+        rhs.remove_prefix(2);
+
+    return !lhs.empty() && lhs == rhs;
+}
+
+} // namespace
+
+// vvv Main Functions vvv
+std::string MakeETag(std::uint64_t inode, std::uint64_t size, std::int64_t modifiedNs)
+{
+    std::string etag;
+    etag.reserve(52);
+
+    etag.push_back('"');
+    AppendHex(etag, inode);
+    etag.push_back('-');
+    AppendHex(etag, size);
+    etag.push_back('-');
+    AppendHex(etag, static_cast<std::uint64_t>(modifiedNs));
+    etag.push_back('"');
+
+    return etag;
+}
+
+std::string FormatHttpDate(std::int64_t unixSeconds)
+{
+    // Nothing we serve is older than 1970, and gmtime is not something i wanna deal with-
+    // -across platforms, so days -> civil date by hand (Howard Hinnant's algorithm)
+    if(unixSeconds < 0)
+        unixSeconds = 0;
+
+    std::int64_t days = unixSeconds / 86400;
+    std::int64_t secs = unixSeconds % 86400;
+
+    std::int64_t z   = days + 719468;
+    std::int64_t era = z / 146097;
+    unsigned     doe = static_cast<unsigned>(z - era * 146097);
+    unsigned     yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned     doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned     mp  = (5 * doy + 2) / 153;
+    unsigned     day = doy - (153 * mp + 2) / 5 + 1;
+    unsigned     mon = mp < 10 ? mp + 3 : mp - 9;
+    std::int64_t yr  = static_cast<std::int64_t>(yoe) + era * 400 + (mon <= 2);
+
+    std::string date;
+    date.reserve(29);
+
+    date.append(DAY_NAMES[(days + 4) % 7]); // 1970-01-01 was a Thursday
+    date.append(", ");
+    AppendTwoDigits(date, day);
+    date.push_back(' ');
+    date.append(MONTH_NAMES[mon - 1]);
+    date.push_back(' ');
+
+    char year[20];
+    auto [end, ec] = std::to_chars(year, year + sizeof(year), yr);
+    date.append(year, end);
+
+    date.push_back(' ');
+    AppendTwoDigits(date, static_cast<unsigned>(secs / 3600));
+    date.push_back(':');
+    AppendTwoDigits(date, static_cast<unsigned>(secs / 60 % 60));
+    date.push_back(':');
+    AppendTwoDigits(date, static_cast<unsigned>(secs % 60));
+    date.append(" GMT");
+
+    return date;
+}
+
+std::int64_t ParseHttpDate(std::string_view date)
+{
+    // 'Sun, 06 Nov 1994 08:49:37 GMT', everything is at a fixed position
+    if(date.size() != 29 || date[3] != ',' || date[4] != ' ' || date[7] != ' ' || date[11] != ' '
+        || date[16] != ' ' || date[19] != ':' || date[22] != ':' || date.substr(25) != " GMT")
+        return -1;
+
+    int month = -1;
+    for(int i = 0; i < 12; i++)
+        if(date.substr(8, 3) == MONTH_NAMES[i]) {
+            month = i + 1;
+            break;
+        }
+
+    int day, year, hour, minute, second;
+    if(month < 0
+        || !ParseDigits(date, 5,  2, day)  || !ParseDigits(date, 12, 4, year)
+        || !ParseDigits(date, 17, 2, hour) || !ParseDigits(date, 20, 2, minute)
+        || !ParseDigits(date, 23, 2, second)
+        || day < 1 || day > 31 || year < 1970 || hour > 23 || minute > 59 || second > 60)
+        return -1;
+
+    // Civil date -> days since epoch, inverse of what 'FormatHttpDate' does
+    std::int64_t y   = year - (month <= 2);
+    std::int64_t era = y / 400;
+    unsigned     yoe = static_cast<unsigned>(y - era * 400);
+    unsigned     doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned     doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    std::int64_t days = era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+
+    return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+bool IsNotModified(const RequestHeaders& headers, std::string_view etag, std::string_view lastModified)
+{
+    auto [hasINM, inm] = headers.CheckAndGetHeader(KnownHeader::IF_NONE_MATCH);
+    if(hasINM) {
+        std::string_view list = *inm;
+
+        while(!list.empty()) {
+            std::size_t      comma = list.find(',');
+            std::string_view tag   = TrimSpaces(list.substr(0, comma));
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+            if(tag == "*" || ETagEquals(tag, etag))
+                return true;
+        }
+        return false;
+    }
+
+    auto [hasIMS, ims] = headers.CheckAndGetHeader(KnownHeader::IF_MODIFIED_SINCE);
+    if(!hasIMS || lastModified.empty())
+        return false;
+
+    std::int64_t since    = ParseHttpDate(TrimSpaces(*ims));
+    std::int64_t modified = ParseHttpDate(lastModified);
+
+    return since >= 0 && modified >= 0 && modified <= since;
+}
+
+} // namespace HttpValidators
+
+} // namespace WFX::Http
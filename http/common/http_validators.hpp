@@ -0,0 +1,31 @@
+#ifndef WFX_HTTP_VALIDATORS_HPP
+#define WFX_HTTP_VALIDATORS_HPP
+
+#include "http/headers/http_headers.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace WFX::Http {
+
+// Stuff needed to build (and later on, check) cache validators of files we serve
+namespace HttpValidators {
+    // '"<inode>-<size>-<mtime>"' all in hex, changes whenever file is replaced or modified
+    std::string MakeETag(std::uint64_t inode, std::uint64_t size, std::int64_t modifiedNs);
+
+    // IMF-fixdate ('Sun, 06 Nov 1994 08:49:37 GMT'), what 'Last-Modified' uses
+    std::string FormatHttpDate(std::int64_t unixSeconds);
+
+    // Seconds since epoch out of an IMF-fixdate, -1 if it isn't one
+    // Obsolete formats (RFC 850, asctime) aren't worth it, unparsable date is simply ignored
+    std::int64_t ParseHttpDate(std::string_view date);
+
+    // Whether 'If-None-Match' / 'If-Modified-Since' of request say client's copy is still good-
+    // -and a 304 does it. 'If-Modified-Since' is only looked at without an 'If-None-Match'
+    bool IsNotModified(const RequestHeaders& headers, std::string_view etag, std::string_view lastModified);
+} // namespace HttpValidators
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_VALIDATORS_HPP
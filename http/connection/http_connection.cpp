@@ -1,6 +1,8 @@
 #include "http_connection.hpp"
+#include "http/request/http_body_reader.hpp"
 #include "http/response/http_response.hpp"
 #include "shared/apis/http_api.hpp"
+#include "utils/fileops/filecache.hpp"
 
 namespace WFX::Http {
 
@@ -57,15 +59,35 @@ const char* WFXIpAddress::GetIpType() const
 }
 
 // vvv Connection Context Methods vvv
+// fd being sent was retained from 'FileCache' by the connection backend, transfer is over now
+// IOCP opens a handle of its own for each 'TransmitFile' and closes it with the transfer, it-
+// -never takes one out of 'FileCache' so there is nothing to release there
+static void ReleaseFile(FileInfo* fileInfo)
+{
+#ifndef _WIN32
+    if(fileInfo && fileInfo->fd >= 0)
+        WFX::Utils::FileCache::GetInstance().Release(fileInfo->fd);
+#else
+    (void)fileInfo;
+#endif
+}
+
 void ConnectionContext::ResetContext()
 {
     rwBuffer.ResetBuffer();
     parentCoro.Reset();
     
+    // Streamed body might have been spilled to a temp file
+    if(requestInfo)  HttpBodyReader::Release(*requestInfo);
+
+    ReleaseFile(fileInfo);
+
     if(requestInfo)  { delete requestInfo;  requestInfo  = nullptr; }
     if(responseInfo) { delete responseInfo; responseInfo = nullptr; }
     if(fileInfo)     { delete fileInfo;     fileInfo     = nullptr; }
 
+    // Connection might have died mid stream, generator could be holding on to stuff (compressor)
+    streamGenerator    = {};
     __Flags            = 0;
     connInfo           = WFXIpAddress{};
     expectedBodyLength = 0;
@@ -77,17 +99,25 @@ void ConnectionContext::ResetContext()
 
 void ConnectionContext::ClearContext()
 {
-    rwBuffer.ClearBuffer();
+    // Next pipelined request might already be sitting right after this one, keep it
+    rwBuffer.ClearBuffer(requestInfo ? requestInfo->requestLength : 0);
     parentCoro.Reset();
 
+    if(requestInfo)  HttpBodyReader::Release(*requestInfo);
+    ReleaseFile(fileInfo);
+
     if(requestInfo)  requestInfo->ClearInfo();
     if(responseInfo) responseInfo->ClearInfo();
     if(fileInfo)     *fileInfo = FileInfo{};
 
+    streamGenerator       = {};
     isFileOperation       = 0;
     isStreamOperation     = 0;
     isAsyncTimerOperation = 0;
     streamChunked         = 0;
+    isPartialResponse     = 0;
+    isPipelineFlush       = 0;
+    isBodyWait            = 0;
     expectedBodyLength    = 0;
     trackBytes            = 0;
     // eventType          = EventType::EVENT_ACCEPT;
@@ -121,6 +151,21 @@ bool ConnectionContext::IsAsyncOperation() const
     return static_cast<bool>(parentCoro);
 }
 
+bool ConnectionContext::HasPipelinedData() const
+{
+    // Between requests, anything in read buffer is the start of the next pipelined one
+    // Async handler is still holding onto its own request (which is in read buffer too), so not yet
+    auto* readMeta = rwBuffer.GetReadMeta();
+    return GetParseState() == HttpParseState::PARSE_IDLE && !IsAsyncOperation()
+        && readMeta && readMeta->dataLength > 0;
+}
+
+bool ConnectionContext::CanReceive() const
+{
+    // Async handler can still take in data, but only when its waiting on its streamed body
+    return eventType == EventType::EVENT_RECV && (!IsAsyncOperation() || isBodyWait);
+}
+
 Async::Status ConnectionContext::TryFinishCoroutines()
 {
     /*
@@ -50,13 +50,16 @@ enum class HttpParseState : std::uint8_t {
     PARSE_INCOMPLETE_HEADERS, // Header end sequence (\r\n\r\n) not found yet
     PARSE_INCOMPLETE_BODY,    // Buffering body (Content-Length not fully received)
     
-    PARSE_STREAMING_BODY,     // [Future] Streaming mode (body being processed in chunks)
+    PARSE_STREAMING_BODY,     // Decoding 'Transfer-Encoding: chunked' / streamed body
     
     PARSE_EXPECT_100,         // It was a Expect: 100-continue header, accept it
     PARSE_EXPECT_417,         // It was a Expect: 100-continue header, REJECT IT
     PARSE_SUCCESS,            // Successfully received and parsed all data
     PARSE_ERROR,              // Malformed request
-    PARSE_IDLE                // After Request-Response cycle, waiting for another request
+    PARSE_IDLE,               // After Request-Response cycle, waiting for another request
+
+    // NOTE: Below ones are only ever returned, never stored (parseState is 3 bits wide)
+    PARSE_BODY_TOO_LARGE      // Body doesn't fit in read buffer, can only be streamed
 };
 
 enum class EventType : std::uint8_t {
@@ -86,7 +89,7 @@ struct FileInfo {
     std::uint64_t offset{0};     // current send offset
 #else
     int   fd       = -1;     // Linux file descriptor
-    off_t fileSize = 0;      // File size
+    off_t fileSize = 0;      // Where sending stops, file size or end of requested range
     off_t offset   = 0;      // current send offset
 #endif
 };
@@ -117,14 +120,7 @@ struct AsyncTrack {
         levels = (levels & 0x0F) | ((static_cast<std::uint8_t>(v) & 0x0F) << 4);
     }
 
-    // Middleware Level: Lower 4 bits
-    MiddlewareLevel GetMLevel() const { 
-        return static_cast<MiddlewareLevel>(levels & 0x0F); 
-    }
-    void SetMLevel(MiddlewareLevel v) {
-        levels = (levels & 0xF0) | (static_cast<std::uint8_t>(v) & 0x0F);
-    }
-    
+    // Index into route's middleware chain (global and per route ones are a single chain)
     std::uint16_t GetMIndex() const { return mIndex; }
     void SetMIndex(std::uint16_t idx) { mIndex = idx; }
 };
@@ -148,7 +144,11 @@ struct ConnectionContext : public ConnectionTag {
             std::uint16_t isAsyncTimerOperation : 1;   //  |
             std::uint16_t isShuttingDown        : 1;   //  |
             std::uint16_t streamChunked         : 1;   //  |
-            std::uint16_t __FPad                : 6;   //  V
+            std::uint16_t isPartialResponse     : 1;   //  |
+            std::uint16_t isPipelineFlush       : 1;   //  |
+            std::uint16_t isRecvPending         : 1;   //  |
+            std::uint16_t isBodyWait            : 1;   //  |
+            std::uint16_t __FPad                : 2;   //  V
         };                                             // 2 byte
         std::uint16_t __Flags = 0;
     };
@@ -182,7 +182,9 @@ public: // Helper functions
     HttpParseState  GetParseState()      const;
     ConnectionState GetConnectionState() const;
 
-    bool          IsAsyncOperation() const;
+    bool          IsAsyncOperation()  const;
+    bool          HasPipelinedData()  const;
+    bool          CanReceive()        const;
     Async::Status TryFinishCoroutines();
 };
 static_assert(sizeof(ConnectionContext) <= 128, "ConnectionContext must STRICTLY be less than or equal to 128 bytes.");
@@ -204,8 +206,9 @@ public:
     // Write data to socket (Async)
     virtual void Write(ConnectionContext* ctx, std::string_view buffer = {}) = 0;
 
-    // Write file directly to sockets (Async)
-    virtual void WriteFile(ConnectionContext* ctx, std::string path) = 0;
+    // Write file directly to sockets (Async), 'length' bytes starting at 'offset' (clamped to file)
+    virtual void WriteFile(ConnectionContext* ctx, std::string path,
+                           std::uint64_t offset = 0, std::uint64_t length = UINT64_MAX) = 0;
 
     // Stream data to socket via a generator function (Async)
     virtual void Stream(ConnectionContext* ctx, StreamGenerator generator, bool streamChunked = true) = 0;
@@ -25,7 +25,7 @@ inline std::unique_ptr<HttpConnectionHandler> CreateConnectionHandler(bool useHt
     return std::make_unique<WFX::OSSpecific::IocpConnectionHandler>();
 #else
     #ifdef WFX_LINUX_USE_IO_URING
-        return std::make_unique<WFX::OSSpecific::IoUringConnectionHandler>();
+        return std::make_unique<WFX::OSSpecific::IoUringConnectionHandler>(useHttps);
     #else
         return std::make_unique<WFX::OSSpecific::EpollConnectionHandler>(useHttps);
     #endif
@@ -5,10 +5,20 @@
 
 namespace WFX::Http {
 
-// We will keep it quite simple, only GET and POST support for now
+// windows.h defines 'DELETE' as a macro, which would wreck the enum below
+#if defined(_WIN32) && defined(DELETE)
+    #undef DELETE
+#endif
+
+// Router keeps one trie per method indexed by this, so 'UNKNOWN' must stay last (its the count)
 enum class HttpMethod {
     GET,
     POST,
+    PUT,
+    PATCH,
+    DELETE,
+    HEAD,
+    OPTIONS,
     UNKNOWN
 };
 
@@ -175,11 +185,31 @@ static inline const char* HttpStatusToReason(HttpStatus code)
     }
 }
 
+static inline const char* HttpMethodToString(HttpMethod method)
+{
+    switch(method) {
+        case HttpMethod::GET:     return "GET";
+        case HttpMethod::POST:    return "POST";
+        case HttpMethod::PUT:     return "PUT";
+        case HttpMethod::PATCH:   return "PATCH";
+        case HttpMethod::DELETE:  return "DELETE";
+        case HttpMethod::HEAD:    return "HEAD";
+        case HttpMethod::OPTIONS: return "OPTIONS";
+
+        default: return "UNKNOWN";
+    }
+}
+
 // STRING -> ENUM
 static inline HttpMethod HttpMethodToEnum(std::string_view method)
 {
-    if(method == "GET")  return HttpMethod::GET;
-    if(method == "POST") return HttpMethod::POST;
+    if(method == "GET")     return HttpMethod::GET;
+    if(method == "POST")    return HttpMethod::POST;
+    if(method == "PUT")     return HttpMethod::PUT;
+    if(method == "PATCH")   return HttpMethod::PATCH;
+    if(method == "DELETE")  return HttpMethod::DELETE;
+    if(method == "HEAD")    return HttpMethod::HEAD;
+    if(method == "OPTIONS") return HttpMethod::OPTIONS;
     
     return HttpMethod::UNKNOWN;
 }
@@ -1,9 +1,13 @@
 #include "http_parser.hpp"
+#include "http_scanner.hpp"
 
 #include "config/config.hpp"
 #include "utils/backport/string.hpp"
 #include "utils/crypt/string.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace WFX::Http {
 
 using namespace WFX::Utils; // For 'I have no idea'
@@ -16,9 +20,15 @@ bool ParseRequest(const char* data, std::size_t size, std::size_t& pos, HttpRequ
 bool ParseHeaders(const char* data, std::size_t size, std::size_t& pos, RequestHeaders& outHeaders);
 bool ParseBody(const char* data, std::size_t size, std::size_t& pos, std::size_t contentLen, HttpRequest& outRequest);
 
-bool SafeFindCRLF(const char* data, std::size_t size, std::size_t from, std::size_t& outNextPos, std::string_view& outLine);
-bool SafeFindHeaderEnd(const char* data, std::size_t size, std::size_t from, std::size_t& outPos);
+enum class BodyResult : std::uint8_t { ERROR, LIMIT, INCOMPLETE, DONE };
+BodyResult DecodeBody(char* data, std::size_t size, std::size_t& rpos, std::size_t& wpos, BodyState& state, std::uint64_t limit);
+
 std::string_view Trim(std::string_view sv);
+int              HexValue(char c);
+
+// vvv Chunked Decoding vvv
+// Chunk extensions are useless to us, but they still need to end somewhere
+constexpr std::size_t MAX_CHUNK_LINE = 1024;
 
 // vvv Function definitions vvv
 HttpParseState Parse(ConnectionContext* ctx)
@@ -34,6 +44,7 @@ HttpParseState Parse(ConnectionContext* ctx)
     std::uint32_t maxBufferSize      = Config::GetInstance().networkConfig.maxRecvBufferSize;
     std::uint32_t maxBodyTotalSize   = Config::GetInstance().networkConfig.maxBodyTotalSize;
     std::uint32_t maxHeaderTotalSize = Config::GetInstance().networkConfig.maxHeaderTotalSize;
+    std::uint64_t maxStreamBodySize  = Config::GetInstance().networkConfig.maxStreamBodySize;
 
     // Connection Context variables
     std::uint32_t& trackBytes = ctx->trackBytes;
@@ -57,8 +68,9 @@ HttpParseState Parse(ConnectionContext* ctx)
         {
             std::size_t headerEnd = 0;
             // Even if we werent able to find header end, update trackBytes so we don't start reading-
-            // -from beginning everytime.
-            if(!SafeFindHeaderEnd(data, size, trackBytes, headerEnd)) {
+            // -from beginning everytime. Back off 3 bytes as '\r\n\r\n' might be split between reads
+            std::size_t searchFrom = trackBytes > 3 ? trackBytes - 3 : 0;
+            if(!HttpScanner::FindHeaderEnd(data, size, searchFrom, headerEnd)) {
                 // Even if we haven't reached the end of header, check if the data we received exceeds-
                 // -header limit. If it does, GG
                 if(size > maxHeaderTotalSize)
@@ -85,9 +97,9 @@ HttpParseState Parse(ConnectionContext* ctx)
                 return HttpParseState::PARSE_ERROR;
 
             // Now we check the type, whether its streaming data or all at once kinda stuff or expect header
-            auto expectHeader        = request.headers.GetHeader("Expect");
-            auto contentLengthHeader = request.headers.GetHeader("Content-Length");
-            auto encodingHeader      = request.headers.GetHeader("Transfer-Encoding");
+            auto expectHeader        = request.headers.GetHeader(KnownHeader::EXPECT);
+            auto contentLengthHeader = request.headers.GetHeader(KnownHeader::CONTENT_LENGTH);
+            auto encodingHeader      = request.headers.GetHeader(KnownHeader::TRANSFER_ENCODING);
 
             bool hasExpectHeader        = !expectHeader.empty() && StringCanonical::InsensitiveStringCompare(expectHeader, "100-continue");
             bool hasContentLengthHeader = !contentLengthHeader.empty();
@@ -109,21 +121,34 @@ HttpParseState Parse(ConnectionContext* ctx)
                     return HttpParseState::PARSE_ERROR;
 
                 // Sanity check: are we about to exceed our max buffer size or max body size?
-                // If so, reject oversized payload
+                // If so, body can only be streamed. Whether route wants that is for engine to decide
                 if(
                     contentLen > maxBodyTotalSize
                     || contentLen > maxBufferSize - 1
                     || headerEnd > maxBufferSize - 1 - contentLen
                 ) {
-                    // If client sent "Expect", reply with 417 else fail the response
-                    if(hasExpectHeader)
-                        return HttpParseState::PARSE_EXPECT_417;
+                    // Too large even for that, if client sent "Expect", reply with 417 else fail the response
+                    if(contentLen > maxStreamBodySize) {
+                        if(hasExpectHeader)
+                            return HttpParseState::PARSE_EXPECT_417;
 
-                    return HttpParseState::PARSE_ERROR;
+                        return HttpParseState::PARSE_ERROR;
+                    }
+
+                    request.bodyState                = BodyState{};
+                    request.bodyState.cursor         = static_cast<std::uint32_t>(headerEnd);
+                    request.bodyState.remaining      = contentLen;
+                    request.bodyState.phase          = FIXED_DATA;
+                    request.bodyState.expectContinue = hasExpectHeader && size == headerEnd;
+                    ctx->SetParseState(HttpParseState::PARSE_STREAMING_BODY);
+                    return HttpParseState::PARSE_BODY_TOO_LARGE;
                 }
 
-                if(hasExpectHeader) {
-                    // Set the state so the next time parser returns to this, it knows to parse body not header
+                // Client is waiting for our go-ahead before sending the body. Body bounds need to be set-
+                // -here as well, INCOMPLETE_BODY picks up from them once the body does arrive
+                if(hasExpectHeader && contentLen > 0 && size == headerEnd) {
+                    trackBytes = headerEnd + contentLen;
+                    ctx->expectedBodyLength = contentLen;
                     ctx->SetParseState(HttpParseState::PARSE_INCOMPLETE_BODY);
                     return HttpParseState::PARSE_EXPECT_100;
                 }
@@ -146,11 +171,13 @@ HttpParseState Parse(ConnectionContext* ctx)
                     if(!ParseBody(data, size, pos, contentLen, request))
                         return HttpParseState::PARSE_ERROR;
 
+                    request.requestLength = static_cast<std::uint32_t>(pos);
                     ctx->SetParseState(HttpParseState::PARSE_SUCCESS);
                     return HttpParseState::PARSE_SUCCESS;
                 }
                 // No body, only header
                 else {
+                    request.requestLength = static_cast<std::uint32_t>(headerEnd);
                     ctx->SetParseState(HttpParseState::PARSE_SUCCESS);
                     return HttpParseState::PARSE_SUCCESS;
                 }
@@ -162,16 +189,21 @@ HttpParseState Parse(ConnectionContext* ctx)
                 if(!StringCanonical::InsensitiveStringCompare(encodingHeader, "chunked"))
                     return HttpParseState::PARSE_ERROR;
 
-                // Parser will not try to buffer the full body, instead user will handle chunks
+                // Body gets de-chunked in place right after the head, see 'ParseStreamingBody'
+                request.bodyState        = BodyState{};
+                request.bodyState.cursor = static_cast<std::uint32_t>(headerEnd);
+                request.bodyState.phase  = CHUNK_SIZE;
                 ctx->SetParseState(HttpParseState::PARSE_STREAMING_BODY);
                 
-                if(hasExpectHeader)
+                // Client didn't bother waiting for 100 Continue, no need to send it then
+                if(hasExpectHeader && size == headerEnd)
                     return HttpParseState::PARSE_EXPECT_100;
 
-                return HttpParseState::PARSE_STREAMING_BODY;
+                return ParseStreamingBody(ctx);
             }
 
             // We just assume it's a header only request
+            request.requestLength = static_cast<std::uint32_t>(headerEnd);
             ctx->SetParseState(HttpParseState::PARSE_SUCCESS);
             return HttpParseState::PARSE_SUCCESS;
         }
@@ -187,13 +219,13 @@ HttpParseState Parse(ConnectionContext* ctx)
             if(!ParseBody(data, size, pos, ctx->expectedBodyLength, request))
                 return HttpParseState::PARSE_ERROR;
 
+            request.requestLength = trackBytes;
             ctx->SetParseState(HttpParseState::PARSE_SUCCESS);
             return HttpParseState::PARSE_SUCCESS;
         }
         
-        // Not implemented [future]
         case HttpParseState::PARSE_STREAMING_BODY:
-            return HttpParseState::PARSE_STREAMING_BODY;
+            return ParseStreamingBody(ctx);
 
         case HttpParseState::PARSE_SUCCESS:
             return HttpParseState::PARSE_SUCCESS;
@@ -203,15 +235,126 @@ HttpParseState Parse(ConnectionContext* ctx)
     }
 }
 
+HttpParseState ParseStreamingBody(ConnectionContext* ctx, bool streamed)
+{
+    ReadMetadata* readMeta = ctx->rwBuffer.GetReadMeta();
+    char*         data     = ctx->rwBuffer.GetReadData();
+
+    if(!data || !ctx->requestInfo)
+        return HttpParseState::PARSE_ERROR;
+
+    auto& networkConfig = Config::GetInstance().networkConfig;
+
+    // NOTE: Everything is kept in 'bodyState' and not in ctx->trackBytes, as streamed body is read-
+    //       -while handler is running and ctx->trackAsync is in use by then
+    HttpRequest&  request   = *ctx->requestInfo;
+    BodyState&    state     = request.bodyState;
+    std::size_t   size      = readMeta->dataLength;
+    std::size_t   bodyStart = state.cursor - state.pending;
+    std::size_t   rpos      = state.cursor;
+    std::size_t   wpos      = state.cursor;
+
+    BodyResult result = DecodeBody(
+        data, size, rpos, wpos, state,
+        streamed ? networkConfig.maxStreamBodySize : networkConfig.maxBodyTotalSize
+    );
+
+    // Once streamed, there is nothing bigger left to fall back to
+    if(result == BodyResult::ERROR || (result == BodyResult::LIMIT && streamed)) {
+        state.phase = BODY_ERROR;
+        return HttpParseState::PARSE_ERROR;
+    }
+
+    // Squeeze out the framing we just went through, so whatever is left (rest of the body or-
+    // -next pipelined request) sits right after the decoded data. Receive keeps appending after it
+    if(rpos > wpos) {
+        std::memmove(data + wpos, data + rpos, size - rpos);
+        readMeta->dataLength = static_cast<std::uint32_t>(size - (rpos - wpos));
+    }
+
+    state.cursor  = static_cast<std::uint32_t>(wpos);
+    state.pending = static_cast<std::uint32_t>(wpos - bodyStart);
+
+    // Didn't fit, engine decides whether it gets streamed or rejected. Size line which went over-
+    // -the limit is still unread, so decoding can just pick up from here
+    if(result == BodyResult::LIMIT)
+        return HttpParseState::PARSE_BODY_TOO_LARGE;
+
+    if(result == BodyResult::DONE) {
+        request.body          = std::string_view{data + bodyStart, state.pending};
+        request.requestLength = static_cast<std::uint32_t>(wpos);
+
+        // Handler is already running for streamed ones, parse state is none of our business there
+        if(!streamed)
+            ctx->SetParseState(HttpParseState::PARSE_SUCCESS);
+        return HttpParseState::PARSE_SUCCESS;
+    }
+
+    // Hand over whatever we got till now, caller drops it using 'ConsumeStreamedBody'
+    if(streamed && state.pending > 0) {
+        request.body = std::string_view{data + bodyStart, state.pending};
+        return HttpParseState::PARSE_STREAMING_BODY;
+    }
+
+    return HttpParseState::PARSE_INCOMPLETE_BODY;
+}
+
+void ConsumeStreamedBody(ConnectionContext* ctx)
+{
+    ReadMetadata* readMeta = ctx->rwBuffer.GetReadMeta();
+    char*         data     = ctx->rwBuffer.GetReadData();
+
+    if(!data || !ctx->requestInfo)
+        return;
+
+    HttpRequest&  request  = *ctx->requestInfo;
+    BodyState&    state    = request.bodyState;
+    std::uint32_t consumed = state.pending;
+
+    if(consumed == 0)
+        return;
+
+    std::uint32_t bodyStart = state.cursor - consumed;
+
+    std::memmove(data + bodyStart, data + state.cursor, readMeta->dataLength - state.cursor);
+    readMeta->dataLength -= consumed;
+    state.cursor          = bodyStart;
+    state.pending         = 0;
+    request.body          = {};
+
+    // Request end is already known, it moved down along with everything else
+    if(request.requestLength > 0)
+        request.requestLength -= consumed;
+}
+
+bool HasPipelinedRequest(ConnectionContext* ctx)
+{
+    if(!ctx->requestInfo)
+        return false;
+
+    ReadMetadata* readMeta      = ctx->rwBuffer.GetReadMeta();
+    std::uint32_t requestLength = ctx->requestInfo->requestLength;
+
+    if(!readMeta || requestLength == 0 || readMeta->dataLength <= requestLength)
+        return false;
+
+    // Only the head has to be complete, body (if any) is the next parse's problem
+    std::size_t headerEnd = 0;
+    return HttpScanner::FindHeaderEnd(
+        ctx->rwBuffer.GetReadData() + requestLength, readMeta->dataLength - requestLength, 0, headerEnd
+    );
+}
+
 // vvv Parse Helpers vvv
 bool ParseRequest(const char* data, std::size_t size, std::size_t& pos, HttpRequest& outRequest)
 {
-    std::size_t nextPos = 0;
-    std::string_view line;
-    if(!SafeFindCRLF(data, size, pos, nextPos, line))
+    // Finds the end of request line and rejects any CTLs in it at the same time
+    std::size_t lineEnd = 0;
+    if(!HttpScanner::ScanLine(data, size, pos, lineEnd))
         return false;
 
-    pos = nextPos;
+    std::string_view line{data + pos, lineEnd - pos};
+    pos = lineEnd + 2;
 
     std::size_t mEnd = line.find(' ');
     if(mEnd == std::string_view::npos)
@@ -244,27 +387,26 @@ bool ParseRequest(const char* data, std::size_t size, std::size_t& pos, HttpRequ
 bool ParseHeaders(const char* data, std::size_t size, std::size_t& pos, RequestHeaders& outHeaders)
 {
     std::size_t headerCount = 0;
-    std::size_t nextPos     = 0;
-    std::string_view line;
+    std::size_t colon       = 0;
+    std::size_t lineEnd     = 0;
 
     auto& networkConfig = Config::GetInstance().networkConfig;
 
     while(true) {
-        if(!SafeFindCRLF(data, size, pos, nextPos, line))
-            return false;
-
-        std::size_t lineBytes = nextPos - pos;
-        pos = nextPos;
-
-        if(line.empty())
+        // Empty line, end of headers
+        if(pos + 1 < size && data[pos] == '\r' && data[pos + 1] == '\n') {
+            pos += 2;
             break;
+        }
 
-        std::size_t colon = line.find(':');
-        if(colon == std::string_view::npos || colon == 0)
+        // Colon, line end and character validation all happen in a single pass
+        if(!HttpScanner::ScanHeaderLine(data, size, pos, colon, lineEnd))
             return false;
 
-        std::string_view key = line.substr(0, colon);
-        std::string_view val = Trim(line.substr(colon + 1));
+        std::string_view key{data + pos, colon - pos};
+        std::string_view val = Trim(std::string_view{data + colon + 1, lineEnd - colon - 1});
+
+        pos = lineEnd + 2;
 
         // Null-terminate key and value in-place, so even if we use pointer as is, its harmless
         char* writableKey = const_cast<char*>(data + (key.data() - data));
@@ -273,6 +415,7 @@ bool ParseHeaders(const char* data, std::size_t size, std::size_t& pos, RequestH
         char* writableVal = const_cast<char*>(data + (val.data() - data));
         writableVal[val.size()] = '\0';
 
+        // Known headers get resolved to their slot right here, so later lookups don't compare names
         outHeaders.SetHeader(key, val);
 
         if(++headerCount > networkConfig.maxHeaderTotalCount)
@@ -293,42 +436,169 @@ bool ParseBody(const char* data, std::size_t size, std::size_t& pos, std::size_t
     return true;
 }
 
-// vvv Helpers vvv
-bool SafeFindCRLF(const char* data, std::size_t size, std::size_t from,
-                                std::size_t& outNextPos, std::string_view& outLine)
+BodyResult DecodeBody(char* data, std::size_t size, std::size_t& rpos, std::size_t& wpos, BodyState& state, std::uint64_t limit)
 {
-    if(from >= size)
-        return false;
+    auto& networkConfig = Config::GetInstance().networkConfig;
 
-    const char* start = data + from;
-    const char* end   = static_cast<const char*>(memchr(start, '\r', size - from));
-    if(!end || end + 1 >= data + size || *(end + 1) != '\n')
-        return false;
+    // 'rpos' walks over the raw chunked data, 'wpos' is where decoded body ends. Decoded data is always-
+    // -shorter than what it was decoded from, so moving it down never overwrites anything unread
+    while(true) {
+        switch(state.phase) {
+            case CHUNK_SIZE:
+            {
+                std::size_t   pos    = rpos;
+                std::uint64_t length = 0;
+
+                for(; pos < size; pos++) {
+                    int digit = HexValue(data[pos]);
+                    if(digit < 0)
+                        break;
+
+                    // 8 hex digits is already 4GB per chunk, anything bigger is just silly
+                    if(pos - rpos >= 8)
+                        return BodyResult::ERROR;
+
+                    length = (length << 4) | static_cast<std::uint64_t>(digit);
+                }
 
-    outNextPos = static_cast<std::size_t>(end - data) + 2;
-    outLine    = std::string_view(start, static_cast<std::size_t>(end - start));
-    return true;
-}
+                if(pos == size)
+                    return BodyResult::INCOMPLETE;
 
-bool SafeFindHeaderEnd(const char* data, std::size_t size, std::size_t from, std::size_t& outPos)
-{
-    if(size < 4 || from >= size - 3)
-        return false;
+                if(pos == rpos)
+                    return BodyResult::ERROR;
+
+                // Skip over extensions (if any), still validated so no CTLs sneak in
+                if(data[pos] != '\r') {
+                    if(data[pos] != ';' && data[pos] != ' ' && data[pos] != '\t')
+                        return BodyResult::ERROR;
+
+                    std::size_t searchEnd = std::min(size, rpos + MAX_CHUNK_LINE);
+                    const char* cr        = static_cast<const char*>(std::memchr(data + pos, '\r', searchEnd - pos));
+
+                    // CRLF might just not be here yet, but only as long as line is within 'MAX_CHUNK_LINE'
+                    if(!cr)
+                        return size - rpos >= MAX_CHUNK_LINE ? BodyResult::ERROR : BodyResult::INCOMPLETE;
+
+                    std::size_t crPos = static_cast<std::size_t>(cr - data);
+                    if(crPos + 1 >= size)
+                        return BodyResult::INCOMPLETE;
+
+                    // Scanner stops on the first CTL, which has to be this very CR
+                    std::size_t lineEnd = 0;
+                    if(!HttpScanner::ScanLine(data, size, pos, lineEnd))
+                        return BodyResult::ERROR;
+
+                    pos = crPos;
+                }
+
+                if(pos + 1 >= size)
+                    return BodyResult::INCOMPLETE;
+
+                if(data[pos + 1] != '\n')
+                    return BodyResult::ERROR;
+
+                // Size line stays unread, so decoding can pick up from here if limit gets raised
+                if(length > limit - state.decoded)
+                    return BodyResult::LIMIT;
+
+                rpos = pos + 2;
+
+                // Last chunk, only trailers (if any) are left
+                if(length == 0) {
+                    state.remaining = 0;
+                    state.phase     = CHUNK_TRAILER;
+                    break;
+                }
+
+                state.remaining = length;
+                state.phase     = CHUNK_DATA;
+                break;
+            }
+
+            case CHUNK_DATA:
+            case FIXED_DATA:
+            {
+                std::size_t available = static_cast<std::size_t>(std::min<std::uint64_t>(size - rpos, state.remaining));
 
-    const char* start = data + from;
-    const char* end   = data + size - 3;
+                if(wpos != rpos)
+                    std::memmove(data + wpos, data + rpos, available);
 
-    // I trust compiler to optimize this loop :)
-    for(const char* p = start; p < end; ++p) {
-        if(p[0] == '\r' && p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
-            outPos = static_cast<std::size_t>(p - data) + 4;
-            return true;
+                wpos            += available;
+                rpos            += available;
+                state.remaining -= available;
+                state.decoded   += available;
+
+                if(state.remaining > 0)
+                    return BodyResult::INCOMPLETE;
+
+                // Content-Length body has no framing around it, that was all of it
+                if(state.phase == FIXED_DATA) {
+                    state.phase = BODY_DONE;
+                    return BodyResult::DONE;
+                }
+
+                state.phase = CHUNK_DATA_CRLF;
+                break;
+            }
+
+            case CHUNK_DATA_CRLF:
+                if(size - rpos < 2)
+                    return BodyResult::INCOMPLETE;
+
+                if(data[rpos] != '\r' || data[rpos + 1] != '\n')
+                    return BodyResult::ERROR;
+
+                rpos        += 2;
+                state.phase  = CHUNK_SIZE;
+                break;
+
+            case CHUNK_TRAILER:
+            {
+                if(size - rpos < 2)
+                    return BodyResult::INCOMPLETE;
+
+                // Empty line, we are done
+                if(data[rpos] == '\r' && data[rpos + 1] == '\n') {
+                    rpos        += 2;
+                    state.phase  = BODY_DONE;
+                    return BodyResult::DONE;
+                }
+
+                // Trailers are validated like any other header and then dropped, nothing we care-
+                // -about is allowed in there anyways (RFC 9110 Section 6.5.1)
+                const char* lf = static_cast<const char*>(std::memchr(data + rpos, '\n', size - rpos));
+                if(!lf) {
+                    if(state.remaining + (size - rpos) > networkConfig.maxHeaderTotalSize)
+                        return BodyResult::ERROR;
+
+                    return BodyResult::INCOMPLETE;
+                }
+
+                std::size_t lineStop = static_cast<std::size_t>(lf - data) + 1;
+                std::size_t colon    = 0;
+                std::size_t lineEnd  = 0;
+
+                if(!HttpScanner::ScanHeaderLine(data, lineStop, rpos, colon, lineEnd))
+                    return BodyResult::ERROR;
+
+                state.remaining += lineStop - rpos;
+                if(state.remaining > networkConfig.maxHeaderTotalSize)
+                    return BodyResult::ERROR;
+
+                rpos = lineStop;
+                break;
+            }
+
+            case BODY_DONE:
+                return BodyResult::DONE;
+
+            default:
+                return BodyResult::ERROR;
         }
     }
-
-    return false;
 }
 
+// vvv Helpers vvv
 std::string_view Trim(std::string_view sv)
 {
     std::size_t start = 0;
@@ -342,6 +612,14 @@ std::string_view Trim(std::string_view sv)
     return sv.substr(start, end - start);
 }
 
+int HexValue(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
 } // namespace HttpParser
 
 } // namespace WFX::Http
\ No newline at end of file
@@ -7,6 +7,20 @@ namespace WFX::Http {
 
 namespace HttpParser {
     HttpParseState Parse(ConnectionContext* ctx);
+
+    // Decodes as much of a chunked / oversized body as read buffer has, in place (framing is squeezed out)
+    // Buffered: Body keeps growing right after the head, PARSE_SUCCESS once terminating chunk shows up-
+    //           -or PARSE_BODY_TOO_LARGE if it went over 'maxBodyTotalSize'
+    // Streamed: 'body' only has bytes decoded since last 'ConsumeStreamedBody' (PARSE_STREAMING_BODY)-
+    //           -so read buffer gets reused for the rest of it. Last piece comes with PARSE_SUCCESS
+    HttpParseState ParseStreamingBody(ConnectionContext* ctx, bool streamed = false);
+
+    // Drops streamed body bytes which were already handed over to whoever consumes them
+    void ConsumeStreamedBody(ConnectionContext* ctx);
+
+    // Whether a complete request head is already sitting in read buffer right after the-
+    // -one which was just parsed (HTTP/1.1 pipelining)
+    bool HasPipelinedRequest(ConnectionContext* ctx);
 } // namespace HttpParser
 
 } // namespace WFX::Http
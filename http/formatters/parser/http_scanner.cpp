@@ -0,0 +1,319 @@
+#include "http_scanner.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+// SIMD paths are compiled per function with target attributes, so the rest of the build doesn't-
+// -need any -m flags and older CPUs still run the scalar path just fine
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define WFX_SCANNER_X86 1
+    #include <immintrin.h>
+#endif
+
+namespace WFX::Http {
+
+namespace HttpScanner {
+
+// vvv Character Tables vvv
+namespace {
+
+// RFC 9110 tchar: "!#$%&'*+-.^_`|~" / DIGIT / ALPHA
+constexpr bool IsTChar(unsigned char c)
+{
+    if((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+        return true;
+
+    switch(c) {
+        case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
+        case '+': case '-': case '.': case '^': case '_': case '`':  case '|': case '~':
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Bytes which end a header name (anything which isn't a tchar)
+constexpr bool IsNameStop(unsigned char c)
+{
+    return !IsTChar(c);
+}
+
+// Bytes which end a header value / line (CTLs except HTAB, and DEL). obs-text (>= 0x80) is fine
+constexpr bool IsValueStop(unsigned char c)
+{
+    return (c < 0x20 && c != '\t') || c == 0x7F;
+}
+
+struct StopTable {
+    bool stop[256] = {};
+};
+
+// Membership of an ASCII byte 'b' is (lo[b & 0xF] & hi[b >> 4]) != 0, one bit per high nibble row
+// Which is exact for any set of ASCII bytes, bytes >= 0x80 are handled using their sign bit
+struct NibbleLut {
+    alignas(16) std::uint8_t lo[16] = {};
+    alignas(16) std::uint8_t hi[16] = {};
+    bool highIsStop = false;
+};
+
+template<typename Pred>
+constexpr StopTable MakeStopTable(Pred isStop)
+{
+    StopTable table{};
+    for(int c = 0; c < 256; c++)
+        table.stop[c] = isStop(static_cast<unsigned char>(c));
+    return table;
+}
+
+template<typename Pred>
+constexpr NibbleLut MakeNibbleLut(Pred isStop)
+{
+    NibbleLut lut{};
+    for(int row = 0; row < 8; row++) {
+        lut.hi[row] = static_cast<std::uint8_t>(1u << row);
+
+        for(int col = 0; col < 16; col++)
+            if(isStop(static_cast<unsigned char>((row << 4) | col)))
+                lut.lo[col] |= static_cast<std::uint8_t>(1u << row);
+    }
+    lut.highIsStop = isStop(0x80);
+    return lut;
+}
+
+constexpr StopTable NAME_STOP_TABLE  = MakeStopTable(IsNameStop);
+constexpr StopTable VALUE_STOP_TABLE = MakeStopTable(IsValueStop);
+constexpr NibbleLut NAME_STOP_LUT    = MakeNibbleLut(IsNameStop);
+constexpr NibbleLut VALUE_STOP_LUT   = MakeNibbleLut(IsValueStop);
+
+// vvv Scalar Implementations vvv
+const char* FindStopScalar(const char* p, const char* end, const NibbleLut&, const StopTable& table)
+{
+    for(; p < end; ++p)
+        if(table.stop[static_cast<unsigned char>(*p)])
+            return p;
+    return end;
+}
+
+const char* FindHeaderEndScalar(const char* p, const char* end)
+{
+    // 'end' points 3 bytes before the real end, so p[3] is always valid
+    for(; p < end; ++p) {
+        p = static_cast<const char*>(std::memchr(p, '\r', end - p));
+        if(!p)
+            return nullptr;
+
+        if(p[1] == '\n' && p[2] == '\r' && p[3] == '\n')
+            return p;
+    }
+    return nullptr;
+}
+
+// vvv SSE4.2 Implementations vvv
+#ifdef WFX_SCANNER_X86
+__attribute__((target("sse4.2")))
+const char* FindStopSSE42(const char* p, const char* end, const NibbleLut& lut, const StopTable& table)
+{
+    const __m128i loTbl = _mm_load_si128(reinterpret_cast<const __m128i*>(lut.lo));
+    const __m128i hiTbl = _mm_load_si128(reinterpret_cast<const __m128i*>(lut.hi));
+    const __m128i nib   = _mm_set1_epi8(0x0F);
+    const __m128i zero  = _mm_setzero_si128();
+
+    for(; p + 16 <= end; p += 16) {
+        __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i lo = _mm_and_si128(v, nib);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nib);
+        __m128i m  = _mm_and_si128(_mm_shuffle_epi8(loTbl, lo), _mm_shuffle_epi8(hiTbl, hi));
+
+        std::uint32_t stops = ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero))) & 0xFFFFu;
+        if(lut.highIsStop)
+            stops |= static_cast<std::uint32_t>(_mm_movemask_epi8(v));
+
+        if(stops)
+            return p + __builtin_ctz(stops);
+    }
+
+    return FindStopScalar(p, end, lut, table);
+}
+
+__attribute__((target("sse4.2")))
+const char* FindHeaderEndSSE42(const char* p, const char* end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    // 'end' points 3 bytes before the real end, so loads at p + 3 stay in bounds
+    for(; p + 16 <= end; p += 16) {
+        __m128i m = _mm_and_si128(
+            _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),     cr),
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1)), lf)
+            ),
+            _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2)), cr),
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3)), lf)
+            )
+        );
+
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+        if(mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return FindHeaderEndScalar(p, end);
+}
+
+// vvv AVX2 Implementations vvv
+__attribute__((target("avx2")))
+const char* FindStopAVX2(const char* p, const char* end, const NibbleLut& lut, const StopTable& table)
+{
+    const __m256i loTbl = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lut.lo)));
+    const __m256i hiTbl = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lut.hi)));
+    const __m256i nib   = _mm256_set1_epi8(0x0F);
+    const __m256i zero  = _mm256_setzero_si256();
+
+    for(; p + 32 <= end; p += 32) {
+        __m256i v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i lo = _mm256_and_si256(v, nib);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nib);
+        __m256i m  = _mm256_and_si256(_mm256_shuffle_epi8(loTbl, lo), _mm256_shuffle_epi8(hiTbl, hi));
+
+        std::uint32_t stops = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(m, zero)));
+        if(lut.highIsStop)
+            stops |= static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+
+        if(stops)
+            return p + __builtin_ctz(stops);
+    }
+
+    // Most header values are short, so the 16 byte path still has work to do for the tail
+    return FindStopSSE42(p, end, lut, table);
+}
+
+__attribute__((target("avx2")))
+const char* FindHeaderEndAVX2(const char* p, const char* end)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    for(; p + 32 <= end; p += 32) {
+        __m256i m = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),     cr),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1)), lf)
+            ),
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2)), cr),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3)), lf)
+            )
+        );
+
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+        if(mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return FindHeaderEndSSE42(p, end);
+}
+#endif // WFX_SCANNER_X86
+
+// vvv Runtime Dispatch vvv
+struct ScannerImpl {
+    const char* (*findStop)(const char*, const char*, const NibbleLut&, const StopTable&) = FindStopScalar;
+    const char* (*findHeaderEnd)(const char*, const char*)                                = FindHeaderEndScalar;
+    const char* name                                                                      = "scalar";
+};
+
+ScannerImpl SelectImpl()
+{
+    ScannerImpl impl{};
+
+#ifdef WFX_SCANNER_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        impl.findStop      = FindStopAVX2;
+        impl.findHeaderEnd = FindHeaderEndAVX2;
+        impl.name          = "avx2";
+    }
+    else if(__builtin_cpu_supports("sse4.2")) {
+        impl.findStop      = FindStopSSE42;
+        impl.findHeaderEnd = FindHeaderEndSSE42;
+        impl.name          = "sse4.2";
+    }
+#endif
+
+    return impl;
+}
+
+const ScannerImpl& GetImpl()
+{
+    static const ScannerImpl impl = SelectImpl();
+    return impl;
+}
+
+} // namespace
+
+// vvv Main Functions vvv
+bool FindHeaderEnd(const char* data, std::size_t size, std::size_t from, std::size_t& outPos)
+{
+    if(size < 4 || from >= size - 3)
+        return false;
+
+    // Search range is shrunk by 3 so every candidate can look ahead without bounds checks
+    const char* match = GetImpl().findHeaderEnd(data + from, data + size - 3);
+    if(!match)
+        return false;
+
+    outPos = static_cast<std::size_t>(match - data) + 4;
+    return true;
+}
+
+bool ScanLine(const char* data, std::size_t size, std::size_t from, std::size_t& outLineEnd)
+{
+    if(from >= size)
+        return false;
+
+    const char* end = data + size;
+    const char* cr  = GetImpl().findStop(data + from, end, VALUE_STOP_LUT, VALUE_STOP_TABLE);
+
+    // First CTL must be the CR of a CRLF, anything else (bare LF, NUL, ...) is malformed
+    if(cr + 1 >= end || cr[0] != '\r' || cr[1] != '\n')
+        return false;
+
+    outLineEnd = static_cast<std::size_t>(cr - data);
+    return true;
+}
+
+bool ScanHeaderLine(const char* data, std::size_t size, std::size_t from,
+                        std::size_t& outColon, std::size_t& outLineEnd)
+{
+    if(from >= size)
+        return false;
+
+    auto&       impl  = GetImpl();
+    const char* start = data + from;
+    const char* end   = data + size;
+
+    // Name: tchar run which has to end exactly at ':' (no whitespace before colon either, RFC 9112)
+    const char* colon = impl.findStop(start, end, NAME_STOP_LUT, NAME_STOP_TABLE);
+    if(colon == start || colon == end || *colon != ':')
+        return false;
+
+    // Value: Anything but CTLs till CRLF
+    const char* cr = impl.findStop(colon + 1, end, VALUE_STOP_LUT, VALUE_STOP_TABLE);
+    if(cr + 1 >= end || cr[0] != '\r' || cr[1] != '\n')
+        return false;
+
+    outColon   = static_cast<std::size_t>(colon - data);
+    outLineEnd = static_cast<std::size_t>(cr - data);
+    return true;
+}
+
+const char* GetImplName()
+{
+    return GetImpl().name;
+}
+
+} // namespace HttpScanner
+
+} // namespace WFX::Http
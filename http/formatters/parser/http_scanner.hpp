@@ -0,0 +1,32 @@
+#ifndef WFX_HTTP_SCANNER_HPP
+#define WFX_HTTP_SCANNER_HPP
+
+#include <cstddef>
+
+// Vectorized scanning primitives for HTTP/1.x request heads
+// Picks the widest implementation the CPU supports at runtime (AVX2 -> SSE4.2 -> Scalar)
+// Every function validates characters while it searches, so there is no second pass
+
+namespace WFX::Http {
+
+namespace HttpScanner {
+    // Finds "\r\n\r\n" starting at 'from', 'outPos' is the index right after it
+    bool FindHeaderEnd(const char* data, std::size_t size, std::size_t from, std::size_t& outPos);
+
+    // Finds the CRLF ending the line at 'from', rejects CTLs (except HTAB) on the way
+    // 'outLineEnd' is the index of '\r'
+    bool ScanLine(const char* data, std::size_t size, std::size_t from, std::size_t& outLineEnd);
+
+    // Scans a single 'Name: Value\r\n' line in one go
+    // Name must be a non empty token ending at ':', value must not have any CTLs (except HTAB)
+    // 'outColon' is the index of ':', 'outLineEnd' is the index of '\r'
+    bool ScanHeaderLine(const char* data, std::size_t size, std::size_t from,
+                            std::size_t& outColon, std::size_t& outLineEnd);
+
+    // "avx2", "sse4.2" or "scalar", mostly for logs / benchmarks
+    const char* GetImplName();
+} // namespace HttpScanner
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_SCANNER_HPP
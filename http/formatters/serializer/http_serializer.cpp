@@ -4,24 +4,62 @@
 #include "utils/crypt/string.hpp"
 #include "utils/fileops/filesystem.hpp"
 
+#include <cstring>
+
 namespace WFX::Http {
 
 namespace HttpSerializer {
 
-SerializedHttpResponse SerializeToBuffer(HttpResponse& res, RWBuffer& buffer)
-{
-    auto& networkConfig = WFX::Core::Config::GetInstance().networkConfig;
+// vvv Internal Helpers vvv
+namespace {
+
+// Writes the logical '[status line][headers]\r\n' stream into whatever space write buffer has left
+// Skips the first 'res.serializeCursor' bytes (already sent earlier) and stops once buffer is full
+// So calling it again after buffer got flushed continues exactly where it stopped
+class HeaderEmitter {
+public:
+    HeaderEmitter(RWBuffer& buffer, std::uint32_t skip)
+        : buffer_(buffer), skip_(skip)
+    {}
+
+    void Emit(const char* data, std::size_t len)
+    {
+        if(full_)
+            return;
+
+        // Already serialized in an earlier call, skip it
+        if(pos_ + len <= skip_) {
+            pos_ += len;
+            return;
+        }
+
+        std::size_t start = skip_ > pos_ ? skip_ - pos_ : 0;
+        ValidRegion region = buffer_.GetWritableWriteRegion();
+        std::size_t count  = std::min(len - start, region.len);
+
+        if(count > 0) {
+            std::memcpy(region.ptr, data + start, count);
+            buffer_.GetWriteMeta()->dataLength += static_cast<std::uint32_t>(count);
+        }
+
+        pos_ += start + count;
+        full_ = (start + count) < len;
+    }
 
-    // Ensure write buffer is initialized
-    if(!buffer.IsWriteInitialized() && !buffer.InitWriteBuffer(networkConfig.maxSendBufferSize))
-        return {SerializeResult::SERIALIZE_BUFFER_FAILED, {}};
+    bool          IsFull()   const { return full_; }
+    std::uint32_t Position() const { return static_cast<std::uint32_t>(pos_); }
 
-    auto* meta = buffer.GetWriteMeta();
-    if(!meta)
-        return {SerializeResult::SERIALIZE_BUFFER_FAILED, {}};
+private:
+    RWBuffer&     buffer_;
+    std::size_t   skip_ = 0;
+    std::size_t   pos_  = 0;
+    bool          full_ = false;
+};
 
+std::string_view GetBodyView(const HttpResponse& res)
+{
     // We use std::string_view to ref the data inside the variant without copying it
-    std::string_view bodyView = std::visit([](auto&& val) -> std::string_view {
+    return std::visit([](auto&& val) -> std::string_view {
         using T = std::decay_t<decltype(val)>;
         if constexpr(std::is_same_v<T, std::string_view>)
             return val;
@@ -30,58 +68,110 @@ SerializedHttpResponse SerializeToBuffer(HttpResponse& res, RWBuffer& buffer)
         else
             return {}; // std::monostate, StreamGenerator
     }, res.body);
+}
 
-    // Calculate total header size
-    std::string_view reason = HttpStatusToReason(res.status);
-    std::size_t headerSize = 9 + 3 + 1 + reason.size() + 2; 
+SerializeResult SerializeHeadersAndBody(HttpResponse& res, RWBuffer& buffer, std::string_view bodyView)
+{
+    auto* meta = buffer.GetWriteMeta();
 
-    // Headers: "Key: Value\r\n"
-    for(const auto& [k, v] : res.headers.GetHeaderMap())
-        headerSize += k.size() + 2 + v.size() + 2;
-    // Final "\r\n"
-    headerSize += 2;
+    // Not even a single byte can go in, no progress possible
+    if(meta->dataLength >= meta->bufferSize)
+        return SerializeResult::SERIALIZE_BUFFER_TOO_SMALL;
+
+    HeaderEmitter emitter{buffer, res.serializeCursor};
 
-    // Determine Total Size needed in buffer
-    bool        includeBody = !res.IsFileOperation() && !res.IsStreamOperation();
-    std::size_t totalSize   = headerSize + (includeBody ? bodyView.size() : 0);
+    // Status line
+    std::string_view reason = HttpStatusToReason(res.status);
 
-    if(totalSize > meta->bufferSize)
-        return {SerializeResult::SERIALIZE_BUFFER_TOO_SMALL, {}};
+    emitter.Emit("HTTP/1.", 7);
+    emitter.Emit(res.version == HttpVersion::HTTP_1_1 ? "1 " : "0 ", 2);
 
-    // Serialize the response
-    buffer.AppendData("HTTP/1.", 7);
-    buffer.AppendData(res.version == HttpVersion::HTTP_1_1 ? "1 " : "0 ", 2);
-    
     std::uint16_t code = static_cast<std::uint16_t>(res.status);
     char codeStr[4];
     codeStr[0] = '0' + (code / 100);
     codeStr[1] = '0' + ((code / 10) % 10);
     codeStr[2] = '0' + (code % 10);
     codeStr[3] = ' ';
-    buffer.AppendData(codeStr, 4);
-    
-    buffer.AppendData(reason.data(), static_cast<uint32_t>(reason.size()));
-    buffer.AppendData("\r\n", 2);
-
-    // Headers
-    for(const auto& [k, v] : res.headers.GetHeaderMap()) {
-        buffer.AppendData(k.data(), static_cast<uint32_t>(k.size()));
-        buffer.AppendData(": ", 2);
-        buffer.AppendData(v.data(), static_cast<uint32_t>(v.size()));
-        buffer.AppendData("\r\n", 2);
+    emitter.Emit(codeStr, 4);
+
+    emitter.Emit(reason.data(), reason.size());
+    emitter.Emit("\r\n", 2);
+
+    // Headers are already stored as "Key: Value\r\n" lines back to back, one copy does it
+    // NOTE: Headers are not touched between calls, so the block is the same when resuming
+    std::string_view headerBlock = res.headers.GetSerialized();
+    emitter.Emit(headerBlock.data(), headerBlock.size());
+
+    // Final "\r\n"
+    emitter.Emit("\r\n", 2);
+
+    // Buffer filled up before headers finished, remember how far we got
+    if(emitter.IsFull()) {
+        res.serializeCursor = emitter.Position();
+        return SerializeResult::SERIALIZE_BUFFER_INSUFFICIENT;
     }
 
-    buffer.AppendData("\r\n", 2);
+    res.serializeCursor = 0;
 
-    if(includeBody && !bodyView.empty()) {
-        buffer.AppendData(bodyView.data(), static_cast<uint32_t>(bodyView.size()));
-        return {SerializeResult::SERIALIZE_SUCCESS, {}};
+    bool includeBody = !res.skipBody && !res.IsFileOperation() && !res.IsStreamOperation();
+    if(!includeBody || bodyView.empty())
+        return SerializeResult::SERIALIZE_SUCCESS;
+
+    // Body gets copied in only if it fits alongside headers, anything bigger stays where it-
+    // -is (inside of 'res.body') and is gather written after headers
+    // 'res.body' outlives the write, response is only cleared once everything is sent
+    if(bodyView.size() <= meta->bufferSize - meta->dataLength) {
+        buffer.AppendData(bodyView.data(), static_cast<std::uint32_t>(bodyView.size()));
+        return SerializeResult::SERIALIZE_SUCCESS;
     }
 
-    if(!includeBody)
-        return {SerializeResult::SERIALIZE_SUCCESS, std::string(bodyView)};
+    // Body length is tracked in 32 bits by write buffer
+    if(bodyView.size() > UINT32_MAX)
+        return SerializeResult::SERIALIZE_BUFFER_TOO_SMALL;
+
+    buffer.AttachBody(bodyView.data(), static_cast<std::uint32_t>(bodyView.size()));
+    return SerializeResult::SERIALIZE_SUCCESS;
+}
+
+} // namespace
+
+// vvv Main Functions vvv
+SerializedHttpResponse SerializeToBuffer(HttpResponse& res, RWBuffer& buffer)
+{
+    auto& networkConfig = WFX::Core::Config::GetInstance().networkConfig;
+
+    // Ensure write buffer is initialized
+    if(!buffer.IsWriteInitialized() && !buffer.InitWriteBuffer(networkConfig.maxSendBufferSize))
+        return {SerializeResult::SERIALIZE_BUFFER_FAILED, {}};
+
+    if(!buffer.GetWriteMeta())
+        return {SerializeResult::SERIALIZE_BUFFER_FAILED, {}};
+
+    // Fresh response, start from the very beginning
+    res.serializeCursor = 0;
+
+    std::string_view bodyView = GetBodyView(res);
+    SerializeResult  result   = SerializeHeadersAndBody(res, buffer, bodyView);
+
+    // For file operations, body holds the path, caller needs it
+    bool includeBody = !res.IsFileOperation() && !res.IsStreamOperation();
+    if(!includeBody && result != SerializeResult::SERIALIZE_BUFFER_TOO_SMALL)
+        return {result, std::string(bodyView)};
+
+    return {result, {}};
+}
+
+SerializeResult ResumeSerialize(HttpResponse& res, RWBuffer& buffer)
+{
+    auto* meta = buffer.GetWriteMeta();
+    if(!meta)
+        return SerializeResult::SERIALIZE_BUFFER_FAILED;
+
+    // Previous part is already out on the wire, reuse the whole buffer
+    meta->dataLength    = 0;
+    meta->writtenLength = 0;
 
-    return {SerializeResult::SERIALIZE_SUCCESS, {}};
+    return SerializeHeadersAndBody(res, buffer, GetBodyView(res));
 }
 
 } // namespace HttpSerializer
@@ -11,14 +11,15 @@ using namespace WFX::Utils; // For 'RWBuffer'
 enum class SerializeResult : std::uint8_t {
     SERIALIZE_SUCCESS,
     SERIALIZE_BUFFER_FAILED,      // Allocation failed, buffer is nullptr
-    SERIALIZE_BUFFER_TOO_SMALL,   // No data yet buffer is too small to hold data
-    SERIALIZE_BUFFER_INSUFFICIENT // Buffer is too small to hold the serialized data
+    SERIALIZE_BUFFER_TOO_SMALL,   // Buffer has no room at all / body too large to be tracked
+    SERIALIZE_BUFFER_INSUFFICIENT // Buffer got filled up, send it and call 'ResumeSerialize' for the rest
 };
 
 using SerializedHttpResponse = std::pair<SerializeResult, std::string>;
 
 namespace HttpSerializer {
     SerializedHttpResponse SerializeToBuffer(HttpResponse& res, RWBuffer& buffer);
+    SerializeResult        ResumeSerialize(HttpResponse& res, RWBuffer& buffer);
 } // namespace HttpSerializer
 
 } // namespace WFX::Http
@@ -0,0 +1,168 @@
+#include "http_headers.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace WFX::Http {
+
+using namespace WFX::Utils; // For 'StringCanonical'
+
+// vvv Response Headers vvv
+ResponseHeaders::ResponseHeaders()
+{
+    // Most responses carry around 4-8 headers, reserve once so a connection doesn't keep-
+    // -allocating for every response it sends
+    block_.reserve(512);
+    entries_.reserve(12);
+}
+
+void ResponseHeaders::SetHeader(std::string_view key, std::string_view value)
+{
+    char* line = ReserveLine(key, key.size() + value.size() + 4);
+
+    std::memcpy(line, key.data(), key.size());
+    line += key.size();
+    std::memcpy(line, ": ", 2);
+    line += 2;
+    std::memcpy(line, value.data(), value.size());
+    line += value.size();
+    std::memcpy(line, "\r\n", 2);
+}
+
+bool ResponseHeaders::HasHeader(std::string_view key) const noexcept
+{
+    return FindEntry(key) >= 0;
+}
+
+std::string_view ResponseHeaders::GetHeader(std::string_view key) const noexcept
+{
+    std::int64_t idx = FindEntry(key);
+    return idx >= 0 ? ValueOf(entries_[idx]) : std::string_view{};
+}
+
+void ResponseHeaders::RemoveHeader(std::string_view key) noexcept
+{
+    std::int64_t idx = FindEntry(key);
+    if(idx < 0)
+        return;
+
+    HeaderEntry removed = entries_[idx];
+    block_.erase(removed.offset, removed.lineLen);
+    entries_.erase(entries_.begin() + idx);
+
+    // Everything after the removed line just moved back
+    for(std::size_t i = idx; i < entries_.size(); i++)
+        entries_[i].offset -= removed.lineLen;
+}
+
+void ResponseHeaders::Clear() noexcept
+{
+    // Both keep their capacity, so this is pretty much free
+    block_.clear();
+    entries_.clear();
+}
+
+void ResponseHeaders::SetHeaderLine(std::string_view line)
+{
+    std::size_t colon = line.find(':');
+    if(colon == std::string_view::npos || line.size() < colon + 4)
+        return;
+
+    std::memcpy(ReserveLine(line.substr(0, colon), line.size()), line.data(), line.size());
+}
+
+void ResponseHeaders::SetHeaderLines(std::string_view lines)
+{
+    while(!lines.empty()) {
+        std::size_t end = lines.find("\r\n");
+        if(end == std::string_view::npos)
+            return;
+
+        SetHeaderLine(lines.substr(0, end + 2));
+        lines.remove_prefix(end + 2);
+    }
+}
+
+void ResponseHeaders::SetContentLength(std::uint64_t length)
+{
+    constexpr std::string_view prefix = "Content-Length: ";
+
+    char digits[20];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), length);
+    std::size_t digitLen = static_cast<std::size_t>(end - digits);
+
+    char* line = ReserveLine(prefix.substr(0, prefix.size() - 2), prefix.size() + digitLen + 2);
+
+    std::memcpy(line, prefix.data(), prefix.size());
+    line += prefix.size();
+    std::memcpy(line, digits, digitLen);
+    line += digitLen;
+    std::memcpy(line, "\r\n", 2);
+}
+
+std::string_view ResponseHeaders::GetSerialized() const noexcept
+{
+    return block_;
+}
+
+std::size_t ResponseHeaders::Size() const noexcept
+{
+    return entries_.size();
+}
+
+// vvv Helper Functions vvv
+char* ResponseHeaders::ReserveLine(std::string_view key, std::size_t lineLen)
+{
+    std::int64_t idx = FindEntry(key);
+
+    // New header, goes at the very end
+    if(idx < 0) {
+        std::uint32_t offset = static_cast<std::uint32_t>(block_.size());
+        block_.resize(block_.size() + lineLen);
+        entries_.push_back({offset, static_cast<std::uint32_t>(lineLen), static_cast<std::uint16_t>(key.size())});
+        return block_.data() + offset;
+    }
+
+    // Overwriting existing header, resize its line in place and shift whatever comes after
+    HeaderEntry& entry = entries_[idx];
+    std::uint32_t oldLen = entry.lineLen;
+
+    if(lineLen > oldLen)
+        block_.insert(entry.offset + oldLen, lineLen - oldLen, '\0');
+    else if(lineLen < oldLen)
+        block_.erase(entry.offset + lineLen, oldLen - lineLen);
+
+    entry.lineLen = static_cast<std::uint32_t>(lineLen);
+    entry.keyLen  = static_cast<std::uint16_t>(key.size());
+
+    std::int64_t delta = static_cast<std::int64_t>(lineLen) - oldLen;
+    for(std::size_t i = idx + 1; i < entries_.size(); i++)
+        entries_[i].offset = static_cast<std::uint32_t>(entries_[i].offset + delta);
+
+    return block_.data() + entry.offset;
+}
+
+std::int64_t ResponseHeaders::FindEntry(std::string_view key) const noexcept
+{
+    // Few entries, linear scan beats hashing here
+    for(std::size_t i = 0; i < entries_.size(); i++) {
+        const HeaderEntry& entry = entries_[i];
+        if(entry.keyLen == key.size() && StringCanonical::InsensitiveStringCompare(KeyOf(entry), key))
+            return static_cast<std::int64_t>(i);
+    }
+
+    return -1;
+}
+
+std::string_view ResponseHeaders::KeyOf(const HeaderEntry& entry) const noexcept
+{
+    return std::string_view{block_.data() + entry.offset, entry.keyLen};
+}
+
+std::string_view ResponseHeaders::ValueOf(const HeaderEntry& entry) const noexcept
+{
+    // Line is "Key: Value\r\n", so skip key + ": " and drop the trailing "\r\n"
+    return std::string_view{block_.data() + entry.offset + entry.keyLen + 2, entry.lineLen - entry.keyLen - 4u};
+}
+
+} // namespace WFX::Http
@@ -1,51 +1,150 @@
 #ifndef WFX_HTTP_HEADERS_HPP
 #define WFX_HTTP_HEADERS_HPP
 
-#include "utils/crypt/hash.hpp"
 #include "utils/crypt/string.hpp"
 
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace WFX::Http {
 
-struct CaseInsensitiveHash {
-    template<typename T>
-    std::size_t operator()(const T& key) const;
+// --- Request Headers ---
+// Headers which the engine itself looks at, resolved once at parse time so lookups later on-
+// -are just an indexed load instead of hashing the name again
+enum class KnownHeader : std::uint8_t {
+    HOST,
+    CONTENT_LENGTH,
+    CONNECTION,
+    TRANSFER_ENCODING,
+    EXPECT,
+    CONTENT_TYPE,
+    COOKIE,
+    ACCEPT_ENCODING,
+    IF_NONE_MATCH,
+    IF_MODIFIED_SINCE,
+    RANGE,
+    IF_RANGE,
+    UNKNOWN // Also acts as the count of known headers
 };
 
-struct CaseInsensitiveEqual {
-    template<typename T1, typename T2>
-    bool operator()(const T1& lhs, const T2& rhs) const;
+KnownHeader KnownHeaderToEnum(std::string_view name) noexcept;
+
+// Flat header table for requests, keys and values are views into the read buffer
+// Known headers live in fixed slots, everything else goes into a small inline array and only-
+// -spills into 'overflow_' past that. Clear() is just resetting counters, so once warmed up a-
+// -connection never allocates for headers again
+class RequestHeaders {
+public:
+    struct HeaderEntry {
+        std::string_view key;
+        std::string_view value;
+    };
+
+    using HeaderResult = std::pair<bool, const std::string_view*>;
+
+    // Typical browser requests carry 10-20 headers, a handful of which are known ones
+    static constexpr std::size_t INLINE_CAPACITY = 16;
+    static constexpr std::size_t KNOWN_COUNT     = static_cast<std::size_t>(KnownHeader::UNKNOWN);
+
+public:
+    void             SetHeader(std::string_view key, std::string_view value);
+    bool             HasHeader(std::string_view key)         const noexcept;
+    std::string_view GetHeader(std::string_view key)         const noexcept;
+    HeaderResult     CheckAndGetHeader(std::string_view key) const noexcept;
+    void             RemoveHeader(std::string_view key)            noexcept;
+    void             Clear()                                       noexcept;
+
+public: // Known header fast paths
+    bool             HasHeader(KnownHeader id)         const noexcept;
+    std::string_view GetHeader(KnownHeader id)         const noexcept;
+    HeaderResult     CheckAndGetHeader(KnownHeader id) const noexcept;
+
+public: // Iteration
+    std::size_t Size() const noexcept;
+
+    // Calls 'fn(key, value)' for every header, known headers first
+    template<typename Fn>
+    void ForEach(Fn&& fn) const;
+
+private:
+    HeaderEntry*       FindOther(std::string_view key)       noexcept;
+    const HeaderEntry* FindOther(std::string_view key) const noexcept;
+    HeaderEntry&       OtherAt(std::size_t idx)              noexcept;
+    const HeaderEntry& OtherAt(std::size_t idx)        const noexcept;
+
+private:
+    HeaderEntry              known_[KNOWN_COUNT];
+    std::uint16_t            knownMask_  = 0; // Bit per known header, values can legally be empty
+    std::uint16_t            otherCount_ = 0;
+    HeaderEntry              inline_[INLINE_CAPACITY];
+    std::vector<HeaderEntry> overflow_;       // Keeps its capacity across Clear()
 };
 
-// --- Generic HttpHeaders ---
-template<typename KeyType, typename ValType>
-class HttpHeaders {
+static_assert(RequestHeaders::KNOWN_COUNT <= 16, "RequestHeaders::knownMask_ needs to be widened");
+
+// --- Response Headers ---
+// Response headers are stored already serialized ("Key: Value\r\n" back to back) in a single-
+// -byte block which is reused across requests, with a small index on the side for lookups
+// Serializer copies the block as is, so header order is simply the order they were set in
+class ResponseHeaders {
 public:
-    using HeaderMapType = std::unordered_map<KeyType, ValType, CaseInsensitiveHash, CaseInsensitiveEqual>;
-    using HeaderResult  = std::pair<bool, const ValType*>;
+    ResponseHeaders();
 
-    HttpHeaders();
+public:
+    void             SetHeader(std::string_view key, std::string_view value);
+    bool             HasHeader(std::string_view key)    const noexcept;
+    std::string_view GetHeader(std::string_view key)    const noexcept;
+    void             RemoveHeader(std::string_view key)       noexcept;
+    void             Clear()                                  noexcept;
 
-    void         SetHeader(KeyType key, ValType value);
-    bool         HasHeader(const KeyType& key) const;
-    ValType      GetHeader(const KeyType& key) const;
-    HeaderResult CheckAndGetHeader(const KeyType& key) const;
-    void         RemoveHeader(const KeyType& key);
-    void         Clear();
+public: // Fast paths for the stuff engine sets on pretty much every response
+    // 'line' must be a complete "Key: Value\r\n", mostly meant for constants in 'HeaderLine'
+    void SetHeaderLine(std::string_view line);
+    // Bunch of complete lines back to back, each one ends up as its own header
+    void SetHeaderLines(std::string_view lines);
+    void SetContentLength(std::uint64_t length);
+
+public: // Serialization
+    // Every header line back to back, size of this is the exact serialized size
+    std::string_view GetSerialized() const noexcept;
+    std::size_t      Size()          const noexcept;
+
+    // Calls 'fn(key, value)' for every header in the order they were set
+    template<typename Fn>
+    void ForEach(Fn&& fn) const;
+
+private:
+    struct HeaderEntry {
+        std::uint32_t offset;  // Start of the line in 'block_'
+        std::uint32_t lineLen; // Including ": " and "\r\n"
+        std::uint16_t keyLen;
+    };
 
-    HeaderMapType& GetHeaderMap();
-    const HeaderMapType& GetHeaderMap() const;
+    // Makes room for a 'lineLen' byte line for 'key' and returns where it starts
+    // Existing header is resized in place so its position (and header order) is kept
+    char*            ReserveLine(std::string_view key, std::size_t lineLen);
+    std::int64_t     FindEntry(std::string_view key) const noexcept;
+    std::string_view KeyOf(const HeaderEntry& entry)   const noexcept;
+    std::string_view ValueOf(const HeaderEntry& entry) const noexcept;
 
 private:
-    HeaderMapType headers_;
+    std::string              block_;
+    std::vector<HeaderEntry> entries_;
 };
 
-// vvv Type Aliases vvv
-using RequestHeaders  = HttpHeaders<std::string_view, std::string_view>;
-using ResponseHeaders = HttpHeaders<std::string, std::string>;
+// Pre-serialized header lines for ResponseHeaders::SetHeaderLine
+namespace HeaderLine {
+    constexpr std::string_view CONTENT_TYPE_PLAIN = "Content-Type: text/plain\r\n";
+    constexpr std::string_view CONTENT_TYPE_JSON  = "Content-Type: application/json\r\n";
+    constexpr std::string_view CONTENT_TYPE_HTML  = "Content-Type: text/html\r\n";
+    constexpr std::string_view TRANSFER_CHUNKED   = "Transfer-Encoding: chunked\r\n";
+    constexpr std::string_view ACCEPT_RANGES      = "Accept-Ranges: bytes\r\n";
+    constexpr std::string_view VARY_ENCODING      = "Vary: Accept-Encoding\r\n";
+    constexpr std::string_view CONNECTION_KEEP    = "Connection: keep-alive\r\n";
+    constexpr std::string_view CONNECTION_CLOSE   = "Connection: close\r\n";
+} // namespace HeaderLine
 
 } // namespace WFX::Http
 
@@ -1,88 +1,185 @@
-
 namespace WFX::Http {
 
-template<typename T>
-std::size_t CaseInsensitiveHash::operator()(const T& key) const
+// vvv Request Headers vvv
+inline KnownHeader KnownHeaderToEnum(std::string_view name) noexcept
+{
+    using WFX::Utils::StringCanonical::InsensitiveStringCompare;
+
+    // Length alone narrows it down to a single candidate (except for 6 and 17), so at most two compares
+    switch(name.size()) {
+        case 4:
+            return InsensitiveStringCompare(name, "Host") ? KnownHeader::HOST : KnownHeader::UNKNOWN;
+        case 5:
+            return InsensitiveStringCompare(name, "Range") ? KnownHeader::RANGE : KnownHeader::UNKNOWN;
+        case 6:
+            if(InsensitiveStringCompare(name, "Expect"))
+                return KnownHeader::EXPECT;
+            return InsensitiveStringCompare(name, "Cookie") ? KnownHeader::COOKIE : KnownHeader::UNKNOWN;
+        case 8:
+            return InsensitiveStringCompare(name, "If-Range") ? KnownHeader::IF_RANGE : KnownHeader::UNKNOWN;
+        case 10:
+            return InsensitiveStringCompare(name, "Connection") ? KnownHeader::CONNECTION : KnownHeader::UNKNOWN;
+        case 12:
+            return InsensitiveStringCompare(name, "Content-Type") ? KnownHeader::CONTENT_TYPE : KnownHeader::UNKNOWN;
+        case 13:
+            return InsensitiveStringCompare(name, "If-None-Match") ? KnownHeader::IF_NONE_MATCH : KnownHeader::UNKNOWN;
+        case 14:
+            return InsensitiveStringCompare(name, "Content-Length") ? KnownHeader::CONTENT_LENGTH : KnownHeader::UNKNOWN;
+        case 15:
+            return InsensitiveStringCompare(name, "Accept-Encoding") ? KnownHeader::ACCEPT_ENCODING : KnownHeader::UNKNOWN;
+        case 17:
+            if(InsensitiveStringCompare(name, "Transfer-Encoding"))
+                return KnownHeader::TRANSFER_ENCODING;
+            return InsensitiveStringCompare(name, "If-Modified-Since") ? KnownHeader::IF_MODIFIED_SINCE : KnownHeader::UNKNOWN;
+        default:
+            return KnownHeader::UNKNOWN;
+    }
+}
+
+inline void RequestHeaders::SetHeader(std::string_view key, std::string_view value)
 {
-    static_assert(
-        std::is_same_v<std::decay_t<T>, std::string> ||
-        std::is_same_v<std::decay_t<T>, std::string_view>,
-        "CaseInsensitiveHash: key must be std::string or std::string_view"
-    );
-    return WFX::Utils::Hasher::Fnv1aCaseInsensitive(key);
+    KnownHeader id = KnownHeaderToEnum(key);
+    if(id != KnownHeader::UNKNOWN) {
+        auto idx     = static_cast<std::size_t>(id);
+        known_[idx]  = { key, value };
+        knownMask_  |= static_cast<std::uint16_t>(1u << idx);
+        return;
+    }
+
+    // Same semantics as the old map, a repeated header overwrites the previous value
+    if(HeaderEntry* entry = FindOther(key)) {
+        entry->value = value;
+        return;
+    }
+
+    if(otherCount_ < INLINE_CAPACITY)
+        inline_[otherCount_] = { key, value };
+    else
+        overflow_.push_back({ key, value });
+
+    ++otherCount_;
 }
 
-template<typename T1, typename T2>
-bool CaseInsensitiveEqual::operator()(const T1& lhs, const T2& rhs) const
+inline bool RequestHeaders::HasHeader(std::string_view key) const noexcept
 {
-    static_assert(
-        (std::is_same_v<std::decay_t<T1>, std::string> || std::is_same_v<std::decay_t<T1>, std::string_view>) &&
-        (std::is_same_v<std::decay_t<T2>, std::string> || std::is_same_v<std::decay_t<T2>, std::string_view>),
-        "CaseInsensitiveEqual: both operands must be std::string or std::string_view"
-    );
-    return WFX::Utils::StringCanonical::CTInsensitiveStringCompare(lhs, rhs);
+    return CheckAndGetHeader(key).first;
 }
 
-template<typename K, typename V>
-HttpHeaders<K, V>::HttpHeaders()
+inline std::string_view RequestHeaders::GetHeader(std::string_view key) const noexcept
 {
-    // In most HTTP responses we have around 6–12 headers per request/response, so yeah
-    // Pre reserve to prevent rehashing
-    headers_.reserve(12);
+    auto [exists, value] = CheckAndGetHeader(key);
+    return exists ? *value : std::string_view{};
 }
 
-template<typename K, typename V>
-void HttpHeaders<K, V>::SetHeader(K key, V value)
+inline RequestHeaders::HeaderResult RequestHeaders::CheckAndGetHeader(std::string_view key) const noexcept
 {
-    headers_[std::move(key)] = std::move(value);
+    KnownHeader id = KnownHeaderToEnum(key);
+    if(id != KnownHeader::UNKNOWN)
+        return CheckAndGetHeader(id);
+
+    if(const HeaderEntry* entry = FindOther(key))
+        return { true, &entry->value };
+
+    return { false, nullptr };
 }
 
-template<typename K, typename V>
-bool HttpHeaders<K, V>::HasHeader(const K& key) const
+inline void RequestHeaders::RemoveHeader(std::string_view key) noexcept
 {
-    return headers_.find(key) != headers_.end();
+    KnownHeader id = KnownHeaderToEnum(key);
+    if(id != KnownHeader::UNKNOWN) {
+        knownMask_ &= static_cast<std::uint16_t>(~(1u << static_cast<std::size_t>(id)));
+        return;
+    }
+
+    for(std::size_t i = 0; i < otherCount_; i++) {
+        if(!WFX::Utils::StringCanonical::InsensitiveStringCompare(OtherAt(i).key, key))
+            continue;
+
+        // Shift the rest down so iteration order stays the same as arrival order
+        for(std::size_t j = i + 1; j < otherCount_; j++)
+            OtherAt(j - 1) = OtherAt(j);
+
+        --otherCount_;
+        if(otherCount_ >= INLINE_CAPACITY)
+            overflow_.pop_back();
+        return;
+    }
 }
 
-template<typename K, typename V>
-V HttpHeaders<K, V>::GetHeader(const K& key) const
+inline void RequestHeaders::Clear() noexcept
 {
-    auto it = headers_.find(key);
-    return it != headers_.end() ? it->second : V{};
+    knownMask_  = 0;
+    otherCount_ = 0;
+    overflow_.clear();
 }
 
-template<typename K, typename V>
-typename HttpHeaders<K, V>::HeaderResult
-HttpHeaders<K, V>::CheckAndGetHeader(const K& key) const
+inline bool RequestHeaders::HasHeader(KnownHeader id) const noexcept
 {
-    auto it = headers_.find(key);
-    if(it != headers_.end())
-        return { true, &it->second };
+    return id != KnownHeader::UNKNOWN && (knownMask_ & (1u << static_cast<std::size_t>(id)));
+}
 
-    return { false, nullptr };
+inline std::string_view RequestHeaders::GetHeader(KnownHeader id) const noexcept
+{
+    return HasHeader(id) ? known_[static_cast<std::size_t>(id)].value : std::string_view{};
+}
+
+inline RequestHeaders::HeaderResult RequestHeaders::CheckAndGetHeader(KnownHeader id) const noexcept
+{
+    if(!HasHeader(id))
+        return { false, nullptr };
+
+    return { true, &known_[static_cast<std::size_t>(id)].value };
+}
+
+inline std::size_t RequestHeaders::Size() const noexcept
+{
+    return static_cast<std::size_t>(__builtin_popcount(knownMask_)) + otherCount_;
 }
 
-template<typename K, typename V>
-void HttpHeaders<K, V>::RemoveHeader(const K& key)
+template<typename Fn>
+void RequestHeaders::ForEach(Fn&& fn) const
 {
-    headers_.erase(key);
+    for(std::size_t i = 0; i < KNOWN_COUNT; i++)
+        if(knownMask_ & (1u << i))
+            fn(known_[i].key, known_[i].value);
+
+    for(std::size_t i = 0; i < otherCount_; i++)
+        fn(OtherAt(i).key, OtherAt(i).value);
+}
+
+inline RequestHeaders::HeaderEntry* RequestHeaders::FindOther(std::string_view key) noexcept
+{
+    return const_cast<HeaderEntry*>(std::as_const(*this).FindOther(key));
+}
+
+inline const RequestHeaders::HeaderEntry* RequestHeaders::FindOther(std::string_view key) const noexcept
+{
+    // Linear scan is fine here, header names are short and mostly differ in length anyways
+    for(std::size_t i = 0; i < otherCount_; i++) {
+        const HeaderEntry& entry = OtherAt(i);
+        if(entry.key.size() == key.size() && WFX::Utils::StringCanonical::InsensitiveStringCompare(entry.key, key))
+            return &entry;
+    }
+
+    return nullptr;
 }
 
-template<typename K, typename V>
-void HttpHeaders<K, V>::Clear()
+inline RequestHeaders::HeaderEntry& RequestHeaders::OtherAt(std::size_t idx) noexcept
 {
-    headers_.clear();
+    return idx < INLINE_CAPACITY ? inline_[idx] : overflow_[idx - INLINE_CAPACITY];
 }
 
-template<typename K, typename V>
-typename HttpHeaders<K, V>::HeaderMapType& HttpHeaders<K, V>::GetHeaderMap()
+inline const RequestHeaders::HeaderEntry& RequestHeaders::OtherAt(std::size_t idx) const noexcept
 {
-    return headers_;
+    return idx < INLINE_CAPACITY ? inline_[idx] : overflow_[idx - INLINE_CAPACITY];
 }
 
-template<typename K, typename V>
-const typename HttpHeaders<K, V>::HeaderMapType& HttpHeaders<K, V>::GetHeaderMap() const
+// vvv Response Headers vvv
+template<typename Fn>
+void ResponseHeaders::ForEach(Fn&& fn) const
 {
-    return headers_;
+    for(const auto& entry : entries_)
+        fn(KeyOf(entry), ValueOf(entry));
 }
 
 } // namespace WFX
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "http_middleware.hpp"
 #include "http/connection/http_connection.hpp"
 #include "http/response.hpp"
+#include "http/routing/route_segment.hpp"
 #include "shared/apis/http_api.hpp"
 #include "utils/logger/logger.hpp"
 #include <unordered_set>
@@ -25,6 +26,9 @@ void HttpMiddleware::RegisterPerRouteMiddleware(const TrieNode* node, HttpMiddle
             "[HttpMiddleware]: Route node is nullptr for per-route middleware registeration"
         );
 
+    if(built_)
+        logger.Fatal("[HttpMiddleware]: Per-route middleware registered after middleware chains were built");
+
     auto&& [it, inserted] = middlewarePerRouteCallbacks_.emplace(node, std::move(mwStack));
     if(!inserted)
         logger.Fatal(
@@ -35,29 +39,15 @@ void HttpMiddleware::RegisterPerRouteMiddleware(const TrieNode* node, HttpMiddle
 MiddlewareResult HttpMiddleware::ExecuteMiddleware(
     const TrieNode* node, HttpRequest& req, Response res, ConnectionContext* ctx
 ) {
-    if(ctx->trackAsync.GetMLevel() == MiddlewareLevel::GLOBAL) {
-        // Initially execute the global middleware stack
-        auto [success, task] = ExecuteHelper(req, res, middlewareGlobalCallbacks_, ctx);
-        if(!success)
-            return {false, std::move(task)};
+    const MiddlewareChain& chain = (node && node->middleware) ? *node->middleware : globalChain_;
 
-        // Reset the context to prepare for per route if it exists
-        ctx->trackAsync.SetMIndex(0);
-        ctx->trackAsync.SetMLevel(MiddlewareLevel::PER_ROUTE);
-    }
-
-    // We assume that no node means no per-route middleware
-    if(!node)
+    if(chain.entries.empty())
         return {true, AsyncMiddlewareAction{nullptr}};
 
-    auto elem = middlewarePerRouteCallbacks_.find(node);
-    
-    // Node exists but no middleware exist, return true
-    if(elem == middlewarePerRouteCallbacks_.end())
-        return {true, AsyncMiddlewareAction{nullptr}};
+    if(chain.allSync)
+        return ExecuteSync(chain, req, res);
 
-    // Per route middleware exists, execute it
-    return ExecuteHelper(req, res, elem->second, ctx);
+    return ExecuteHelper(req, res, chain, ctx);
 }
 
 void HttpMiddleware::LoadMiddlewareFromConfig(MiddlewareConfigOrder order)
@@ -91,6 +81,29 @@ void HttpMiddleware::LoadMiddlewareFromConfig(MiddlewareConfigOrder order)
     }
 }
 
+void HttpMiddleware::BuildChains()
+{
+    globalChain_ = MiddlewareChain{};
+    AppendToChain(globalChain_, middlewareGlobalCallbacks_);
+    globalChain_.globalCount = static_cast<std::uint16_t>(globalChain_.entries.size());
+
+    // Reserved up front, nodes keep pointers into it
+    routeChains_.clear();
+    routeChains_.reserve(middlewarePerRouteCallbacks_.size());
+
+    for(auto& [node, stack] : middlewarePerRouteCallbacks_) {
+        MiddlewareChain& chain = routeChains_.emplace_back(globalChain_);
+        AppendToChain(chain, stack);
+        node->middleware = &chain;
+    }
+
+    // Only chains are used from now on
+    middlewareGlobalCallbacks_.clear();
+    middlewarePerRouteCallbacks_.clear();
+    middlewarePerRouteCallbacks_.rehash(0);
+    built_ = true;
+}
+
 void HttpMiddleware::DiscardFactoryMap()
 {
     middlewareFactories_.clear();
@@ -98,12 +111,34 @@ void HttpMiddleware::DiscardFactoryMap()
 }
 
 // vvv Helper Functions vvv
+MiddlewareResult HttpMiddleware::ExecuteSync(const MiddlewareChain& chain, HttpRequest& req, Response res)
+{
+    const MiddlewareEntry* entries = chain.entries.data();
+    std::size_t            count   = chain.entries.size();
+
+    for(std::size_t i = 0; i < count; i++) {
+        switch(entries[i].sync(req, res)) {
+            case MiddlewareAction::CONTINUE:
+                break;
+
+            case MiddlewareAction::SKIP_NEXT:
+                // Skip one element in this chain, unless its the first per route one
+                if(i + 1 != chain.globalCount)
+                    ++i;
+                break;
+
+            case MiddlewareAction::BREAK:
+                return {false, AsyncMiddlewareAction{nullptr}};
+        }
+    }
+
+    return {true, AsyncMiddlewareAction{nullptr}};
+}
+
 MiddlewareResult HttpMiddleware::ExecuteHelper(
-    HttpRequest& req, Response res, HttpMiddlewareStack& stack, ConnectionContext* ctx
+    HttpRequest& req, Response res, const MiddlewareChain& chain, ConnectionContext* ctx
 ) {
-    std::size_t stackSize = stack.size();
-    if(stackSize == 0)
-        return {true, AsyncMiddlewareAction{nullptr}};
+    std::size_t stackSize = chain.entries.size();
 
     auto& trackAsync = ctx->trackAsync;
     auto mIndex = trackAsync.GetMIndex();
@@ -118,7 +153,8 @@ MiddlewareResult HttpMiddleware::ExecuteHelper(
                 break; // Proceed normally
 
             case MiddlewareAction::SKIP_NEXT:
-                mIndex++;
+                if(mIndex != chain.globalCount)
+                    mIndex++;
                 break;
 
             case MiddlewareAction::BREAK:
@@ -127,7 +163,7 @@ MiddlewareResult HttpMiddleware::ExecuteHelper(
     }
 
     for(std::uint16_t i = mIndex; i < stackSize; i++) {
-        HttpMiddlewareType& entry = stack[i];
+        const MiddlewareEntry& entry = chain.entries[i];
 
         // Execute
         auto [action, task] = ExecuteFunction(ctx, entry, req, res);
@@ -146,8 +182,9 @@ MiddlewareResult HttpMiddleware::ExecuteHelper(
                 break;
 
             case MiddlewareAction::SKIP_NEXT:
-                // Skip one element in this chain
-                ++i;
+                // Skip one element in this chain, unless its the first per route one
+                if(i + 1 != chain.globalCount)
+                    ++i;
                 break;
 
             case MiddlewareAction::BREAK:
@@ -159,26 +196,17 @@ MiddlewareResult HttpMiddleware::ExecuteHelper(
 }
 
 MiddlewareFunctionResult HttpMiddleware::ExecuteFunction(
-    ConnectionContext* ctx, HttpMiddlewareType& entry, HttpRequest& req, Response res
+    ConnectionContext* ctx, const MiddlewareEntry& entry, HttpRequest& req, Response res
 ) {
     auto& logger = WFX::Utils::Logger::GetInstance();
 
-    // Sanity check, this shouldn't happen if user properly set handled types
-    if(std::holds_alternative<std::monostate>(entry)) {
-        logger.Warn(
-            "[HttpMiddleware]: Found empty handler while executing middleware."
-            " Corrupted state"
-        );
-        return {MiddlewareAction::CONTINUE, AsyncMiddlewareAction{nullptr}};
-    }
-
     // Check if its a sync function, it directly returns value
-    if(auto* sync = std::get_if<SyncMiddlewareType>(&entry))
-        return {(*sync)(req, res), AsyncMiddlewareAction{nullptr}};
+    if(entry.sync)
+        return {entry.sync(req, res), AsyncMiddlewareAction{nullptr}};
 
     // For async function, the return value is stored in ctx 'mAction'
     auto* httpApi = WFX::Shared::GetHttpAPIV1();
-    auto& async   = std::get<AsyncMiddlewareType>(entry);
+    auto  async   = entry.async;
 
     // Set context (type erased) at http api side before calling async callback
     httpApi->SetGlobalPtrData(static_cast<void*>(ctx));
@@ -202,4 +230,26 @@ MiddlewareFunctionResult HttpMiddleware::ExecuteFunction(
     return {action, AsyncMiddlewareAction{nullptr}};
 }
 
+void HttpMiddleware::AppendToChain(MiddlewareChain& chain, const HttpMiddlewareStack& stack)
+{
+    for(const auto& mw : stack) {
+        MiddlewareEntry entry;
+
+        if(auto* sync = std::get_if<SyncMiddlewareType>(&mw))
+            entry.sync = *sync;
+        else if(auto* async = std::get_if<AsyncMiddlewareType>(&mw)) {
+            entry.async   = *async;
+            chain.allSync = false;
+        }
+        // Sanity check, this shouldn't happen if user properly set handled types
+        else
+            WFX::Utils::Logger::GetInstance().Fatal("[HttpMiddleware]: Found empty handler while building middleware chain");
+
+        chain.entries.push_back(entry);
+    }
+
+    if(chain.entries.size() > UINT16_MAX)
+        WFX::Utils::Logger::GetInstance().Fatal("[HttpMiddleware]: Too many middleware in a single chain");
+}
+
 } // namespace WFX::Http
\ No newline at end of file
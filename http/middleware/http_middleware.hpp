@@ -16,6 +16,19 @@ using MiddlewareConfigOrder = const std::vector<std::string>&;
 using MiddlewareFactory     = std::unordered_map<MiddlewareName, HttpMiddlewareType>;
 using MiddlewarePerRoute    = std::unordered_map<const TrieNode*, HttpMiddlewareStack>;
 
+// Variant is resolved once while building chains, so executing is just a function pointer call
+struct MiddlewareEntry {
+    SyncMiddlewareType  sync  = nullptr; // Exactly one of these is set
+    AsyncMiddlewareType async = nullptr;
+};
+
+// Every middleware a route runs, global ones first and then its own
+struct MiddlewareChain {
+    std::vector<MiddlewareEntry> entries;
+    std::uint16_t                globalCount = 0;    // SKIP_NEXT never jumps from global into per route ones
+    bool                         allSync     = true; // Can't suspend half way, so no tracking needed
+};
+
 // 1st parameter is whether we successfully executed all middleware or no
 // 2nd parameter is for async functionality
 using MiddlewareResult         = std::pair<bool, AsyncMiddlewareAction>;
@@ -37,6 +50,10 @@ public:
     // Using std::string because TOML loader returns vector<string>
     void LoadMiddlewareFromConfig(MiddlewareConfigOrder order);
 
+    // Flattens global + per route stacks into one chain per route and hangs it off the route node
+    // Must be called after 'LoadMiddlewareFromConfig', nothing can be registered after this
+    void BuildChains();
+
     void DiscardFactoryMap();
 
 private:
@@ -44,20 +61,25 @@ private:
     HttpMiddleware& operator=(const HttpMiddleware&) = delete;
 
 private: // Helper functions
+    MiddlewareResult ExecuteSync(const MiddlewareChain& chain, HttpRequest& req, Response res);
     MiddlewareResult ExecuteHelper(
-        HttpRequest& req, Response res, HttpMiddlewareStack& stack, ConnectionContext* ctx
+        HttpRequest& req, Response res, const MiddlewareChain& chain, ConnectionContext* ctx
     );
     MiddlewareFunctionResult ExecuteFunction(
-        ConnectionContext* ctx, HttpMiddlewareType& entry, HttpRequest& req, Response res
+        ConnectionContext* ctx, const MiddlewareEntry& entry, HttpRequest& req, Response res
     );
+    void AppendToChain(MiddlewareChain& chain, const HttpMiddlewareStack& stack);
 
 private:
     // Temporary construct
-    MiddlewareFactory middlewareFactories_;
-
-    // Main stuff
+    MiddlewareFactory   middlewareFactories_;
     HttpMiddlewareStack middlewareGlobalCallbacks_;
     MiddlewarePerRoute  middlewarePerRouteCallbacks_;
+
+    // Main stuff
+    MiddlewareChain              globalChain_; // Routes without middleware of their own
+    std::vector<MiddlewareChain> routeChains_; // Never resized after 'BuildChains', nodes point into it
+    bool                         built_ = false;
 };
 
 } // namespace WFX::Http
@@ -0,0 +1,229 @@
+#include "http_body_reader.hpp"
+
+#include "config/config.hpp"
+#include "http/formatters/parser/http_parser.hpp"
+#include "utils/logger/logger.hpp"
+
+#include <cerrno>
+#include <string>
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace WFX::Http {
+
+using namespace WFX::Utils; // For 'Logger'
+using namespace WFX::Core;  // For 'Config'
+
+namespace HttpBodyReader {
+
+// vvv Function signatures vvv
+void WaitForBody(ConnectionContext* ctx, HttpConnectionHandler* connHandler);
+int  OpenSpillFile();
+bool WriteAll(int fd, std::string_view data);
+
+// vvv Function definitions vvv
+BodyReadState ReadChunk(ConnectionContext* ctx, HttpConnectionHandler* connHandler, std::string_view& outChunk)
+{
+    outChunk = {};
+
+    if(!ctx->requestInfo)
+        return BodyReadState::FAILED;
+
+    HttpRequest& request = *ctx->requestInfo;
+    BodyState&   state   = request.bodyState;
+
+    // Body was small enough to be buffered after all, its entirely in 'body' already
+    if(!state.streamed) {
+        if(!state.handedOut) {
+            outChunk        = request.body;
+            state.handedOut = true;
+        }
+        return BodyReadState::READY;
+    }
+
+    if(state.phase == BODY_ERROR)
+        return BodyReadState::FAILED;
+
+    // Handler is done with the last piece, make room for the rest of it
+    if(state.handedOut) {
+        HttpParser::ConsumeStreamedBody(ctx);
+        state.handedOut = false;
+    }
+
+    switch(HttpParser::ParseStreamingBody(ctx, true)) {
+        case HttpParseState::PARSE_STREAMING_BODY:
+        case HttpParseState::PARSE_SUCCESS:
+            outChunk        = request.body;
+            state.handedOut = !outChunk.empty();
+            return BodyReadState::READY;
+
+        case HttpParseState::PARSE_INCOMPLETE_BODY:
+            WaitForBody(ctx, connHandler);
+            return BodyReadState::PENDING;
+
+        default:
+            return BodyReadState::FAILED;
+    }
+}
+
+BodyReadState Spill(ConnectionContext* ctx, HttpConnectionHandler* connHandler, int& outFd, std::uint64_t& outSize)
+{
+    outFd   = -1;
+    outSize = 0;
+
+    if(!ctx->requestInfo)
+        return BodyReadState::FAILED;
+
+    BodyState& state = ctx->requestInfo->bodyState;
+
+    if(state.spillFd < 0) {
+        state.spillFd = OpenSpillFile();
+        if(state.spillFd < 0) {
+            Logger::GetInstance().Error(
+                "[HttpBodyReader]: Failed to create temp file in '",
+                Config::GetInstance().miscConfig.bodySpillDir, "', errno: ", errno
+            );
+            return BodyReadState::FAILED;
+        }
+    }
+
+    // Write out whatever is there, handler only hears back once its all in the file
+    while(true) {
+        std::string_view chunk;
+        BodyReadState    result = ReadChunk(ctx, connHandler, chunk);
+
+        if(result != BodyReadState::READY)
+            return result;
+
+        if(chunk.empty())
+            break;
+
+        if(!WriteAll(state.spillFd, chunk)) {
+            Logger::GetInstance().Error("[HttpBodyReader]: Failed to write body to temp file, errno: ", errno);
+            return BodyReadState::FAILED;
+        }
+    }
+
+#if defined(__linux__)
+    struct stat st;
+    if(::fstat(state.spillFd, &st) != 0 || ::lseek(state.spillFd, 0, SEEK_SET) < 0)
+        return BodyReadState::FAILED;
+
+    outFd   = state.spillFd;
+    outSize = static_cast<std::uint64_t>(st.st_size);
+    return BodyReadState::READY;
+#else
+    return BodyReadState::FAILED;
+#endif
+}
+
+bool OnBodyData(ConnectionContext* ctx, HttpConnectionHandler* connHandler)
+{
+    if(!ctx->requestInfo)
+        return true;
+
+    // Body is being spilled, keep at it and only wake handler up once its all in the file (or it failed)
+    if(ctx->requestInfo->bodyState.spillFd >= 0) {
+        int           fd   = -1;
+        std::uint64_t size = 0;
+        return Spill(ctx, connHandler, fd, size) != BodyReadState::PENDING;
+    }
+
+    // Handler reads it chunk by chunk, wake it up only if there is a chunk for it
+    // Chunk stays where it is, so 'ReadChunk' just picks it up again once handler asks for it
+    if(HttpParser::ParseStreamingBody(ctx, true) == HttpParseState::PARSE_INCOMPLETE_BODY) {
+        WaitForBody(ctx, connHandler);
+        return false;
+    }
+
+    return true;
+}
+
+void Release(HttpRequest& request)
+{
+#if defined(__linux__)
+    if(request.bodyState.spillFd >= 0)
+        ::close(request.bodyState.spillFd);
+#endif
+    request.bodyState.spillFd = -1;
+}
+
+// vvv Helper Functions vvv
+void WaitForBody(ConnectionContext* ctx, HttpConnectionHandler* connHandler)
+{
+    BodyState& state = ctx->requestInfo->bodyState;
+
+    ctx->isBodyWait = 1;
+    connHandler->RefreshExpiry(ctx, Config::GetInstance().networkConfig.bodyTimeout);
+
+    // Client is holding onto the body till we say we want it. Request is still in progress so it-
+    // -must not be cleared once its out, connection handler resumes receive after that
+    if(state.expectContinue) {
+        constexpr std::string_view continueMsg = "HTTP/1.1 100 Continue\r\n\r\n";
+
+        state.expectContinue = false;
+        ctx->isPipelineFlush = 1;
+
+        // Responses of earlier pipelined requests are still in write buffer, message goes behind them
+        if(ctx->rwBuffer.HasPendingWrite()) {
+            (void)ctx->rwBuffer.AppendData(continueMsg.data(), static_cast<std::uint32_t>(continueMsg.size()));
+            connHandler->Write(ctx, {});
+        }
+        else
+            connHandler->Write(ctx, continueMsg);
+
+        return;
+    }
+
+    connHandler->ResumeReceive(ctx);
+}
+
+int OpenSpillFile()
+{
+#if defined(__linux__)
+    const std::string& dir = Config::GetInstance().miscConfig.bodySpillDir;
+
+    // Anonymous file, it goes away on its own once closed (even if we crash)
+    int fd = ::open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if(fd >= 0 || (errno != EOPNOTSUPP && errno != EISDIR))
+        return fd;
+
+    // Filesystem doesn't support O_TMPFILE, so make a named one and unlink it right away
+    std::string path = dir + "/wfx-body-XXXXXX";
+
+    fd = ::mkostemp(path.data(), O_CLOEXEC);
+    if(fd >= 0)
+        ::unlink(path.c_str());
+
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+bool WriteAll(int fd, std::string_view data)
+{
+#if defined(__linux__)
+    while(!data.empty()) {
+        ssize_t n = ::write(fd, data.data(), data.size());
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(n));
+    }
+    return true;
+#else
+    (void)fd; (void)data;
+    return false;
+#endif
+}
+
+} // namespace HttpBodyReader
+
+} // namespace WFX::Http
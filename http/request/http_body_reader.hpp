@@ -0,0 +1,30 @@
+#ifndef WFX_HTTP_BODY_READER_HPP
+#define WFX_HTTP_BODY_READER_HPP
+
+#include "http/connection/http_connection.hpp"
+
+namespace WFX::Http {
+
+// Reading of streamed request bodies (routes registered with WFX_POST_STREAM)
+// Body is decoded in place chunk by chunk, so read buffer only ever holds one piece of it
+namespace HttpBodyReader {
+    // Next piece of body, empty once all of it was read. Buffered bodies come as a single piece
+    // On BodyReadState::PENDING, connection is already waiting for more and handler gets resumed-
+    // -by engine once it arrives
+    BodyReadState ReadChunk(ConnectionContext* ctx, HttpConnectionHandler* connHandler, std::string_view& outChunk);
+
+    // Same as above, but the entire body goes into an anonymous temp file (O_TMPFILE) as it arrives
+    // File belongs to request, it stays valid till response is sent
+    BodyReadState Spill(ConnectionContext* ctx, HttpConnectionHandler* connHandler, int& outFd, std::uint64_t& outSize);
+
+    // Engine calls this once more body arrives for a waiting handler, false means handler has-
+    // -nothing to do with it yet (and we are already waiting for more)
+    bool OnBodyData(ConnectionContext* ctx, HttpConnectionHandler* connHandler);
+
+    // Closes spill file (if any)
+    void Release(HttpRequest& request);
+} // namespace HttpBodyReader
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_BODY_READER_HPP
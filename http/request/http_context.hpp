@@ -0,0 +1,170 @@
+#ifndef WFX_HTTP_CONTEXT_HPP
+#define WFX_HTTP_CONTEXT_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <concepts>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace WFX::Http {
+
+// Where a context key lives inside of 'ContextStorage', handed out once at registration
+struct ContextSlot {
+    std::uint16_t index  = 0; // Bit in 'setMask_'
+    std::uint16_t offset = 0; // Into 'storage_'
+};
+
+// Typed context keys (see 'WFX_CONTEXT_KEY'), a key is just a type with these two on it
+template<typename Key>
+concept ContextKey = requires {
+    typename Key::ValueType;
+    { Key::slot } -> std::convertible_to<ContextSlot>;
+};
+
+// Fixed size, inline storage for typed context values
+// Every key gets its own index and byte range at runtime, while user code is being loaded (see-
+// -'ContextRegistry'), so get / set is a bit test plus a pointer offset. No hashing, no string-
+// -keys, no heap
+class ContextStorage {
+public:
+    static constexpr std::size_t MAX_KEYS     = 32;
+    static constexpr std::size_t STORAGE_SIZE = 256;
+
+public:
+    ContextStorage() = default;
+    ~ContextStorage() { Clear(); }
+
+    template<ContextKey Key, typename... Args>
+    typename Key::ValueType& Emplace(Args&&... args)
+    {
+        using T = typename Key::ValueType;
+
+        Erase<Key>();
+
+        T* value = ::new(static_cast<void*>(storage_ + Key::slot.offset)) T(std::forward<Args>(args)...);
+
+        // Only stuff which owns something needs cleaning up later on
+        if constexpr(!std::is_trivially_destructible_v<T>) {
+            dtors_[Key::slot.index]   = [](void* p) { static_cast<T*>(p)->~T(); };
+            offsets_[Key::slot.index] = Key::slot.offset;
+        }
+
+        setMask_ |= 1u << Key::slot.index;
+        return *value;
+    }
+
+    template<ContextKey Key>
+    typename Key::ValueType* Get() noexcept
+    {
+        if(!(setMask_ & (1u << Key::slot.index)))
+            return nullptr;
+
+        return std::launder(reinterpret_cast<typename Key::ValueType*>(storage_ + Key::slot.offset));
+    }
+
+    template<ContextKey Key>
+    const typename Key::ValueType* Get() const noexcept
+    {
+        return const_cast<ContextStorage*>(this)->Get<Key>();
+    }
+
+    template<ContextKey Key>
+    void Erase() noexcept
+    {
+        std::uint32_t bit = 1u << Key::slot.index;
+        if(!(setMask_ & bit))
+            return;
+
+        if(dtors_[Key::slot.index]) {
+            dtors_[Key::slot.index](storage_ + Key::slot.offset);
+            dtors_[Key::slot.index] = nullptr;
+        }
+        setMask_ &= ~bit;
+    }
+
+    void Clear() noexcept
+    {
+        // Only visits keys which are set, trivial ones have no destructor to call
+        for(std::uint32_t mask = setMask_; mask; mask &= mask - 1) {
+            int index = std::countr_zero(mask);
+            if(dtors_[index]) {
+                dtors_[index](storage_ + offsets_[index]);
+                dtors_[index] = nullptr;
+            }
+        }
+        setMask_ = 0;
+    }
+
+private:
+    // Copying values around without knowing their types is not something we do
+    ContextStorage(const ContextStorage&)            = delete;
+    ContextStorage& operator=(const ContextStorage&) = delete;
+
+private:
+    using Destructor = void (*)(void*);
+
+    alignas(std::max_align_t) std::byte storage_[STORAGE_SIZE];
+    Destructor                           dtors_[MAX_KEYS]   = {};
+    std::uint16_t                        offsets_[MAX_KEYS] = {}; // Clear() doesn't know key types, only where they live
+    std::uint32_t                        setMask_           = 0;
+};
+
+// Hands out slots to keys as they are registered (static init of user code)
+// Lives entirely in headers, so each binary (user DLL) has its own, which is fine as engine itself-
+// -never uses typed keys. Same goes for reporting, it can't count on engine's logger being there
+namespace ContextRegistry {
+    struct State {
+        std::uint16_t count = 0;
+        std::uint16_t used  = 0;
+    };
+
+    inline State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    template<typename T>
+    ContextSlot Register(const char* name)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types can't be stored in request context");
+        static_assert(sizeof(T) <= ContextStorage::STORAGE_SIZE, "Type is too large for request context, store a pointer to it instead");
+
+        State&      state  = GetState();
+        std::size_t offset = (state.used + alignof(T) - 1) & ~(alignof(T) - 1);
+
+        // Runs as user code gets loaded, so going over budget stops the server right at startup
+        if(state.count >= ContextStorage::MAX_KEYS) {
+            std::fprintf(stderr,
+                "[ContextRegistry]: Can't register context key '%s', all %zu key slots are already taken\n",
+                name, ContextStorage::MAX_KEYS);
+            std::exit(EXIT_FAILURE);
+        }
+
+        if(offset + sizeof(T) > ContextStorage::STORAGE_SIZE) {
+            std::size_t left = offset < ContextStorage::STORAGE_SIZE ? ContextStorage::STORAGE_SIZE - offset : 0;
+
+            std::fprintf(stderr,
+                "[ContextRegistry]: Can't register context key '%s', it needs %zu bytes but only %zu of %zu are left."
+                " Store a pointer to it instead\n",
+                name, sizeof(T), left, ContextStorage::STORAGE_SIZE);
+            std::exit(EXIT_FAILURE);
+        }
+
+        ContextSlot slot;
+        slot.index  = state.count++;
+        slot.offset = static_cast<std::uint16_t>(offset);
+        state.used  = static_cast<std::uint16_t>(offset + sizeof(T));
+
+        return slot;
+    }
+} // namespace ContextRegistry
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_CONTEXT_HPP
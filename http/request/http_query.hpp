@@ -0,0 +1,120 @@
+#ifndef WFX_HTTP_QUERY_HPP
+#define WFX_HTTP_QUERY_HPP
+
+#include "utils/backport/string.hpp"
+#include "utils/crypt/string.hpp"
+#include "utils/uuid/uuid.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace WFX::Http {
+
+struct QueryParam {
+    std::string_view key;
+    std::string_view value;
+};
+
+// Query string of request ('?a=1&b=2'), split into key / value views without allocating (unless-
+// -there are more than 'INLINE_PARAMS' of them)
+// Keys and values point into read buffer and are percent decoded in place, so once parsed, query-
+// -part of 'req.path' holds the decoded bytes and shouldn't be looked at anymore
+class QueryParams {
+public:
+    static constexpr std::size_t INLINE_PARAMS = 16;
+
+public:
+    // Raw query (without '?'), splits and decodes all of it. Engine calls it on first 'req.Query()'
+    void Parse(std::string_view rawQuery)
+    {
+        count_ = 0;
+        overflow_.clear();
+
+        while(!rawQuery.empty()) {
+            std::size_t      end  = rawQuery.find('&');
+            std::string_view pair = rawQuery.substr(0, end);
+            rawQuery = end == std::string_view::npos ? std::string_view{} : rawQuery.substr(end + 1);
+
+            if(pair.empty())
+                continue;
+
+            std::size_t eqPos = pair.find('=');
+            QueryParam  param;
+            param.key   = pair.substr(0, eqPos);
+            param.value = eqPos == std::string_view::npos ? std::string_view{} : pair.substr(eqPos + 1);
+
+            // Malformed escapes, drop the pair instead of handing out half decoded garbage
+            if(!WFX::Utils::StringCanonical::DecodePercentInplace(param.key)
+                || !WFX::Utils::StringCanonical::DecodePercentInplace(param.value))
+                continue;
+
+            // Only pathological queries go past inline storage
+            if(count_ < INLINE_PARAMS)
+                inline_[count_] = param;
+            else
+                overflow_.push_back(param);
+            count_++;
+        }
+    }
+
+    std::size_t Size() const noexcept { return count_; }
+
+    const QueryParam& At(std::size_t index) const
+    {
+        return index < INLINE_PARAMS ? inline_[index] : overflow_[index - INLINE_PARAMS];
+    }
+
+    // First value for 'key', 'fallback' if there is none. '?flag' and '?flag=' both give empty value
+    std::string_view Get(std::string_view key, std::string_view fallback = {}) const
+    {
+        const QueryParam* param = Find(key);
+        return param ? param->value : fallback;
+    }
+
+    bool Has(std::string_view key) const
+    {
+        return Find(key) != nullptr;
+    }
+
+    // Typed getters, same conversions route params go through ('<uint>', '<int>', '<uuid>')
+    // False if key is missing or value isn't of that type
+    bool GetUInt(std::string_view key, std::uint64_t& out) const
+    {
+        const QueryParam* param = Find(key);
+        return param && WFX::Utils::StrToUInt64(param->value, out);
+    }
+
+    bool GetInt(std::string_view key, std::int64_t& out) const
+    {
+        const QueryParam* param = Find(key);
+        return param && WFX::Utils::StrToInt64(param->value, out);
+    }
+
+    bool GetUUID(std::string_view key, WFX::Utils::UUID& out) const
+    {
+        const QueryParam* param = Find(key);
+        return param && WFX::Utils::UUID::FromString(param->value, out);
+    }
+
+private:
+    const QueryParam* Find(std::string_view key) const
+    {
+        for(std::size_t i = 0; i < count_; i++) {
+            const QueryParam& param = At(i);
+            if(param.key == key)
+                return &param;
+        }
+        return nullptr;
+    }
+
+private:
+    std::array<QueryParam, INLINE_PARAMS> inline_;
+    std::vector<QueryParam>               overflow_;
+    std::size_t                           count_ = 0;
+};
+
+} // namespace WFX::Http
+
+#endif // WFX_HTTP_QUERY_HPP
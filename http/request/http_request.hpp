@@ -4,9 +4,14 @@
 #include "http/constants/http_constants.hpp"
 #include "http/headers/http_headers.hpp"
 #include "http/common/http_route_common.hpp"
+#include "http/request/http_context.hpp"
+#include "http/request/http_query.hpp"
+#include "utils/pool/arena.hpp"
 
 #include <string>
 #include <any>
+#include <memory_resource>
+#include <unordered_map>
 
 // Forward declare engine to access cool internal stuff
 namespace WFX::Core { class CoreEngine; }
@@ -15,17 +20,53 @@ namespace WFX::Core { class CoreEngine; }
 namespace WFX::Http {
 
 // Context storage for middleware / routes / user stuff
-using ContextMap = std::unordered_map<std::string, std::any>;
+// Nodes come from request arena, keys are mostly short enough for SSO so they don't allocate either
+using ContextMap = std::pmr::unordered_map<std::string, std::any>;
+
+// Internal use, where body decoding is at. Anything other than BODY_BUFFERED / BODY_DONE means-
+// -body is still (partly) on the wire
+enum BodyPhase : std::uint8_t {
+    BODY_BUFFERED,   // Nothing to decode, body (if any) is entirely inside of 'body'
+    CHUNK_SIZE,      // Waiting for '<hex size>[;ext]\r\n'
+    CHUNK_DATA,      // Copying chunk data
+    CHUNK_DATA_CRLF, // CRLF right after chunk data
+    CHUNK_TRAILER,   // Trailer fields after the last (zero sized) chunk, till empty line
+    FIXED_DATA,      // Content-Length body which didn't fit in read buffer (streamed)
+    BODY_DONE,
+    BODY_ERROR
+};
+
+// Internal use, progress of chunked / streamed body decoding
+struct BodyState {
+    std::uint32_t cursor         = 0;     // Where undecoded data starts in read buffer
+    std::uint32_t pending        = 0;     // Decoded body bytes sitting right before 'cursor'
+    std::uint64_t remaining      = 0;     // Data bytes left in current chunk / fixed body (trailer bytes seen, in trailer phase)
+    std::uint64_t decoded        = 0;     // Total body bytes decoded till now
+    int           spillFd        = -1;    // Temp file body is being spilled to (if asked)
+    BodyPhase     phase          = BODY_BUFFERED;
+    bool          streamed       = false; // Route streams its body, read buffer gets reused chunk by chunk
+    bool          handedOut      = false; // 'pending' bytes were given to handler, drop them on next read
+    bool          expectContinue = false; // Client is waiting for 100 Continue before sending body
+};
 
 struct HttpRequest {
+private: // Declared first so it outlives everything allocating from it
+    WFX::Utils::Arena arena_;
+
+public:
     HttpMethod       method;
     HttpVersion      version;
     std::string_view path;
     std::string_view body;
     RequestHeaders   headers;
-    ContextMap       context;
+    ContextMap       context{&arena_};
     PathSegments     pathSegments;
 
+    // Internal use, total bytes (head + body) this request took in read buffer
+    // Anything after it belongs to the next pipelined request
+    std::uint32_t    requestLength = 0;
+    BodyState        bodyState;
+
 public: // Copying is strictly not allowed
     HttpRequest(const HttpRequest&)            = delete;
     HttpRequest& operator=(const HttpRequest&) = delete;
@@ -38,7 +79,30 @@ public: // Helper functions
         routeNode_ = nullptr;
         headers.Clear();
         pathSegments.clear(); 
-        context.clear();
+        body          = {};
+        requestLength = 0;
+        bodyState     = BodyState{};
+        queryParsed_  = false;
+        typedContext_.Clear();
+
+        // Map has to let go of its buckets before arena memory gets reused, clear() keeps them
+        context = ContextMap{&arena_};
+        arena_.Reset();
+    }
+
+    // Scratch memory for handlers / middleware, valid till response is sent
+    // Use it directly ('Allocate', 'New', 'CopyString') or put std::pmr containers on top of it
+    WFX::Utils::Arena& Arena() noexcept { return arena_; }
+
+    // Query params, parsed on first call. Requests which never ask don't pay anything for it
+    const QueryParams& Query()
+    {
+        if(!queryParsed_) {
+            std::size_t qPos = path.find('?');
+            query_.Parse(qPos == std::string_view::npos ? std::string_view{} : path.substr(qPos + 1));
+            queryParsed_ = true;
+        }
+        return query_;
     }
 
     template<typename T>
@@ -84,8 +148,44 @@ public: // Helper functions
         context.erase(key);
     }
 
+public: // Typed context (keys declared with 'WFX_CONTEXT_KEY'), prefer these over string keys
+    template<ContextKey Key, typename... Args>
+    typename Key::ValueType& SetContext(Args&&... args)
+    {
+        return typedContext_.Emplace<Key>(std::forward<Args>(args)...);
+    }
+
+    template<ContextKey Key>
+    typename Key::ValueType* GetContext() noexcept
+    {
+        return typedContext_.Get<Key>();
+    }
+
+    template<ContextKey Key>
+    const typename Key::ValueType* GetContext() const noexcept
+    {
+        return typedContext_.Get<Key>();
+    }
+
+    template<ContextKey Key, typename... Args>
+    typename Key::ValueType& InitOrGetContext(Args&&... args)
+    {
+        if(auto* value = typedContext_.Get<Key>())
+            return *value;
+        return typedContext_.Emplace<Key>(std::forward<Args>(args)...);
+    }
+
+    template<ContextKey Key>
+    void EraseContext() noexcept
+    {
+        typedContext_.Erase<Key>();
+    }
+
 private:
-    const void* routeNode_ = nullptr;
+    const void*    routeNode_   = nullptr;
+    QueryParams    query_;
+    bool           queryParsed_ = false;
+    ContextStorage typedContext_;
 
     friend class WFX::Core::CoreEngine;
 };
@@ -1,12 +1,14 @@
 #include "http_response.hpp"
 
 #include "engine/template_engine.hpp"
+#include "http/common/http_compression.hpp"
 #include "http/common/http_detector.hpp"
+#include "http/common/http_encoding.hpp"
+#include "http/common/http_validators.hpp"
 #include "http/connection/http_connection.hpp"
 #include "form/forms.hpp"
 #include "utils/fileops/filecache.hpp"
 #include "utils/fileops/filesystem.hpp"
-#include "utils/backport/string.hpp"
 #include "utils/logger/logger.hpp"
 
 namespace WFX::Http {
@@ -14,9 +16,6 @@ namespace WFX::Http {
 using namespace WFX::Utils; // For 'Logger', 'FileSystem', ...
 using namespace WFX::Core;  // For 'TemplateEngine'
 
-constexpr const char* CONTENT_TYPE_PLAIN = "text/plain";
-constexpr const char* CONTENT_TYPE_JSON  = "application/json";
-
 HttpResponse& HttpResponse::Status(HttpStatus code)
 {
     status = code;
@@ -25,7 +24,7 @@ HttpResponse& HttpResponse::Status(HttpStatus code)
 
 HttpResponse& HttpResponse::Set(std::string&& key, std::string&& value)
 {
-    headers.SetHeader(std::move(key), std::move(value));
+    headers.SetHeader(key, value);
     return *this;
 }
 
@@ -54,19 +53,19 @@ void HttpResponse::SendText(const char* cstr)
     auto view = std::string_view{cstr};
 
     body = view;
-    headers.SetHeader("Content-Length", UInt64ToStr(view.size()));
-    headers.SetHeader("Content-Type", CONTENT_TYPE_PLAIN);
+    headers.SetContentLength(view.size());
+    headers.SetHeaderLine(HeaderLine::CONTENT_TYPE_PLAIN);
 }
 
 void HttpResponse::SendText(std::string&& str)
 {
-    SetTextBody(std::move(str), CONTENT_TYPE_PLAIN);
+    SetTextBody(std::move(str), HeaderLine::CONTENT_TYPE_PLAIN);
 }
 
 // vvv JSON vvv
 void HttpResponse::SendJson(const Json& j)
 {
-    SetTextBody(std::move(j.dump()), CONTENT_TYPE_JSON);
+    SetTextBody(std::move(j.dump()), HeaderLine::CONTENT_TYPE_JSON);
 }
 
 // vvv FILE vvv
@@ -117,7 +116,7 @@ void HttpResponse::SendTemplate(std::string&& path, Json&& ctx)
     }
 
     // Common headers
-    headers.SetHeader("Content-Type", "text/html");
+    headers.SetHeaderLine(HeaderLine::CONTENT_TYPE_HTML);
 
     // TemplateType::STATIC is just sendfile, not that big of an issue
     if(meta->type == TemplateType::STATIC) {
@@ -126,8 +125,10 @@ void HttpResponse::SendTemplate(std::string&& path, Json&& ctx)
         // Template can be served as is, 'filePath' contains the path to template
         body = std::string_view{meta->filePath};
     
-        // Set remaining headers
-        headers.SetHeader("Content-Length", UInt64ToStr(meta->size));
+        // Set remaining headers, validators let 'CoreEngine' turn revalidations into 304s
+        std::uint64_t fileSize = meta->size;
+        SetValidatorHeaders(meta->filePath, fileSize);
+        headers.SetContentLength(fileSize);
     }
     // TemplateType::DYNAMIC needs streaming with the help of stateless generator in meta.gen
     else {
@@ -338,14 +339,14 @@ void HttpResponse::Stream(StreamGenerator generator, bool streamChunked, bool sk
 
     // Set the streaming-specific header
     if(streamChunked)
-        headers.SetHeader("Transfer-Encoding", "chunked");
+        headers.SetHeaderLine(HeaderLine::TRANSFER_CHUNKED);
 
     operationType_ = streamChunked ? OperationType::STREAM_CHUNKED : OperationType::STREAM_FIXED;
     body = std::move(generator);
 }
 
 // vvv HELPER FUNCTIONS vvv
-void HttpResponse::SetTextBody(std::string&& text, const char* contentType)
+void HttpResponse::SetTextBody(std::string&& text, std::string_view contentTypeLine)
 {
     auto& logger = Logger::GetInstance();
     std::size_t size = text.size();
@@ -357,8 +358,8 @@ void HttpResponse::SetTextBody(std::string&& text, const char* contentType)
         logger.Fatal("[HttpResponse]: Cannot mix text and file responses");
 
     body = std::move(text);
-    headers.SetHeader("Content-Length", UInt64ToStr(size));
-    headers.SetHeader("Content-Type", contentType);
+    headers.SetContentLength(size);
+    headers.SetHeaderLine(contentTypeLine);
 }
 
 bool HttpResponse::ValidateFileSend(std::string_view path, bool autoHandle404, const char* funcName)
@@ -381,21 +382,142 @@ void HttpResponse::PrepareFileHeaders(std::string_view path)
 {
     operationType_ = OperationType::FILE;
 
-    std::uint64_t    fileSize = FileSystem::GetFileSize(path.data());
+    // Size comes along with validators from 'FileCache', which opens the file anyways right-
+    // -after this to send it, so no separate stat for the size
+    std::uint64_t    fileSize = 0;
     std::string_view mime     = MimeDetector::DetectMimeFromExt(path);
 
-    headers.SetHeader("Content-Length", UInt64ToStr(fileSize));
-    headers.SetHeader("Content-Type", std::string(mime));
+    if(!SetValidatorHeaders(std::string(path), fileSize))
+        fileSize = FileSystem::GetFileSize(path.data());
+
+    headers.SetContentLength(fileSize);
+    headers.SetHeader("Content-Type", mime);
+}
+
+bool HttpResponse::SetValidatorHeaders(const std::string& path, std::uint64_t& fileSize)
+{
+    FileValidator validator;
+    if(!FileCache::GetInstance().GetValidator(path, validator))
+        return false;
+
+    fileSize = validator.size;
+
+    // Anything with validators goes out as a file, which is what 'Range' support is built on
+    headers.SetHeaderLine(HeaderLine::ACCEPT_RANGES);
+    headers.SetHeader("ETag", HttpValidators::MakeETag(validator.inode, validator.size, validator.modifiedNs));
+    headers.SetHeader("Last-Modified", HttpValidators::FormatHttpDate(validator.modifiedNs / 1'000'000'000LL));
+    return true;
 }
 
 // vvv Internal use vvv
+void HttpResponse::SendStaticFile(StaticFilePtr file)
+{
+    if(!std::holds_alternative<std::monostate>(body))
+        Logger::GetInstance().Fatal("[HttpResponse]: SendStaticFile() called after body already set");
+
+    // Plain text body as far as serializer is concerned, small enough to be copied right after-
+    // -headers (or gather written if not), either way no fd is ever touched
+    headers.SetHeaderLines(file->Headers());
+    body        = file->Body();
+    staticFile_ = std::move(file);
+}
+
+void HttpResponse::NegotiateEncoding(std::uint8_t acceptedEncodings)
+{
+    if(!IsFileOperation())
+        return;
+
+    std::string  path{GetFilePath()};
+    FileCache&   fileCache = FileCache::GetInstance();
+    std::uint8_t sidecars  = fileCache.GetSidecars(path);
+
+    if(sidecars == FileSidecar::NONE)
+        return;
+
+    // Response depends on 'Accept-Encoding' from here on, caches in between need to know that-
+    // -even if this particular client ends up with the plain file
+    headers.SetHeaderLine(HeaderLine::VARY_ENCODING);
+
+    // Brotli first, its smaller pretty much always
+    std::uint8_t usable   = sidecars & acceptedEncodings;
+    std::uint8_t encoding = (usable & ContentEncoding::BROTLI) ? ContentEncoding::BROTLI
+                          : (usable & ContentEncoding::GZIP)   ? ContentEncoding::GZIP
+                          : ContentEncoding::IDENTITY;
+
+    if(encoding == ContentEncoding::IDENTITY)
+        return;
+
+    std::string   sidecarPath = path + std::string(HttpEncoding::SidecarExtension(encoding));
+    FileValidator original;
+    FileValidator encoded;
+
+    if(!fileCache.GetValidator(path, original) || !fileCache.GetValidator(sidecarPath, encoded))
+        return;
+
+    // Sidecar older than the file is left over from an earlier build, not the same content
+    if(encoded.modifiedNs < original.modifiedNs)
+        return;
+
+    // Sidecar is its own representation, so it gets its own validators (ETag differs by inode)
+    std::uint64_t fileSize = encoded.size;
+    SetValidatorHeaders(sidecarPath, fileSize);
+
+    headers.SetContentLength(fileSize);
+    headers.SetHeader("Content-Encoding", HttpEncoding::ToToken(encoding));
+    body = std::move(sidecarPath);
+}
+
+void HttpResponse::CompressStream(std::uint8_t acceptedEncodings, int level, std::size_t minSize)
+{
+    // Fixed length streams already told client their size, compressing would break that
+    if(operationType_ != OperationType::STREAM_CHUNKED || level <= 0
+        || HttpCompression::Available() == ContentEncoding::IDENTITY)
+        return;
+
+    // Handler encoded the body itself
+    if(headers.HasHeader("Content-Encoding"))
+        return;
+
+    // Events have to reach client as soon as they are produced, compressor holds on to stuff
+    std::string_view contentType = headers.GetHeader("Content-Type");
+    if(!HttpEncoding::IsCompressibleMime(contentType) || contentType.starts_with("text/event-stream"))
+        return;
+
+    headers.SetHeaderLine(HeaderLine::VARY_ENCODING);
+
+    std::uint8_t encoding = HttpCompression::Pick(acceptedEncodings);
+    if(encoding == ContentEncoding::IDENTITY)
+        return;
+
+    body = HttpCompression::Compress(
+        std::move(std::get<StreamGenerator>(body)), encoding, std::min(level, 9), minSize
+    );
+
+    // Body turned out too small (or no compressor could be had), it goes out as is then
+    if(encoding != ContentEncoding::IDENTITY)
+        headers.SetHeader("Content-Encoding", HttpEncoding::ToToken(encoding));
+}
+
+std::string_view HttpResponse::GetFilePath() const
+{
+    if(auto* path = std::get_if<std::string>(&body))
+        return *path;
+    if(auto* path = std::get_if<std::string_view>(&body))
+        return *path;
+
+    return {};
+}
+
 void HttpResponse::ClearInfo()
 {
     headers.Clear();
     body           = std::monostate{};
+    staticFile_.reset();
     version        = HttpVersion::HTTP_1_1;
     status         = HttpStatus::OK;
     operationType_ = OperationType::TEXT;
+    serializeCursor = 0;
+    skipBody       = false;
 }
 
 } // namespace WFX::Http
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "http/constants/http_constants.hpp"
 #include "http/headers/http_headers.hpp"
 #include "http/common/http_route_common.hpp"
+#include "http/common/http_static_cache.hpp"
 
 #include "include/third_party/json/json_fwd.hpp"
 
@@ -51,11 +52,23 @@ public:
     void Stream(StreamGenerator generator, bool streamChunked = true, bool skipChecks = false);
 
 private:
-    void SetTextBody(std::string&& text, const char* contentType);
+    void SetTextBody(std::string&& text, std::string_view contentTypeLine);
     void PrepareFileHeaders(std::string_view path);
+    bool SetValidatorHeaders(const std::string& path, std::uint64_t& fileSize);
     bool ValidateFileSend(std::string_view path, bool autoHandle404, const char* funcName = "SendFile()");
 
 public: // Internal use
+    // Engine's '/public/' fast path, headers and body come out of 'StaticFileCache' as is
+    void SendStaticFile(StaticFilePtr file);
+
+    // For file responses, swaps the file for a precompressed sidecar client accepts (if any)
+    void NegotiateEncoding(std::uint8_t acceptedEncodings);
+
+    // For chunked streams, compresses body on the fly with the best of 'acceptedEncodings' we can do
+    void CompressStream(std::uint8_t acceptedEncodings, int level, std::size_t minSize);
+
+    // Path of the file being sent, only meaningful for file operations
+    std::string_view GetFilePath() const;
     void ClearInfo();
 
 public:
@@ -64,8 +77,16 @@ public:
     ResponseHeaders headers;
     BodyType        body;
 
+    // Internal use, how much of status line + headers is already serialized
+    // Lets serializer pick up where it left off when they don't fit in write buffer in one go
+    std::uint32_t   serializeCursor = 0;
+
+    // Internal use, set for HEAD requests. Response is serialized as usual but body is never sent
+    bool            skipBody = false;
+
 private:
     OperationType operationType_ = OperationType::TEXT;
+    StaticFilePtr staticFile_;    // 'body' views into it, so it has to outlive the write
 };
 
 } // namespace WFX::Http
@@ -17,6 +17,7 @@ enum class ParamType : std::uint8_t {
 
 // Forward declare so TrieNode doesn't cry
 struct RouteSegment;
+struct MiddlewareChain;
 
 // TODO: Optimize later like compressed_pair does, so only leaf nodes have callback use memory
 // In rest of the nodes, callback shouldn't take any memory
@@ -26,6 +27,14 @@ struct TrieNode {
 
     // Callback for GET or POST methods
     HttpCallbackType callback;
+
+    // Route reads its body through 'Async::ReadBody' / 'Async::SpillBody' instead of-
+    // -having it entirely in read buffer
+    bool streamBody = false;
+
+    // Global + per route middleware, flattened by 'HttpMiddleware' once everything is loaded
+    // nullptr means route has no middleware of its own, so only global ones run
+    mutable const MiddlewareChain* middleware = nullptr;
 };
 
 struct RouteSegment {
@@ -1,20 +1,30 @@
 #include "route_trie.hpp"
 
 #include "utils/backport/string.hpp"
+#include "utils/crypt/hash.hpp"
 #include "utils/logger/logger.hpp"
 
+#include <cstring>
+
 namespace WFX::Http {
 
-const TrieNode* RouteTrie::Insert(std::string_view fullRoute, HttpCallbackType handler)
+const TrieNode* RouteTrie::Insert(std::string_view fullRoute, HttpCallbackType handler, bool streamBody)
 {
-    TrieNode* node = InsertRoute(fullRoute);
-    node->callback = std::move(handler);
+    if(frozen_)
+        Logger::GetInstance().Fatal("[RouteTrie]: Route '", fullRoute, "' registered after routes were frozen.");
+
+    TrieNode* node   = InsertRoute(fullRoute);
+    node->callback   = std::move(handler);
+    node->streamBody = streamBody;
     return node; // Can be used for various stuff
 }
 
 const TrieNode* RouteTrie::Match(std::string_view requestPath, PathSegments& outParams) const
 {
-    const TrieNode* current = &root_;
+    if(!frozen_)
+        return nullptr;
+
+    std::uint32_t current = 0;
     requestPath = StripRoute(requestPath);
 
     while(!requestPath.empty()) {
@@ -24,93 +34,34 @@ const TrieNode* RouteTrie::Match(std::string_view requestPath, PathSegments& out
                                     : requestPath.substr(0, slashPos);
         requestPath = (slashPos == std::string_view::npos) ? std::string_view{} : requestPath.substr(slashPos + 1);
 
-        const TrieNode* next = nullptr;
-        DynamicSegment  paramCandidate;
-
-        for(const auto& child : current->children) {
-            if(child.IsStatic()) {
-                // Special Case: Wildcard '*' match, we copy the whole thing into DynamicSegment STRING type
-                if(child.MatchesStatic("*")) {
-                    std::size_t len = segment.size();
-                    
-                    if(!requestPath.empty())
-                        len += 1 + requestPath.size(); // include '/' and rest of path
-                    
-                    std::string_view captured(segment.data(), len);
-                    outParams.emplace_back(captured);
-
-                    // Signal that wildcard consumed all the remaining path
-                    requestPath = std::string_view{};
-                    next = child.GetChild();
-                    break;
-                }
+        const FlatNode& node = nodes_[current];
 
-                // Normal static match
-                if(child.MatchesStatic(segment)) {
-                    next = child.GetChild();
-                    break;
-                }
-            }
-            else if(child.IsParam()) {
-                ParamType type = child.GetParamType();
-
-                switch(type) {
-                    case ParamType::UINT:
-                    {
-                        std::uint64_t val;
-                        if(!StrToUInt64(segment, val))
-                            continue;
-                        
-                        paramCandidate = val;
-                        break;
-                    }
-
-                    case ParamType::INT:
-                    {
-                        std::int64_t val;
-                        if(!StrToInt64(segment, val))
-                            continue;
-                        
-                        paramCandidate = val;
-                        break;
-                    }
-
-                    case ParamType::UUID:
-                    {
-                        WFX::Utils::UUID uuid;
-                        if(!WFX::Utils::UUID::FromString(segment, uuid))
-                            continue;
-                        
-                        paramCandidate = uuid;
-                        break;
-                    }
-
-                    case ParamType::STRING:
-                        paramCandidate = segment;
-                        break;
-
-                    // Unknown or unsupported ParamType — this should not happen silently
-                    default:
-                        return nullptr;
-                }
+        std::uint32_t next = FindStatic(node, segment);
+        if(next == NO_NODE)
+            next = MatchParam(node, segment, outParams);
 
-                // Match found for dynamic segment — store parameter and proceed
-                next = child.GetChild();
-                outParams.emplace_back(std::move(paramCandidate));
-            }
+        // Special Case: Wildcard '*' match, we copy the whole thing into DynamicSegment STRING type
+        if(next == NO_NODE && node.wildcard != NO_NODE) {
+            std::size_t len = segment.size();
+
+            if(!requestPath.empty())
+                len += 1 + requestPath.size(); // include '/' and rest of path
+
+            outParams.emplace_back(std::string_view(segment.data(), len));
+
+            // Signal that wildcard consumed all the remaining path
+            requestPath = std::string_view{};
+            next = node.wildcard;
         }
 
-        if(!next)
+        if(next == NO_NODE)
             return nullptr;
 
         current = next;
     }
 
-    // Monostate signifies that it doesn't have any callback
-    if(std::holds_alternative<std::monostate>(current->callback))
-        return nullptr;
-
-    return current;
+    // nullptr if there is no callback here
+    return nodes_[current].route;
 }
 
 void RouteTrie::PushGroup(std::string_view prefix)
@@ -128,6 +79,87 @@ void RouteTrie::PopGroup()
     cursorStack_.pop_back();
 }
 
+void RouteTrie::Freeze()
+{
+    if(frozen_)
+        return;
+
+    if(!cursorStack_.empty())
+        Logger::GetInstance().Fatal("[RouteTrie]: PushGroup called without corresponding PopGroup.");
+
+    // Breadth first, so index of a node is known the moment its parent gets compiled
+    std::vector<const TrieNode*> order{&root_};
+
+    for(std::size_t i = 0; i < order.size(); i++) {
+        const TrieNode* node = order[i];
+        FlatNode        flat{};
+
+        // Monostate signifies that it doesn't have any callback
+        if(!std::holds_alternative<std::monostate>(node->callback))
+            flat.route = node;
+
+        std::size_t staticCount = 0;
+        for(const auto& child : node->children)
+            if(child.IsStatic() && !child.MatchesStatic("*"))
+                staticCount++;
+
+        // Table is kept at most half full, so lookups mostly hit on the first probe
+        if(staticCount > 0) {
+            std::size_t tableSize = 2;
+            while(tableSize < staticCount * 2)
+                tableSize <<= 1;
+
+            flat.slotBegin = static_cast<std::uint32_t>(slots_.size());
+            flat.slotMask  = static_cast<std::uint32_t>(tableSize - 1);
+            slots_.resize(slots_.size() + tableSize);
+        }
+
+        for(const auto& child : node->children) {
+            std::uint32_t childIdx = static_cast<std::uint32_t>(order.size());
+            order.push_back(child.GetChild());
+
+            if(child.IsParam()) {
+                flat.params[static_cast<std::size_t>(child.GetParamType())] = childIdx;
+                hasDynamic_ = true;
+                continue;
+            }
+
+            std::string_view key = *child.GetStaticKey();
+            if(key == "*") {
+                flat.wildcard = childIdx;
+                hasDynamic_   = true;
+                continue;
+            }
+
+            StaticSlot slot;
+            slot.hash      = HashSegment(key);
+            slot.child     = childIdx;
+            slot.keyOffset = static_cast<std::uint32_t>(keys_.size());
+            slot.keyLength = static_cast<std::uint32_t>(key.size());
+            keys_.append(key);
+
+            std::uint32_t pos = slot.hash & flat.slotMask;
+            while(slots_[flat.slotBegin + pos].child != NO_NODE)
+                pos = (pos + 1) & flat.slotMask;
+
+            slots_[flat.slotBegin + pos] = slot;
+        }
+
+        nodes_.push_back(flat);
+    }
+
+    nodes_.shrink_to_fit();
+    slots_.shrink_to_fit();
+    keys_.shrink_to_fit();
+    frozen_ = true;
+}
+
+void RouteTrie::CollectStaticRoutes(std::vector<std::pair<std::string, const TrieNode*>>& outRoutes) const
+{
+    std::string path;
+    CollectStaticRoutes(&root_, path, outRoutes);
+}
+
 // vvv HELPER FUNCTIONS vvv
 TrieNode* RouteTrie::InsertRoute(std::string_view route)
 {
@@ -182,9 +214,20 @@ TrieNode* RouteTrie::InsertRoute(std::string_view route)
                     "[Route-Formatter]: Unknown parameter type: '", type, "'. Valid types -> uint, int, uuid and string."
                 );
 
-            auto nextNode = std::make_unique<TrieNode>();
-            next = nextNode.get();
-            current->children.emplace_back(std::move(dynSeg), std::move(nextNode));
+            // Same type of param at the same place is the same node, '/a/<int>/b' and '/a/<int>/c'-
+            // -both go through it
+            for(auto& child : current->children) {
+                if(child.IsParam() && child.GetParam()->index() == dynSeg.index()) {
+                    next = child.GetChild();
+                    break;
+                }
+            }
+
+            if(!next) {
+                auto nextNode = std::make_unique<TrieNode>();
+                next = nextNode.get();
+                current->children.emplace_back(std::move(dynSeg), std::move(nextNode));
+            }
         }
         // Static segment
         else {
@@ -225,10 +268,93 @@ TrieNode* RouteTrie::InsertRoute(std::string_view route)
 std::string_view RouteTrie::StripRoute(std::string_view route)
 {
     // Leading slash removed
-    if(route.front() == '/')
+    if(!route.empty() && route.front() == '/')
         return route.substr(1);
 
     return route;
 }
 
+void RouteTrie::CollectStaticRoutes(const TrieNode* node, std::string& path,
+                                    std::vector<std::pair<std::string, const TrieNode*>>& outRoutes)
+{
+    if(!std::holds_alternative<std::monostate>(node->callback))
+        outRoutes.emplace_back(path.empty() ? std::string{"/"} : path, node);
+
+    for(const auto& child : node->children) {
+        // Anything below a param / wildcard needs the trie walk anyways
+        if(!child.IsStatic() || child.MatchesStatic("*"))
+            continue;
+
+        std::size_t oldSize = path.size();
+        path += '/';
+        path += *child.GetStaticKey();
+
+        CollectStaticRoutes(child.GetChild(), path, outRoutes);
+        path.resize(oldSize);
+    }
+}
+
+std::uint32_t RouteTrie::FindStatic(const FlatNode& node, std::string_view segment) const
+{
+    // Nodes with only params / wildcard have no table at all
+    if(node.slotMask == 0)
+        return NO_NODE;
+
+    std::uint32_t hash = HashSegment(segment);
+    std::uint32_t pos  = hash & node.slotMask;
+
+    while(true) {
+        const StaticSlot& slot = slots_[node.slotBegin + pos];
+        if(slot.child == NO_NODE)
+            return NO_NODE;
+
+        if(slot.hash == hash && slot.keyLength == segment.size()
+            && std::memcmp(keys_.data() + slot.keyOffset, segment.data(), segment.size()) == 0)
+            return slot.child;
+
+        pos = (pos + 1) & node.slotMask;
+    }
+}
+
+std::uint32_t RouteTrie::MatchParam(const FlatNode& node, std::string_view segment, PathSegments& outParams) const
+{
+    // Most specific type first, so '<uint>' and '<string>' can live next to each other
+    if(node.params[static_cast<std::size_t>(ParamType::UINT)] != NO_NODE) {
+        std::uint64_t val;
+        if(StrToUInt64(segment, val)) {
+            outParams.emplace_back(val);
+            return node.params[static_cast<std::size_t>(ParamType::UINT)];
+        }
+    }
+
+    if(node.params[static_cast<std::size_t>(ParamType::INT)] != NO_NODE) {
+        std::int64_t val;
+        if(StrToInt64(segment, val)) {
+            outParams.emplace_back(val);
+            return node.params[static_cast<std::size_t>(ParamType::INT)];
+        }
+    }
+
+    if(node.params[static_cast<std::size_t>(ParamType::UUID)] != NO_NODE) {
+        WFX::Utils::UUID uuid;
+        if(WFX::Utils::UUID::FromString(segment, uuid)) {
+            outParams.emplace_back(uuid);
+            return node.params[static_cast<std::size_t>(ParamType::UUID)];
+        }
+    }
+
+    if(node.params[static_cast<std::size_t>(ParamType::STRING)] != NO_NODE) {
+        outParams.emplace_back(segment);
+        return node.params[static_cast<std::size_t>(ParamType::STRING)];
+    }
+
+    return NO_NODE;
+}
+
+std::uint32_t RouteTrie::HashSegment(std::string_view segment)
+{
+    std::uint64_t hash = Hasher::Fnv1a(segment);
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
 } // namespace WFX::Http
\ No newline at end of file
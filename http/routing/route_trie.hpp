@@ -3,6 +3,7 @@
 
 #include "route_segment.hpp"
 
+#include <string>
 #include <string_view>
 
 namespace WFX::Http {
@@ -11,20 +12,66 @@ using namespace WFX::Utils; // For 'MoveOnlyFunction', 'Logger'
 
 class RouteTrie {
 public:    
-    const TrieNode* Insert(std::string_view fullRoute, HttpCallbackType handler);
+    const TrieNode* Insert(std::string_view fullRoute, HttpCallbackType handler, bool streamBody = false);
+
+    // Only works on a frozen trie. Per segment: Exact static match -> typed params (uint, int, uuid, string)-
+    // -> wildcard '*'. First one which matches wins, there is no backtracking
     const TrieNode* Match(std::string_view requestPath, PathSegments& outParams) const;
 
     void PushGroup(std::string_view prefix);
     void PopGroup();
 
+    // Compiles the trie into flat arrays used by 'Match', no routes can be added after this
+    void Freeze();
+    bool IsFrozen() const { return frozen_; }
+
+    // Any route with a param / wildcard segment, only those can match paths which aren't a static route
+    bool HasDynamicRoutes() const { return hasDynamic_; }
+
+    // Every route made up of only static segments, with its full path ('/a/b')
+    void CollectStaticRoutes(std::vector<std::pair<std::string, const TrieNode*>>& outRoutes) const;
+
 private: // Helper functions
     TrieNode* InsertRoute(std::string_view route);
     static std::string_view StripRoute(std::string_view route);
+    static void CollectStaticRoutes(const TrieNode* node, std::string& path,
+                                    std::vector<std::pair<std::string, const TrieNode*>>& outRoutes);
+
+private: // Compiled form
+    static constexpr std::uint32_t NO_NODE          = UINT32_MAX;
+    static constexpr std::size_t   PARAM_TYPE_COUNT = static_cast<std::size_t>(ParamType::UNKNOWN);
+
+    // One per TrieNode, laid out level by level so siblings sit next to each other
+    struct FlatNode {
+        const TrieNode* route       = nullptr;  // nullptr if there is no callback here
+        std::uint32_t   slotBegin   = 0;        // Static children, open addressing table in 'slots_'
+        std::uint32_t   slotMask    = 0;        // Table size - 1, table size is 0 if there are none
+        std::uint32_t   wildcard    = NO_NODE;
+        std::uint32_t   params[PARAM_TYPE_COUNT] = { NO_NODE, NO_NODE, NO_NODE, NO_NODE }; // By 'ParamType'
+    };
+
+    // 16 bytes, so a probe mostly stays within one cache line
+    struct StaticSlot {
+        std::uint32_t hash      = 0;
+        std::uint32_t child     = NO_NODE;      // NO_NODE marks an empty slot
+        std::uint32_t keyOffset = 0;            // Into 'keys_'
+        std::uint32_t keyLength = 0;
+    };
+
+    std::uint32_t FindStatic(const FlatNode& node, std::string_view segment) const;
+    std::uint32_t MatchParam(const FlatNode& node, std::string_view segment, PathSegments& outParams) const;
+    static std::uint32_t HashSegment(std::string_view segment);
 
 private:
     TrieNode root_;
     TrieNode* insertCursor_ = &root_;    // Current node where routes get inserted to
     std::vector<TrieNode*> cursorStack_; // For nesting
+
+    std::vector<FlatNode>   nodes_;      // nodes_[0] is root
+    std::vector<StaticSlot> slots_;
+    std::string             keys_;       // Every static segment back to back
+    bool                    frozen_     = false;
+    bool                    hasDynamic_ = false;
 };
 
 } // namespace WFX::Http
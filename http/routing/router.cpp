@@ -1,29 +1,26 @@
 #include "router.hpp"
+#include "utils/crypt/hash.hpp"
 #include "utils/logger/logger.hpp"
 #include "shared/utils/compiler_macro.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace WFX::Http {
 
 using namespace WFX::Utils; // For 'Logger'
 
-const TrieNode* Router::RegisterRoute(HttpMethod method, std::string_view path, HttpCallbackType handler)
+const TrieNode* Router::RegisterRoute(HttpMethod method, std::string_view path, HttpCallbackType handler, bool streamBody)
 {
     if(path.empty() || path[0] != '/')
         Logger::GetInstance().Fatal("[Router]: Path is either empty or does not start with '/'.");
 
-    switch(method) {
-        case HttpMethod::GET:
-            return getRoutes_.Insert(path, std::move(handler));
-
-        case HttpMethod::POST:
-            return postRoutes_.Insert(path, std::move(handler));
-
-        default:
-            Logger::GetInstance().Fatal(
-                "[Router]: Unsupported HTTP method found in RegisterRoute. Use HttpMethod::GET or HttpMethod::POST."
-            );
-            WFX_UNREACHABLE;
+    if(method == HttpMethod::UNKNOWN) {
+        Logger::GetInstance().Fatal("[Router]: Unsupported HTTP method found in RegisterRoute.");
+        WFX_UNREACHABLE;
     }
+
+    return routes_[static_cast<std::size_t>(method)].Insert(path, std::move(handler), streamBody);
 }
 
 const TrieNode* Router::MatchRoute(HttpMethod method, std::string_view path, PathSegments& outSegments) const
@@ -31,26 +28,186 @@ const TrieNode* Router::MatchRoute(HttpMethod method, std::string_view path, Pat
     // Strip query string before matching
     std::string_view queryStrippedPath = path.substr(0, path.find('?'));
 
-    switch(method) {
-        case HttpMethod::GET:
-            return getRoutes_.Match(queryStrippedPath, outSegments);
-        case HttpMethod::POST:
-            return postRoutes_.Match(queryStrippedPath, outSegments);
-        default:
-            return nullptr;
+    if(method == HttpMethod::UNKNOWN)
+        return nullptr;
+
+    if(auto node = MatchMethod(static_cast<std::size_t>(method), queryStrippedPath, outSegments))
+        return node;
+
+    // HEAD is GET without the body, so unless user registered it explicitly it goes to GET handler-
+    // -and engine just doesn't send the body
+    if(method == HttpMethod::HEAD) {
+        outSegments.clear();
+        return MatchMethod(static_cast<std::size_t>(HttpMethod::GET), queryStrippedPath, outSegments);
     }
+
+    return nullptr;
+}
+
+std::string_view Router::GetAllowedMethods(std::string_view path) const
+{
+    std::string_view queryStrippedPath = path.substr(0, path.find('?'));
+
+    // Static paths already had their methods worked out in 'Freeze', so its a single probe
+    // Tries ignore a trailing slash, table is keyed without it
+    std::string_view staticPath = queryStrippedPath;
+    if(staticPath.size() > 1 && staticPath.back() == '/')
+        staticPath.remove_suffix(1);
+
+    if(auto slot = FindExact(allStatic_, staticPath))
+        return allowTable_[slot->methods];
+
+    // Not a static route of any method, only tries with params / wildcards can still match it
+    return allowTable_[MatchMethods(queryStrippedPath, dynamicMethods_)];
 }
 
 void Router::PushRouteGroup(std::string_view prefix)
 {
-    getRoutes_.PushGroup(prefix);
-    postRoutes_.PushGroup(prefix);
+    for(auto& trie : routes_)
+        trie.PushGroup(prefix);
 }
 
 void Router::PopRouteGroup()
 {
-    getRoutes_.PopGroup();
-    postRoutes_.PopGroup();
+    for(auto& trie : routes_)
+        trie.PopGroup();
+}
+
+void Router::Freeze()
+{
+    StaticRoutes allRoutes;
+
+    for(std::size_t i = 0; i < METHOD_COUNT; i++) {
+        routes_[i].Freeze();
+
+        StaticRoutes routes;
+        routes_[i].CollectStaticRoutes(routes);
+        BuildExactTable(routes, exact_[i]);
+
+        if(routes_[i].HasDynamicRoutes())
+            dynamicMethods_ |= 1u << i;
+
+        allRoutes.insert(allRoutes.end(), routes.begin(), routes.end());
+    }
+
+    // Same path under multiple methods gets a single slot
+    std::sort(allRoutes.begin(), allRoutes.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    allRoutes.erase(std::unique(allRoutes.begin(), allRoutes.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; }), allRoutes.end());
+
+    // Every method is asked here, a static path of one method might be a param match for another
+    BuildExactTable(allRoutes, allStatic_);
+    for(auto& slot : allStatic_.slots)
+        if(slot.node)
+            slot.methods = MatchMethods(std::string_view{allStatic_.keys}.substr(slot.keyOffset, slot.keyLength), ALL_METHODS);
+
+    BuildAllowTable(allowTable_);
+}
+
+// vvv Helper Functions vvv
+void Router::BuildExactTable(const StaticRoutes& routes, ExactTable& table)
+{
+    table = ExactTable{};
+    if(routes.empty())
+        return;
+
+    // At most half full, so most lookups (hits or misses) end on first probe
+    std::size_t tableSize = 2;
+    while(tableSize < routes.size() * 2)
+        tableSize <<= 1;
+
+    table.slots.resize(tableSize);
+    table.mask = tableSize - 1;
+
+    for(auto& [path, node] : routes) {
+        ExactSlot slot;
+        slot.hash      = Hasher::Fnv1a(path);
+        slot.node      = node;
+        slot.keyOffset = static_cast<std::uint32_t>(table.keys.size());
+        slot.keyLength = static_cast<std::uint32_t>(path.size());
+        table.keys.append(path);
+
+        std::uint64_t pos = slot.hash & table.mask;
+        while(table.slots[pos].node)
+            pos = (pos + 1) & table.mask;
+
+        table.slots[pos] = slot;
+    }
+}
+
+const Router::ExactSlot* Router::FindExact(const ExactTable& table, std::string_view path)
+{
+    if(table.slots.empty())
+        return nullptr;
+
+    std::uint64_t hash = Hasher::Fnv1a(path);
+    std::uint64_t pos  = hash & table.mask;
+
+    while(true) {
+        const ExactSlot& slot = table.slots[pos];
+        if(!slot.node)
+            return nullptr;
+
+        if(slot.hash == hash && slot.keyLength == path.size()
+            && std::memcmp(table.keys.data() + slot.keyOffset, path.data(), path.size()) == 0)
+            return &slot;
+
+        pos = (pos + 1) & table.mask;
+    }
+}
+
+void Router::BuildAllowTable(AllowTable& table)
+{
+    // Only 2^7 combinations, cheaper to build all of them once than to format header on every miss
+    for(std::size_t mask = 0; mask < table.size(); mask++) {
+        std::string& allow = table[mask];
+        allow.clear();
+
+        for(std::size_t i = 0; i < METHOD_COUNT; i++) {
+            if(!(mask & (1u << i)))
+                continue;
+
+            if(!allow.empty())
+                allow.append(", ");
+            allow.append(HttpMethodToString(static_cast<HttpMethod>(i)));
+        }
+    }
+}
+
+const TrieNode* Router::MatchMethod(std::size_t index, std::string_view path, PathSegments& outParams) const
+{
+    // Most requests hit routes without params, those resolve in a single probe without splitting the path
+    if(auto slot = FindExact(exact_[index], path))
+        return slot->node;
+
+    return routes_[index].Match(path, outParams);
+}
+
+std::uint32_t Router::MatchMethods(std::string_view path, std::uint32_t candidates) const
+{
+    PathSegments  scratch;
+    std::uint32_t mask = 0;
+
+    // Tries hold static routes as well, so walking them alone is enough here
+    for(std::size_t i = 0; i < METHOD_COUNT; i++) {
+        if(!(candidates & (1u << i)))
+            continue;
+
+        if(routes_[i].Match(path, scratch))
+            mask |= 1u << i;
+        scratch.clear();
+    }
+
+    if(mask == 0)
+        return 0;
+
+    // GET implies HEAD, and anything we serve at all can be asked OPTIONS
+    if(mask & (1u << static_cast<std::size_t>(HttpMethod::GET)))
+        mask |= 1u << static_cast<std::size_t>(HttpMethod::HEAD);
+    mask |= 1u << static_cast<std::size_t>(HttpMethod::OPTIONS);
+
+    return mask;
 }
 
 } // namespace WFX::Http
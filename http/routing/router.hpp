@@ -5,6 +5,8 @@
 
 #include "http/constants/http_constants.hpp"
 
+#include <array>
+
 namespace WFX::Http {
 
 class Router {
@@ -13,15 +15,59 @@ public:
     ~Router() = default;
 
 public:
-    const TrieNode* RegisterRoute(HttpMethod method, std::string_view path, HttpCallbackType handler);
+    const TrieNode* RegisterRoute(HttpMethod method, std::string_view path, HttpCallbackType handler, bool streamBody = false);
     const TrieNode* MatchRoute(HttpMethod method, std::string_view path, PathSegments& outParams) const;
 
+    // Methods 'path' is registered for, already formatted for 'Allow' header (empty if none)
+    // Only meant for requests which missed, so 404 / 405 / OPTIONS don't have to be worked out per request
+    std::string_view GetAllowedMethods(std::string_view path) const;
+
     void PushRouteGroup(std::string_view prefix);
     void PopRouteGroup();
 
+    // Called by engine once user code registered everything, compiles every trie for matching
+    void Freeze();
+
+private:
+    static constexpr std::size_t   METHOD_COUNT = static_cast<std::size_t>(HttpMethod::UNKNOWN);
+    static constexpr std::uint32_t ALL_METHODS  = (1u << METHOD_COUNT) - 1;
+
+    using AllowTable   = std::array<std::string, 1 << METHOD_COUNT>;
+    using StaticRoutes = std::vector<std::pair<std::string, const TrieNode*>>;
+
+private: // Exact match for routes without any params, checked before walking the trie
+    struct ExactSlot {
+        std::uint64_t   hash      = 0;
+        const TrieNode* node      = nullptr; // nullptr marks an empty slot
+        std::uint32_t   keyOffset = 0;       // Into 'ExactTable::keys'
+        std::uint32_t   keyLength = 0;
+        std::uint32_t   methods   = 0;       // Only in 'allStatic_', index into 'allowTable_' for this path
+    };
+
+    struct ExactTable {
+        std::vector<ExactSlot> slots;
+        std::string            keys;         // Full paths back to back
+        std::uint64_t          mask = 0;     // Table size - 1, table is empty if there are no static routes
+    };
+
+    static void             BuildExactTable(const StaticRoutes& routes, ExactTable& table);
+    static const ExactSlot* FindExact(const ExactTable& table, std::string_view path);
+    static void             BuildAllowTable(AllowTable& table);
+
+    const TrieNode* MatchMethod(std::size_t index, std::string_view path, PathSegments& outParams) const;
+    std::uint32_t   MatchMethods(std::string_view path, std::uint32_t candidates) const;
+
 private:
-    RouteTrie getRoutes_;
-    RouteTrie postRoutes_;
+    std::array<RouteTrie,  METHOD_COUNT> routes_;
+    std::array<ExactTable, METHOD_COUNT> exact_;
+
+    // 'Allow' header value for every combination of methods, indexed by method bitmask
+    AllowTable allowTable_;
+
+    // Static paths of every method in one table, each slot knows which methods it answers to
+    // Only tries in 'dynamicMethods_' can match a path which isn't in here
+    ExactTable    allStatic_;
+    std::uint32_t dynamicMethods_ = 0;
 
     // No need for copy and move constructors
     Router(const Router&)            = delete;
@@ -37,6 +37,80 @@ inline SleepForAwaitable SleepFor(std::uint32_t delayMs)
     return SleepForAwaitable{delayMs};
 }
 
+// vvv Streamed Request Body (WFX_POST_STREAM routes) vvv
+struct BodyChunk {
+    std::string_view data;                          // Valid till next 'ReadBody', empty once body is over
+    BodyReadState    status = BodyReadState::READY; // FAILED for malformed / too large body
+};
+
+struct SpilledBody {
+    int           fd     = -1;                     // Read only from it, request owns it (closed after response)
+    std::uint64_t size   = 0;
+    BodyReadState status = BodyReadState::READY;
+};
+
+struct ReadBodyAwaitable {
+public: // Storage
+    BodyChunk chunk;
+
+public: // Main setup
+    // Chunk might already be sitting in read buffer, no need to suspend then
+    bool await_ready() noexcept {
+        chunk.status = __WFXApi->GetAsyncAPIV1()->ReadBodyChunk(
+                            __WFXApi->GetHttpAPIV1()->GetGlobalPtrData(), &chunk.data
+                        );
+        return chunk.status != BodyReadState::PENDING;
+    }
+
+    // Engine resumes us once more of body arrives
+    void await_suspend(std::coroutine_handle<>) noexcept {}
+
+    BodyChunk await_resume() noexcept {
+        if(chunk.status == BodyReadState::PENDING)
+            chunk.status = __WFXApi->GetAsyncAPIV1()->ReadBodyChunk(
+                                __WFXApi->GetHttpAPIV1()->GetGlobalPtrData(), &chunk.data
+                            );
+        return chunk;
+    }
+};
+
+struct SpillBodyAwaitable {
+public: // Storage
+    SpilledBody body;
+
+public: // Main setup
+    // Whole body might already be here, no need to suspend then
+    bool await_ready() noexcept {
+        body.status = __WFXApi->GetAsyncAPIV1()->SpillBody(
+                            __WFXApi->GetHttpAPIV1()->GetGlobalPtrData(), &body.fd, &body.size
+                        );
+        return body.status != BodyReadState::PENDING;
+    }
+
+    // Engine resumes us once entire body is in the file
+    void await_suspend(std::coroutine_handle<>) noexcept {}
+
+    SpilledBody await_resume() noexcept {
+        if(body.status == BodyReadState::PENDING)
+            body.status = __WFXApi->GetAsyncAPIV1()->SpillBody(
+                                __WFXApi->GetHttpAPIV1()->GetGlobalPtrData(), &body.fd, &body.size
+                            );
+        return body;
+    }
+};
+
+// Next piece of request body, read buffer gets reused for the one after it
+inline ReadBodyAwaitable ReadBody()
+{
+    return ReadBodyAwaitable{};
+}
+
+// Entire request body, written to an anonymous temp file as it arrives
+inline SpillBodyAwaitable SpillBody()
+{
+    return SpillBodyAwaitable{};
+}
+
 } // namespace Async
 
 #endif // WFX_INC_CXX_ASYNC_BUILTINS_HPP
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "validators.hpp"
 #include "sanitizers.hpp"
 #include "renders.hpp"
+#include "multipart.hpp"
 #include "http/aliases.hpp"
 #include "third_party/json/json.hpp"
 #include <array>
@@ -94,7 +95,8 @@ enum class FormError : std::uint8_t {
     NONE,
     UNSUPPORTED_CONTENT_TYPE,
     MALFORMED,
-    CLEAN_FAILED
+    CLEAN_FAILED,
+    SINK_FAILED
 };
 
 // vvv Main shit vvv
@@ -114,6 +116,161 @@ public: // Aliases
     using CleanedType = typename CleanedTupleFor<typename Fields::DescType...>::Type;
     using InputType   = std::array<std::string_view, FieldCount>;
 
+    // Text fields of a streamed multipart form are copied into reader, this caps how much of it there can be
+    static constexpr std::size_t DEFAULT_MAX_TEXT_SIZE = 65536;
+
+public: // Multipart
+    // Incremental multipart/form-data reader, body is fed to it as it comes in (Async::ReadBody)
+    // Text fields are collected and cleaned in 'Finish', file parts go straight to 'FileSink'-
+    // -as they arrive so an upload never has to sit in memory as a whole
+    // NOTE: Cleaned text fields point into reader, so reader must outlive the 'CleanedType' it filled
+    class MultipartReader : private MultipartParser::Handler {
+    public:
+        // 'stable': Everything fed stays valid for as long as the output does (entire body in memory)-
+        //           -so text fields can point right into it instead of being copied
+        MultipartReader(const FormSchema& schema, std::string_view boundary, FileSink* sink,
+                        bool stable = false, std::size_t maxTextSize = DEFAULT_MAX_TEXT_SIZE)
+            : schema_(&schema), sink_(sink), maxTextSize_(maxTextSize), stable_(stable)
+        {
+            if(!parser_.Reset(boundary))
+                error_ = FormError::MALFORMED;
+        }
+
+        // Empty chunk is a no-op, call 'Finish' once body is over
+        FormError Feed(std::string_view chunk)
+        {
+            if(error_ != FormError::NONE || chunk.empty())
+                return error_;
+
+            // On abort, whichever handler function bailed out already said why
+            if(parser_.Feed(chunk, *this) != MultipartParser::Result::OK && error_ == FormError::NONE)
+                error_ = FormError::MALFORMED;
+
+            return error_;
+        }
+
+        FormError Finish(CleanedType& out)
+        {
+            if(error_ != FormError::NONE)
+                return error_;
+
+            // Body ended before closing boundary
+            if(!parser_.IsDone())
+                return (error_ = FormError::MALFORMED);
+
+            InputType input{};
+            for(std::size_t i = 0; i < FieldCount; i++) {
+                const TextSlot& slot = slots_[i];
+                input[i] = slot.owned
+                            ? std::string_view{textStorage_.data() + slot.offset, slot.size}
+                            : std::string_view{slot.data, slot.size};
+            }
+
+            if(!schema_->Clean(input, out, std::make_index_sequence<FieldCount>{}))
+                error_ = FormError::CLEAN_FAILED;
+
+            return error_;
+        }
+
+        FormError GetError() const { return error_; }
+
+    private: // FormSchema sets up readers for non multipart requests
+        friend struct FormSchema;
+
+    private: // Parser Events
+        bool OnPartBegin(const MultipartParser::PartInfo& part) override
+        {
+            if(part.isFile) {
+                if(!sink_ || !sink_->OnFileBegin(FilePart{part.name, part.fileName, part.contentType}))
+                    return Abort(FormError::SINK_FAILED);
+
+                current_ = FILE_PART;
+                return true;
+            }
+
+            // Unlike urlencoded forms, browsers mix file parts in between so order isn't enforced here
+            // Unknown / repeated fields are still a no go
+            current_ = FieldCount;
+            for(std::size_t i = 0; i < FieldCount; i++)
+                if(schema_->fieldNames[i] == part.name) {
+                    current_ = i;
+                    break;
+                }
+
+            if(current_ == FieldCount || slots_[current_].seen)
+                return Abort(FormError::MALFORMED);
+
+            slots_[current_].seen = true;
+            return true;
+        }
+
+        bool OnPartData(std::string_view data, bool stable) override
+        {
+            if(current_ == FILE_PART)
+                return sink_->OnFileData(data) || Abort(FormError::SINK_FAILED);
+
+            TextSlot& slot = slots_[current_];
+
+            textSize_ += data.size();
+            if(textSize_ > maxTextSize_)
+                return Abort(FormError::MALFORMED);
+
+            // Entire value in one piece of fed data, nothing to copy
+            if(stable && stable_ && slot.size == 0) {
+                slot.data = data.data();
+                slot.size = data.size();
+                return true;
+            }
+
+            // Output can't point into a stable body if value had to be put together from pieces
+            if(stable_)
+                return Abort(FormError::MALFORMED);
+
+            if(!slot.owned) {
+                slot.offset = textStorage_.size();
+                slot.owned  = true;
+            }
+            textStorage_.append(data);
+            slot.size += data.size();
+            return true;
+        }
+
+        bool OnPartEnd() override
+        {
+            bool ok  = (current_ != FILE_PART) || sink_->OnFileEnd() || Abort(FormError::SINK_FAILED);
+            current_ = FieldCount;
+            return ok;
+        }
+
+        bool Abort(FormError error)
+        {
+            error_ = error;
+            return false;
+        }
+
+    private: // Storage
+        static constexpr std::size_t FILE_PART = static_cast<std::size_t>(-1);
+
+        struct TextSlot {
+            const char* data   = nullptr;
+            std::size_t size   = 0;
+            std::size_t offset = 0;     // Into 'textStorage_' if owned
+            bool        owned  = false;
+            bool        seen   = false;
+        };
+
+        const FormSchema*                  schema_;
+        FileSink*                          sink_;
+        MultipartParser                    parser_;
+        std::array<TextSlot, FieldCount>   slots_{};
+        std::string                        textStorage_;
+        std::size_t                        textSize_    = 0;
+        std::size_t                        maxTextSize_ = DEFAULT_MAX_TEXT_SIZE;
+        std::size_t                        current_     = FieldCount;
+        FormError                          error_       = FormError::NONE;
+        bool                               stable_      = false;
+    };
+
 public:
     template<std::size_t N>
     constexpr FormSchema(const char (&formName)[N], Fields&&... f)
@@ -132,9 +289,10 @@ public:
 
 public: // Main Functions
     // Auto select the parsing type looking at the header
-    FormError Parse(Request& req, CleanedType& out) const
+    // 'sink' receives file parts of multipart forms, without it forms with files are rejected
+    FormError Parse(Request& req, CleanedType& out, FileSink* sink = nullptr) const
     {
-        auto [exists, hptr] = req.headers.CheckAndGetHeader("Content-Type");
+        auto [exists, hptr] = req.headers.CheckAndGetHeader(Http::KnownHeader::CONTENT_TYPE);
         if(!exists)
             return FormError::UNSUPPORTED_CONTENT_TYPE;
 
@@ -150,6 +308,12 @@ public: // Main Functions
         ))
             return ParseStatic(req.body, out);
 
+        // Entire body is in memory (non streaming route), text fields point right into it
+        if(WFX::Utils::StringCanonical::InsensitiveStringCompare(
+            ct, "multipart/form-data"
+        ))
+            return ParseMultipart(req.body, GetMultipartBoundary(*hptr), out, sink);
+
         // Other types of forms are not supported for now
         return FormError::UNSUPPORTED_CONTENT_TYPE;
     }
@@ -168,6 +332,33 @@ public: // Main Functions
         );
     }
 
+    // Parse multipart/form-data which is entirely in memory
+    FormError ParseMultipart(std::string_view body, std::string_view boundary,
+                             CleanedType& out, FileSink* sink = nullptr) const
+    {
+        MultipartReader reader{*this, boundary, sink, true};
+
+        FormError err = reader.Feed(body);
+        return (err != FormError::NONE) ? err : reader.Finish(out);
+    }
+
+    // Reader for multipart/form-data body of a streaming route (WFX_POST_STREAM), fed chunk by chunk
+    // If request isn't multipart, reader just fails with FormError::UNSUPPORTED_CONTENT_TYPE
+    MultipartReader StreamMultipart(Request& req, FileSink* sink = nullptr,
+                                    std::size_t maxTextSize = DEFAULT_MAX_TEXT_SIZE) const
+    {
+        auto [exists, hptr] = req.headers.CheckAndGetHeader(Http::KnownHeader::CONTENT_TYPE);
+
+        std::string_view ct = exists ? WFX::Utils::TrimView((*hptr).substr(0, hptr->find(';'))) : "";
+        if(!WFX::Utils::StringCanonical::InsensitiveStringCompare(ct, "multipart/form-data")) {
+            MultipartReader reader{*this, {}, sink, false, maxTextSize};
+            reader.error_ = FormError::UNSUPPORTED_CONTENT_TYPE;
+            return reader;
+        }
+
+        return MultipartReader{*this, GetMultipartBoundary(*hptr), sink, false, maxTextSize};
+    }
+
     // Returns view to pre-rendered fields. NOTE: <form></form> needs to be written by user
     std::string_view Render() const
     {
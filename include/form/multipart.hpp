@@ -0,0 +1,437 @@
+#ifndef WFX_INC_FORM_MULTIPART_HPP
+#define WFX_INC_FORM_MULTIPART_HPP
+
+#include "utils/backport/string.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace Form {
+
+// vvv File Parts vvv
+struct FilePart {
+    std::string_view field;       // 'name' of the part
+    std::string_view fileName;    // 'filename' as sent by client, never use it as a path directly
+    std::string_view contentType; // 'application/octet-stream' if part didn't specify one
+};
+
+// Receives file parts of a multipart form piece by piece as they arrive, none of it is buffered by us
+// 'part' stays valid till 'OnFileEnd', 'data' only during the call
+// Returning false from any of them aborts the parse (FormError::SINK_FAILED)
+class FileSink {
+public:
+    virtual ~FileSink() = default;
+
+    virtual bool OnFileBegin(const FilePart& part) = 0;
+    virtual bool OnFileData(std::string_view data) = 0;
+    virtual bool OnFileEnd()                       = 0;
+};
+
+// vvv Multipart Framing vvv
+// Push parser for multipart/form-data (RFC 7578), body can be fed in pieces of any size
+// Part data is handed out as views into whatever was fed, only the few bytes at the end of a-
+// -piece which might be the start of a boundary are held back (copied) till the next one
+class MultipartParser {
+public:
+    static constexpr std::size_t MAX_BOUNDARY_SIZE    = 70;   // RFC 2046
+    static constexpr std::size_t MAX_PART_HEADER_SIZE = 8192;
+
+    struct PartInfo {
+        std::string_view name;
+        std::string_view fileName;
+        std::string_view contentType;
+        bool             isFile = false; // 'filename' was there, even if empty (no file picked)
+    };
+
+    enum class Result : std::uint8_t {
+        OK,
+        MALFORMED,
+        ABORTED     // One of the handler functions returned false
+    };
+
+    class Handler {
+    public:
+        // 'part' is valid till 'OnPartEnd'
+        virtual bool OnPartBegin(const PartInfo& part) = 0;
+        // 'stable' is false when 'data' points into our own held back bytes instead of fed data
+        virtual bool OnPartData(std::string_view data, bool stable) = 0;
+        virtual bool OnPartEnd() = 0;
+
+    protected:
+        ~Handler() = default;
+    };
+
+public:
+    MultipartParser() = default;
+
+    // False if boundary isn't valid, parser is unusable then
+    bool Reset(std::string_view boundary)
+    {
+        carry_.clear();
+        headers_.clear();
+        atStart_ = true;
+
+        if(boundary.empty() || boundary.size() > MAX_BOUNDARY_SIZE) {
+            state_ = State::FAILED;
+            return false;
+        }
+
+        delimiter_.assign("\r\n--");
+        delimiter_.append(boundary);
+        state_ = State::PREAMBLE;
+        return true;
+    }
+
+    Result Feed(std::string_view data, Handler& handler)
+    {
+        Result result = Result::OK;
+
+        // Bytes held back from last time go first, topped up with just enough of new data to make-
+        // -a call on them. Whatever is left after that came from 'data' itself so its picked up-
+        // -from there again instead of being copied around
+        while(!carry_.empty() && !data.empty()) {
+            std::size_t added = std::min(data.size(), delimiter_.size());
+            carry_.append(data.data(), added);
+
+            std::size_t used = Process(carry_, false, handler, result);
+            if(result != Result::OK)
+                return result;
+
+            std::size_t left = carry_.size() - used;
+            if(left <= added) {
+                data.remove_prefix(added - left);
+                carry_.clear();
+            }
+            else {
+                carry_.erase(0, used);
+                data.remove_prefix(added);
+            }
+        }
+
+        if(carry_.empty() && !data.empty()) {
+            std::size_t used = Process(data, true, handler, result);
+            if(result != Result::OK)
+                return result;
+
+            carry_.assign(data.data() + used, data.size() - used);
+        }
+
+        return result;
+    }
+
+    // Closing boundary was seen, anything after it is ignored
+    bool IsDone() const { return state_ == State::EPILOGUE; }
+
+private: // Helper Functions
+    std::size_t Process(std::string_view data, bool stable, Handler& handler, Result& result)
+    {
+        std::size_t pos = 0;
+
+        while(pos < data.size()) {
+            std::string_view rest = data.substr(pos);
+
+            switch(state_) {
+                case State::PREAMBLE:
+                {
+                    // Body usually starts right with the boundary, which has no CRLF in front of it
+                    if(atStart_) {
+                        std::string_view dashBoundary = std::string_view{delimiter_}.substr(2);
+                        std::size_t      n            = std::min(rest.size(), dashBoundary.size());
+
+                        if(rest.substr(0, n) == dashBoundary.substr(0, n)) {
+                            if(n < dashBoundary.size())
+                                return pos;
+
+                            atStart_ = false;
+                            pos     += n;
+                            state_   = State::DELIMITER_TAIL;
+                            break;
+                        }
+                        atStart_ = false;
+                    }
+
+                    // Preamble is ignored
+                    std::size_t at = WFX::Utils::StringSearch::Find(rest, delimiter_);
+                    if(at == std::string_view::npos)
+                        return data.size() - PartialDelimiter(rest);
+
+                    pos   += at + delimiter_.size();
+                    state_ = State::DELIMITER_TAIL;
+                    break;
+                }
+
+                case State::DELIMITER_TAIL:
+                {
+                    // '--' means it was the closing one, otherwise (optional padding) CRLF
+                    char c = rest[0];
+                    if(c == ' ' || c == '\t') {
+                        pos++;
+                        break;
+                    }
+
+                    if(rest.size() < 2)
+                        return pos;
+
+                    if(c == '-' && rest[1] == '-')
+                        state_ = State::EPILOGUE;
+                    else if(c == '\r' && rest[1] == '\n') {
+                        headers_.clear();
+                        state_ = State::PART_HEADERS;
+                    }
+                    else
+                        return Fail(result, Result::MALFORMED, pos);
+
+                    pos += 2;
+                    break;
+                }
+
+                case State::PART_HEADERS:
+                {
+                    // Headers are tiny, so they are just collected as is. Only consume them and not the data after it
+                    std::size_t old   = headers_.size();
+                    std::size_t taken = std::min(rest.size(), MAX_PART_HEADER_SIZE - old);
+                    headers_.append(rest.data(), taken);
+
+                    // Part without any headers can't be a form field
+                    if(headers_.size() >= 2 && headers_[0] == '\r' && headers_[1] == '\n')
+                        return Fail(result, Result::MALFORMED, pos);
+
+                    std::size_t end = headers_.find("\r\n\r\n", old >= 3 ? old - 3 : 0);
+                    if(end == std::string::npos) {
+                        if(headers_.size() >= MAX_PART_HEADER_SIZE)
+                            return Fail(result, Result::MALFORMED, pos);
+
+                        pos += taken;
+                        break;
+                    }
+
+                    pos += end + 4 - old;
+                    headers_.resize(end + 2);
+
+                    if(!ParsePartHeaders())
+                        return Fail(result, Result::MALFORMED, pos);
+
+                    if(!handler.OnPartBegin(part_))
+                        return Fail(result, Result::ABORTED, pos);
+
+                    state_ = State::PART_DATA;
+                    break;
+                }
+
+                case State::PART_DATA:
+                {
+                    std::size_t at = WFX::Utils::StringSearch::Find(rest, delimiter_);
+
+                    // No boundary in sight, hand out everything except what could be the start of one
+                    if(at == std::string_view::npos) {
+                        std::size_t emit = rest.size() - PartialDelimiter(rest);
+                        if(emit > 0 && !handler.OnPartData(rest.substr(0, emit), stable))
+                            return Fail(result, Result::ABORTED, pos);
+
+                        return pos + emit;
+                    }
+
+                    if(at > 0 && !handler.OnPartData(rest.substr(0, at), stable))
+                        return Fail(result, Result::ABORTED, pos);
+
+                    if(!handler.OnPartEnd())
+                        return Fail(result, Result::ABORTED, pos);
+
+                    pos   += at + delimiter_.size();
+                    state_ = State::DELIMITER_TAIL;
+                    break;
+                }
+
+                case State::EPILOGUE:
+                    return data.size();
+
+                case State::FAILED:
+                default:
+                    return Fail(result, Result::MALFORMED, pos);
+            }
+        }
+
+        return pos;
+    }
+
+    std::size_t Fail(Result& result, Result reason, std::size_t pos)
+    {
+        result = reason;
+        state_ = State::FAILED;
+        return pos;
+    }
+
+    // Length of the tail of 'data' which matches the beginning of delimiter, it has to wait for more data
+    std::size_t PartialDelimiter(std::string_view data) const
+    {
+        std::size_t from = data.size() >= delimiter_.size() ? data.size() - delimiter_.size() + 1 : 0;
+
+        while(from < data.size()) {
+            const void* cr = std::memchr(data.data() + from, '\r', data.size() - from);
+            if(!cr)
+                return 0;
+
+            from = static_cast<std::size_t>(static_cast<const char*>(cr) - data.data());
+            if(delimiter_.compare(0, data.size() - from, data.data() + from, data.size() - from) == 0)
+                return data.size() - from;
+
+            from++;
+        }
+        return 0;
+    }
+
+    // We only care about Content-Disposition and Content-Type, rest is ignored
+    bool ParsePartHeaders()
+    {
+        using WFX::Utils::StringCanonical::InsensitiveStringCompare;
+
+        std::string_view block = headers_;
+        bool             hasDisposition = false;
+
+        part_ = PartInfo{};
+        part_.contentType = "application/octet-stream";
+
+        while(!block.empty()) {
+            std::size_t lineEnd = block.find("\r\n");
+            if(lineEnd == std::string_view::npos)
+                return false;
+
+            std::string_view line  = block.substr(0, lineEnd);
+            block.remove_prefix(lineEnd + 2);
+
+            std::size_t colon = line.find(':');
+            if(colon == std::string_view::npos || colon == 0)
+                return false;
+
+            std::string_view name  = line.substr(0, colon);
+            std::string_view value = WFX::Utils::TrimView(line.substr(colon + 1));
+
+            if(InsensitiveStringCompare(name, "Content-Type")) {
+                if(!value.empty())
+                    part_.contentType = value;
+            }
+            else if(InsensitiveStringCompare(name, "Content-Disposition")) {
+                if(hasDisposition || !ParseDisposition(value))
+                    return false;
+                hasDisposition = true;
+            }
+        }
+
+        return hasDisposition;
+    }
+
+    // form-data; name="field"; filename="file.txt"
+    bool ParseDisposition(std::string_view value)
+    {
+        using WFX::Utils::StringCanonical::InsensitiveStringCompare;
+
+        std::size_t semi = value.find(';');
+        if(!InsensitiveStringCompare(WFX::Utils::TrimView(value.substr(0, semi)), "form-data"))
+            return false;
+
+        bool hasName = false;
+
+        while(semi != std::string_view::npos) {
+            value = value.substr(semi + 1);
+
+            std::size_t eq = value.find('=');
+            if(eq == std::string_view::npos)
+                return false;
+
+            std::string_view key = WFX::Utils::TrimView(value.substr(0, eq));
+            value = value.substr(eq + 1);
+            while(!value.empty() && (value[0] == ' ' || value[0] == '\t'))
+                value.remove_prefix(1);
+
+            std::string_view param;
+
+            // Quoted string, browsers percent encode quotes inside of it so no unescaping needed
+            if(!value.empty() && value[0] == '"') {
+                std::size_t close = value.find('"', 1);
+                if(close == std::string_view::npos)
+                    return false;
+
+                param = value.substr(1, close - 1);
+                semi  = value.find(';', close + 1);
+            }
+            else {
+                semi  = value.find(';');
+                param = WFX::Utils::TrimView(value.substr(0, semi));
+            }
+
+            // 'filename*' (RFC 5987) is ignored, every browser sends plain 'filename' anyways
+            if(InsensitiveStringCompare(key, "name")) {
+                part_.name = param;
+                hasName    = true;
+            }
+            else if(InsensitiveStringCompare(key, "filename")) {
+                part_.fileName = param;
+                part_.isFile   = true;
+            }
+        }
+
+        return hasName;
+    }
+
+private: // Storage
+    enum class State : std::uint8_t {
+        PREAMBLE,
+        DELIMITER_TAIL,
+        PART_HEADERS,
+        PART_DATA,
+        EPILOGUE,
+        FAILED
+    };
+
+    std::string delimiter_;  // "\r\n--" + boundary
+    std::string carry_;      // Held back bytes, always shorter than delimiter
+    std::string headers_;    // Headers of current part, 'part_' points into it
+    PartInfo    part_;
+    State       state_   = State::FAILED;
+    bool        atStart_ = true;
+};
+
+// vvv Helper Functions vvv
+// 'boundary' parameter of a multipart Content-Type, empty if its missing or invalid
+inline std::string_view GetMultipartBoundary(std::string_view contentType)
+{
+    using WFX::Utils::StringCanonical::ToLowerAscii;
+
+    constexpr std::string_view key = "boundary=";
+
+    for(std::size_t semi = contentType.find(';'); semi != std::string_view::npos; semi = contentType.find(';', semi + 1)) {
+        std::string_view param = WFX::Utils::TrimView(contentType.substr(semi + 1));
+        if(param.size() < key.size())
+            continue;
+
+        bool match = true;
+        for(std::size_t i = 0; i < key.size() && match; i++)
+            match = ToLowerAscii(static_cast<std::uint8_t>(param[i])) == static_cast<std::uint8_t>(key[i]);
+
+        if(!match)
+            continue;
+
+        std::string_view boundary = param.substr(key.size());
+
+        if(!boundary.empty() && boundary[0] == '"') {
+            std::size_t close = boundary.find('"', 1);
+            if(close == std::string_view::npos)
+                return {};
+            boundary = boundary.substr(1, close - 1);
+        }
+        else
+            boundary = WFX::Utils::TrimView(boundary.substr(0, boundary.find(';')));
+
+        if(boundary.empty() || boundary.size() > MultipartParser::MAX_BOUNDARY_SIZE)
+            return {};
+
+        return boundary;
+    }
+
+    return {};
+}
+
+} // namespace Form
+
+#endif // WFX_INC_FORM_MULTIPART_HPP
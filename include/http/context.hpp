@@ -0,0 +1,24 @@
+#ifndef WFX_INC_HTTP_CONTEXT_MACROS_HPP
+#define WFX_INC_HTTP_CONTEXT_MACROS_HPP
+
+#include "aliases.hpp"
+
+// vvv CONTEXT KEY MACROS vvv
+/*
+ * Typed request context key, declare it once (in a header) and share it between middleware and routes
+ *     WFX_CONTEXT_KEY(UserId, std::uint64_t);
+ *
+ *     req.SetContext<UserId>(42);
+ *     if(auto* id = req.GetContext<UserId>()) { ... }
+ *
+ * Slot is picked at runtime when user code is loaded (static init), so lookups are a bit test + pointer load
+ * Going over 32 keys / 256 bytes in total stops the server right at startup
+ */
+#define WFX_CONTEXT_KEY(name, type)                                                \
+    struct name {                                                                  \
+        using ValueType = type;                                                    \
+        static inline const WFX::Http::ContextSlot slot =                          \
+            WFX::Http::ContextRegistry::Register<type>(#name);                     \
+    }
+
+#endif // WFX_INC_HTTP_CONTEXT_MACROS_HPP
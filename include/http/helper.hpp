@@ -27,6 +27,21 @@ HttpCallbackType MakeHttpCallbackFromLambda(Lambda&& cb)
         );
 }
 
+template<typename Lambda>
+HttpCallbackType MakeStreamCallbackFromLambda(Lambda&& cb)
+{
+    using Request = WFX::Http::HttpRequest;
+
+    // Body arrives while handler is running, so handler has to be able to wait on it
+    static_assert(
+        std::is_invocable_r_v<AsyncVoid, Lambda, Request&, Response>,
+        "[UserSide:Http-Callback]: Invalid streaming route callback. Expected:\n"
+        "  - Async callback: AsyncVoid(Request&, Response)\n"
+    );
+
+    return AsyncCallbackType{std::forward<Lambda>(cb)};
+}
+
 // vvv Middleware Stuff vvv
 template<typename Lambda>
 inline HttpMiddlewareType MakeMiddlewareEntry(Lambda&& cb)
@@ -2,6 +2,7 @@
 #define WFX_INC_HTTP_MIDDLEWARE_MACROS_HPP
 
 #include "aliases.hpp"
+#include "context.hpp"
 #include "response.hpp"
 #include "helper.hpp"
 #include "core/core.hpp"
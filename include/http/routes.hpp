@@ -2,6 +2,7 @@
 #define WFX_INC_HTTP_ROUTE_MACROS_HPP
 
 #include "aliases.hpp"
+#include "context.hpp"
 #include "helper.hpp"
 #include "response.hpp"
 #include "core/core.hpp"
@@ -38,18 +39,52 @@
         } WFX_ROUTE_INSTANCE(uniq);                                           \
     }
 
+#define WFX_INTERNAL_ROUTE_REGISTER_STREAM_IMPL(method, path, mw, callback, uniq) \
+    namespace {                                                                   \
+        struct WFX_ROUTE_CLASS(method, uniq) {                                    \
+            WFX_ROUTE_CLASS(method, uniq)() {                                     \
+                WFX::Shared::__WFXDeferredRoutes.emplace_back([] {                \
+                    __WFXApi->GetHttpAPIV1()->RegisterStreamRoute(                \
+                        WFX::Http::HttpMethod::method, path, mw, callback         \
+                    );                                                            \
+                });                                                               \
+            }                                                                     \
+        } WFX_ROUTE_INSTANCE(uniq);                                               \
+    }
+
 #define WFX_INTERNAL_ROUTE_REGISTER(method, path, callback)             \
     WFX_INTERNAL_ROUTE_REGISTER_IMPL(method, path, callback, __COUNTER__)
 
 #define WFX_INTERNAL_ROUTE_REGISTER_EX(method, path, mw, callback)      \
     WFX_INTERNAL_ROUTE_REGISTER_EX_IMPL(method, path, mw, callback, __COUNTER__)
 
+#define WFX_INTERNAL_ROUTE_REGISTER_STREAM(method, path, mw, callback)  \
+    WFX_INTERNAL_ROUTE_REGISTER_STREAM_IMPL(method, path, mw, callback, __COUNTER__)
+
 // vvv HTTP MACROS vvv
-#define WFX_GET(path, cb)  WFX_INTERNAL_ROUTE_REGISTER(GET, path, MakeHttpCallbackFromLambda(cb))
-#define WFX_POST(path, cb) WFX_INTERNAL_ROUTE_REGISTER(POST, path, MakeHttpCallbackFromLambda(cb))
+// NOTE: GET routes answer HEAD as well (without body) unless HEAD is registered explicitly
+//       OPTIONS and 405 are answered by engine, register OPTIONS yourself only if you need more (CORS)
+#define WFX_GET(path, cb)     WFX_INTERNAL_ROUTE_REGISTER(GET, path, MakeHttpCallbackFromLambda(cb))
+#define WFX_POST(path, cb)    WFX_INTERNAL_ROUTE_REGISTER(POST, path, MakeHttpCallbackFromLambda(cb))
+#define WFX_PUT(path, cb)     WFX_INTERNAL_ROUTE_REGISTER(PUT, path, MakeHttpCallbackFromLambda(cb))
+#define WFX_PATCH(path, cb)   WFX_INTERNAL_ROUTE_REGISTER(PATCH, path, MakeHttpCallbackFromLambda(cb))
+#define WFX_DELETE(path, cb)  WFX_INTERNAL_ROUTE_REGISTER(DELETE, path, MakeHttpCallbackFromLambda(cb))
+#define WFX_HEAD(path, cb)    WFX_INTERNAL_ROUTE_REGISTER(HEAD, path, MakeHttpCallbackFromLambda(cb))
+#define WFX_OPTIONS(path, cb) WFX_INTERNAL_ROUTE_REGISTER(OPTIONS, path, MakeHttpCallbackFromLambda(cb))
+
+#define WFX_GET_EX(path, mw, cb)     WFX_INTERNAL_ROUTE_REGISTER_EX(GET, path, mw, MakeHttpCallbackFromLambda(cb))
+#define WFX_POST_EX(path, mw, cb)    WFX_INTERNAL_ROUTE_REGISTER_EX(POST, path, mw, MakeHttpCallbackFromLambda(cb))
+#define WFX_PUT_EX(path, mw, cb)     WFX_INTERNAL_ROUTE_REGISTER_EX(PUT, path, mw, MakeHttpCallbackFromLambda(cb))
+#define WFX_PATCH_EX(path, mw, cb)   WFX_INTERNAL_ROUTE_REGISTER_EX(PATCH, path, mw, MakeHttpCallbackFromLambda(cb))
+#define WFX_DELETE_EX(path, mw, cb)  WFX_INTERNAL_ROUTE_REGISTER_EX(DELETE, path, mw, MakeHttpCallbackFromLambda(cb))
+#define WFX_HEAD_EX(path, mw, cb)    WFX_INTERNAL_ROUTE_REGISTER_EX(HEAD, path, mw, MakeHttpCallbackFromLambda(cb))
+#define WFX_OPTIONS_EX(path, mw, cb) WFX_INTERNAL_ROUTE_REGISTER_EX(OPTIONS, path, mw, MakeHttpCallbackFromLambda(cb))
 
-#define WFX_GET_EX(path, mw, cb)  WFX_INTERNAL_ROUTE_REGISTER_EX(GET, path, mw, MakeHttpCallbackFromLambda(cb))
-#define WFX_POST_EX(path, mw, cb) WFX_INTERNAL_ROUTE_REGISTER_EX(POST, path, mw, MakeHttpCallbackFromLambda(cb))
+// Body isn't buffered for these, handler reads it via 'Async::ReadBody' / 'Async::SpillBody'
+#define WFX_POST_STREAM(path, cb)         WFX_INTERNAL_ROUTE_REGISTER_STREAM(POST, path, HttpMiddlewareStack{}, MakeStreamCallbackFromLambda(cb))
+#define WFX_POST_STREAM_EX(path, mw, cb)  WFX_INTERNAL_ROUTE_REGISTER_STREAM(POST, path, mw, MakeStreamCallbackFromLambda(cb))
+#define WFX_PUT_STREAM(path, cb)          WFX_INTERNAL_ROUTE_REGISTER_STREAM(PUT, path, HttpMiddlewareStack{}, MakeStreamCallbackFromLambda(cb))
+#define WFX_PUT_STREAM_EX(path, mw, cb)   WFX_INTERNAL_ROUTE_REGISTER_STREAM(PUT, path, mw, MakeStreamCallbackFromLambda(cb))
 
 // vvv ROUTE GROUPING vvv
 #define WFX_GROUP_START_IMPL(path, id)                                \
@@ -4,6 +4,7 @@
 
 #include "http/common/http_error_msgs.hpp"
 #include "http/common/http_global_state.hpp"
+#include "http/formatters/serializer/http_serializer.hpp"
 #include "http/ssl/http_ssl_factory.hpp"
 #include <sys/sendfile.h>
 #include <sys/socket.h>
@@ -13,6 +14,7 @@
 #include <netinet/tcp.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <linux/errqueue.h>
 #include <errno.h>
 
 namespace WFX::OSSpecific {
@@ -65,6 +67,13 @@ void EpollConnectionHandler::Initialize(const std::string& host, int port)
     // Idk but shits necessary btw, need zeroed out stuff or 'AllocSlot' stuff dies
     std::fill_n(connBitmap_.get(), connWords_, 0);
 
+    // Zero copy only makes sense for plain sockets, with SSL the data gets encrypted into-
+    // -OpenSSL's own buffer so there is nothing of ours left for the kernel to reference
+    if(networkConfig.zeroCopyThreshold > 0 && !useHttps_) {
+        zeroCopyThreshold_ = networkConfig.zeroCopyThreshold;
+        zeroCopy_          = std::make_unique<ZeroCopyTrack[]>(connSlots_);
+    }
+
     listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
     if(listenFd_ < 0)
         logger_.Fatal("[Epoll]: Failed to create listening socket: ", strerror(errno));
@@ -150,6 +159,20 @@ void EpollConnectionHandler::Initialize(const std::string& host, int port)
     aev.data.fd = asyncTimerFd_;
     if(epoll_ctl(epollFd_, EPOLL_CTL_ADD, asyncTimerFd_, &aev) < 0)
         logger_.Fatal("[Epoll]: Failed to add async timer to epoll: ", strerror(errno));
+
+    // vvv File change notifications vvv
+    // Owned by 'FileCache', only there if it watches anything. Not fatal, cache falls back to-
+    // -revalidating entries itself
+    fileWatchFd_ = fileCache_.GetWatchFd();
+    if(fileWatchFd_ >= 0) {
+        epoll_event wev{};
+        wev.events  = EPOLLIN;
+        wev.data.fd = fileWatchFd_;
+        if(epoll_ctl(epollFd_, EPOLL_CTL_ADD, fileWatchFd_, &wev) < 0) {
+            logger_.Warn("[Epoll]: Failed to add file watch to epoll: ", strerror(errno));
+            fileWatchFd_ = -1;
+        }
+    }
 }
 
 void EpollConnectionHandler::SetEngineCallbacks(ReceiveCallback onData, CompletionCallback onComplete)
@@ -166,6 +189,12 @@ void EpollConnectionHandler::ResumeReceive(ConnectionContext* ctx)
 
     // We are ready to data now, set 'eventType' to EVENT_RECV
     ctx->eventType = EventType::EVENT_RECV;
+
+    // Data which came in while we were busy (still in socket, edge triggered epoll won't tell us-
+    // -again) or pipelined request already in read buffer. We are usually deep inside of previous-
+    // -request's completion here, so let 'Run' pick it up instead of recursing
+    if(ctx->isRecvPending || ctx->HasPipelinedData())
+        pipelineQueue_.push_back((static_cast<std::uint64_t>(ctx->generationId) << 32) | (ctx - &connections_[0]));
 }
 
 void EpollConnectionHandler::Write(ConnectionContext* ctx, std::string_view msg)
@@ -179,20 +208,20 @@ void EpollConnectionHandler::Write(ConnectionContext* ctx, std::string_view msg)
         goto __CleanupOrRearm;
     }
     
-    // Case 2: Send from buffer
+    // Case 2: Send from buffer (+ external body if any)
     else {
-        auto* writeMeta = ctx->rwBuffer.GetWriteMeta();
-        if(!writeMeta || writeMeta->writtenLength >= writeMeta->dataLength)
+        auto& rwBuffer = ctx->rwBuffer;
+        if(!rwBuffer.HasPendingWrite())
             goto __CleanupOrRearm;
 
-        while(writeMeta->writtenLength < writeMeta->dataLength) {
-            const char* buf = ctx->rwBuffer.GetWriteData() + writeMeta->writtenLength;
-            std::size_t remaining = writeMeta->dataLength - writeMeta->writtenLength;
+        while(rwBuffer.HasPendingWrite()) {
+            iovec iov[2];
+            int   iovCount = FillWriteIov(ctx, iov);
 
-            ssize_t n = WrapWrite(ctx, buf, remaining);
+            ssize_t n = WrapWriteV(ctx, iov, iovCount);
 
             if(n > 0)
-                writeMeta->writtenLength += n;
+                rwBuffer.AdvanceGatherLength(n);
 
             // Partial progress, wait for event loop to notify when we can send more data
             else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
@@ -209,6 +238,51 @@ void EpollConnectionHandler::Write(ConnectionContext* ctx, std::string_view msg)
     }
 
 __CleanupOrRearm:
+    // Kernel might still be reading our write buffer (MSG_ZEROCOPY), we cannot reuse or release it yet
+    // Completion notifications raise EPOLLERR, event loop calls us again once every send is done
+    if(IsZeroCopyPending(ctx)) {
+        ctx->eventType = EventType::EVENT_SEND;
+        return;
+    }
+
+    // Only flushed responses of earlier pipelined requests (or sent 100 Continue), current one-
+    // -is still in progress
+    if(ctx->isPipelineFlush) {
+        if(auto* writeMeta = ctx->rwBuffer.GetWriteMeta()) {
+            writeMeta->dataLength    = 0;
+            writeMeta->writtenLength = 0;
+        }
+        ctx->isPipelineFlush = 0;
+
+        // Flushed right before its async handler got suspended, engine writes its response once it-
+        // -finishes. Nothing to receive till then
+        if(ctx->IsAsyncOperation() && !ctx->isBodyWait) {
+            ctx->eventType = EventType::EVENT_RECV;
+            return;
+        }
+
+        ResumeReceive(ctx);
+        return;
+    }
+
+    // Response headers didn't fit in write buffer, serialize the next part now that its empty
+    if(ctx->isPartialResponse) {
+        switch(HttpSerializer::ResumeSerialize(*ctx->responseInfo, ctx->rwBuffer)) {
+            case SerializeResult::SERIALIZE_SUCCESS:
+                ctx->isPartialResponse = 0;
+                [[fallthrough]];
+
+            case SerializeResult::SERIALIZE_BUFFER_INSUFFICIENT:
+                Write(ctx);
+                return;
+
+            default:
+                logger_.Error("[Epoll]: Failed to serialize remaining response");
+                Close(ctx);
+                return;
+        }
+    }
+
     // Special case, stream operation, stream the content via streamGenerator
     if(ctx->streamGenerator) {
         ResumeStream(ctx);
@@ -229,10 +303,10 @@ __CleanupOrRearm:
     }
 }
 
-void EpollConnectionHandler::WriteFile(ConnectionContext* ctx, std::string path)
+void EpollConnectionHandler::WriteFile(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length)
 {
     // Before we proceed, ensure stuffs ready for file operation
-    if(!EnsureFileReady(ctx, std::move(path))) {
+    if(!EnsureFileReady(ctx, std::move(path), offset, length)) {
         ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
         Write(ctx, HttpError::internalError);
         return;
@@ -316,7 +390,8 @@ void EpollConnectionHandler::Run()
     int sfd = 0;
 
     while(running_) {
-        int nfds = epoll_wait(epollFd_, events_.get(), maxEvents_, -1);
+        // Don't block if some connection already has a pipelined request waiting on us
+        int nfds = epoll_wait(epollFd_, events_.get(), maxEvents_, pipelineQueue_.empty() ? -1 : 0);
         if(nfds < 0) {
             // Interrupted by signal
             if(errno == EINTR)
@@ -351,6 +426,12 @@ void EpollConnectionHandler::Run()
                 continue;
             }
 
+            // Files under watched directories changed, drop their cached fds
+            if(sfd == fileWatchFd_) {
+                fileCache_.ProcessWatchEvents();
+                continue;
+            }
+
             // Handle async timers
             if(sfd == asyncTimerFd_) {
                 std::uint64_t expirations = 0;
@@ -433,6 +514,14 @@ void EpollConnectionHandler::Run()
                     // Set connection info
                     ctx->socket   = clientFd;
                     ctx->connInfo = tmpIp;
+
+                    // Opt into zero copy sends, if kernel doesn't support it we just send normally
+                    if(zeroCopy_) {
+                        int zcFlag = 1;
+                        std::uint32_t zcIdx = static_cast<std::uint32_t>(ctx - connections_.get());
+                        zeroCopy_[zcIdx].enabled =
+                            setsockopt(clientFd, SOL_SOCKET, SO_ZEROCOPY, &zcFlag, sizeof(zcFlag)) == 0;
+                    }
                     
                     numConnectionsAlive_++;
                     WrapAccept(ctx);
@@ -505,24 +594,41 @@ void EpollConnectionHandler::Run()
                 continue;
             }
 
-            if(ev & (EPOLLERR | EPOLLHUP)) {
+            // Zero copy completions are delivered through the socket error queue, which also raises EPOLLERR
+            // So EPOLLERR is only fatal if draining the error queue tells us its an actual error
+            if((ev & EPOLLERR) && !(ev & EPOLLHUP) && zeroCopy_ && zeroCopy_[idx].enabled) {
+                if(!DrainZeroCopy(ctx)) {
+                    Close(ctx);
+                    continue;
+                }
+
+                // Write was waiting on the kernel to let go of our buffer, let it finish up
+                if(ctx->eventType == EventType::EVENT_SEND && !IsZeroCopyPending(ctx)) {
+                    Write(ctx, {});
+                    continue;
+                }
+            }
+            else if(ev & (EPOLLERR | EPOLLHUP)) {
                 Close(ctx);
                 continue;
             }
 
-            // If the 'ctx->eventType' is NOT EVENT_RECV, its most probably:
+            // If the 'ctx->eventType' is NOT EVENT_RECV (or request is running async), its most probably:
             //  - I forgot to set it somewhere
-            //  - We are doing other task and client is trying to send more data
-            // In any case, we just ignore it
-            if((ev & EPOLLIN) && ctx->eventType == EventType::EVENT_RECV) {
-                // Check per ip request rate BEFORE processing anything
-                if(!ipLimiter_.AllowRequest(ctx->connInfo)) {
+            //  - We are doing other task and client is trying to send more data (pipelining)
+            // Request is pointing into read buffer so we can't read now, remember it for 'ResumeReceive'
+            // Only exception is async handler waiting on its streamed body
+            if((ev & EPOLLIN) && ctx->CanReceive()) {
+                // Check per ip request rate BEFORE processing anything (rest of a body isn't a new request)
+                if(!ctx->isBodyWait && !ipLimiter_.AllowRequest(ctx->connInfo)) {
                     ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
                     Write(ctx, HttpError::tooManyRequests);
                     continue;
                 }
                 Receive(ctx);
             }
+            else if(ev & EPOLLIN)
+                ctx->isRecvPending = 1;
             
             if(ev & EPOLLOUT) {
                 if(ctx->eventType == EventType::EVENT_SEND_FILE)
@@ -531,6 +637,8 @@ void EpollConnectionHandler::Run()
                     Write(ctx, {});
             }
         }
+
+        DrainPipelineQueue();
     }
 }
 
@@ -647,6 +755,9 @@ void EpollConnectionHandler::ReleaseConnection(ConnectionContext* ctx)
 
     ipLimiter_.ReleaseConnection(ctx->connInfo);
 
+    if(zeroCopy_)
+        zeroCopy_[idx] = {};
+
     ctx->ResetContext();
 
     FreeSlot(connBitmap_.get(), idx);
@@ -669,7 +780,7 @@ bool EpollConnectionHandler::SetNonBlocking(int fd)
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
 }
 
-bool EpollConnectionHandler::EnsureFileReady(ConnectionContext* ctx, std::string path)
+bool EpollConnectionHandler::EnsureFileReady(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length)
 {
     auto [fd, size] = fileCache_.GetFileDesc(std::move(path));
     if(fd < 0)
@@ -677,11 +788,22 @@ bool EpollConnectionHandler::EnsureFileReady(ConnectionContext* ctx, std::string
 
     if(!ctx->fileInfo)
         ctx->fileInfo = new FileInfo{};
-    
+
+    // Keeps fd open till this transfer is done with it ('ClearContext' / 'ResetContext' let go)
     auto* fileInfo = ctx->fileInfo;
+    if(fileInfo->fd >= 0)
+        fileCache_.Release(fileInfo->fd);
+
+    fileCache_.Retain(fd);
+    
+    // Range requests send only a slice, 'fileSize' then marks where that slice ends
+    std::uint64_t fileSize = static_cast<std::uint64_t>(size);
+    std::uint64_t start    = std::min(offset, fileSize);
+    std::uint64_t end      = length < fileSize - start ? start + length : fileSize;
+
     fileInfo->fd       = fd;
-    fileInfo->offset   = 0;
-    fileInfo->fileSize = size;
+    fileInfo->offset   = static_cast<off_t>(start);
+    fileInfo->fileSize = static_cast<off_t>(end);
 
     return true;
 }
@@ -730,6 +852,80 @@ bool EpollConnectionHandler::ResolveHostToIpv4(const char* host, in_addr* outAdd
     return found; 
 }
 
+int EpollConnectionHandler::FillWriteIov(ConnectionContext* ctx, iovec (&iov)[2])
+{
+    auto* writeMeta = ctx->rwBuffer.GetWriteMeta();
+    int   iovCount  = 0;
+
+    // Headers (or whatever else got buffered) first, then the external body
+    if(writeMeta->writtenLength < writeMeta->dataLength)
+        iov[iovCount++] = {
+            ctx->rwBuffer.GetWriteData() + writeMeta->writtenLength,
+            writeMeta->dataLength - writeMeta->writtenLength
+        };
+
+    if(writeMeta->bodyWritten < writeMeta->bodyLength)
+        iov[iovCount++] = {
+            const_cast<char*>(writeMeta->bodyData) + writeMeta->bodyWritten, // Kernel only reads from it
+            writeMeta->bodyLength - writeMeta->bodyWritten
+        };
+
+    return iovCount;
+}
+
+bool EpollConnectionHandler::DrainZeroCopy(ConnectionContext* ctx)
+{
+    std::uint32_t idx = ctx - &connections_[0];
+    auto& zc = zeroCopy_[idx];
+
+    // Each notification covers a range [ee_info, ee_data] of sequence numbers, and the ranges-
+    // -arrive in order, so we only need to remember the highest one we have seen
+    while(true) {
+        char   control[128];
+        msghdr msg{};
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        if(recvmsg(ctx->socket, &msg, MSG_ERRQUEUE) < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK; // Queue drained
+
+        for(cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            bool isRecvErr = (cm->cmsg_level == SOL_IP   && cm->cmsg_type == IP_RECVERR)
+                          || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if(!isRecvErr)
+                continue;
+
+            auto* ee = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cm));
+
+            // Not a zero copy notification, its an actual socket error
+            if(ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY || ee->ee_errno != 0)
+                return false;
+
+            zc.completed = ee->ee_data + 1;
+
+            // Kernel ended up copying anyways (loopback, NIC without scatter-gather, ...)
+            // Zero copy is pure overhead for this connection then, so stop using it
+            if(ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                zc.copied = true;
+        }
+    }
+}
+
+bool EpollConnectionHandler::IsZeroCopyPending(ConnectionContext* ctx)
+{
+    if(!zeroCopy_)
+        return false;
+
+    std::uint32_t idx = ctx - &connections_[0];
+    auto& zc = zeroCopy_[idx];
+
+    if(zc.issued == zc.completed)
+        return false;
+
+    // Notifications might have landed before we got here, drain once before making anyone wait
+    return !DrainZeroCopy(ctx) || zc.issued != zc.completed;
+}
+
 void EpollConnectionHandler::Receive(ConnectionContext* ctx)
 {
     // Ensure buffer is ready
@@ -745,6 +941,13 @@ void EpollConnectionHandler::Receive(ConnectionContext* ctx)
         if(!region.ptr || region.len == 0) {
             if(!rwBuffer.GrowReadBuffer(config_.networkConfig.bufferIncrSize,
                                         config_.networkConfig.maxRecvBufferSize)) {
+                // Streamed body gets consumed chunk by chunk, let handler make room and come back-
+                // -for the rest of it (still in socket, so 'ResumeReceive' has to know about it)
+                if(ctx->isBodyWait && gotData) {
+                    ctx->isRecvPending = 1;
+                    break;
+                }
+
                 logger_.Warn("[Epoll]: Read buffer full, closing connection");
                 Close(ctx);
                 return;
@@ -777,11 +980,44 @@ void EpollConnectionHandler::Receive(ConnectionContext* ctx)
         }
     }
 
-    // Notify app
-    if(gotData)
+    // Notify app (leftover pipelined data counts too, even if socket had nothing new)
+    if(gotData || ctx->HasPipelinedData())
         onReceive_(ctx);
 }
 
+void EpollConnectionHandler::DrainPipelineQueue()
+{
+    // Only go through what's queued right now, connections queued while draining wait for next round
+    std::size_t count = pipelineQueue_.size();
+
+    for(std::size_t i = 0; i < count; i++) {
+        std::uint64_t      meta = pipelineQueue_[i];
+        ConnectionContext* ctx  = &connections_[meta & 0xFFFFFFFF];
+
+        // Connection died / got reused, or something else already picked it up in the meantime
+        if(ctx->generationId != (meta >> 32) || ctx->eventType != EventType::EVENT_RECV)
+            continue;
+
+        if(ctx->isRecvPending) {
+            ctx->isRecvPending = 0;
+
+            // Check per ip request rate BEFORE processing anything
+            if(!ctx->isBodyWait && !ipLimiter_.AllowRequest(ctx->connInfo)) {
+                ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+                Write(ctx, HttpError::tooManyRequests);
+                continue;
+            }
+
+            // Also hands over leftover pipelined data even if socket turns out to be empty
+            Receive(ctx);
+        }
+        else if(ctx->HasPipelinedData())
+            onReceive_(ctx);
+    }
+
+    pipelineQueue_.erase(pipelineQueue_.begin(), pipelineQueue_.begin() + count);
+}
+
 void EpollConnectionHandler::SendFile(ConnectionContext* ctx)
 {
     // This is called in this order: WriteFile() -> Write() [Headers sent] -> SendFile()
@@ -1070,8 +1306,10 @@ ssize_t EpollConnectionHandler::WrapRead(ConnectionContext* ctx, char* buf, std:
 
 ssize_t EpollConnectionHandler::WrapWrite(ConnectionContext* ctx, const char* buf, std::size_t len)
 {
-    if(!ctx->sslConn)
-        return ::send(ctx->socket, buf, len, MSG_NOSIGNAL);
+    if(!ctx->sslConn) {
+        iovec iov = { const_cast<char*>(buf), len };
+        return WrapWriteV(ctx, &iov, 1);
+    }
 
     SSLResult result = sslHandler_->Write(ctx->sslConn, buf, static_cast<int>(len));
 
@@ -1093,6 +1331,41 @@ ssize_t EpollConnectionHandler::WrapWrite(ConnectionContext* ctx, const char* bu
     }
 }
 
+ssize_t EpollConnectionHandler::WrapWriteV(ConnectionContext* ctx, iovec* iov, int iovCount)
+{
+    // SSL can't gather, write the first region and let caller loop for the rest
+    if(ctx->sslConn)
+        return WrapWrite(ctx, static_cast<const char*>(iov[0].iov_base), iov[0].iov_len);
+
+    msghdr msg{};
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = iovCount;
+
+    // Large enough send, let kernel reference our pages instead of copying them
+    if(zeroCopy_) {
+        std::size_t total = 0;
+        for(int i = 0; i < iovCount; i++)
+            total += iov[i].iov_len;
+
+        std::uint32_t idx = ctx - &connections_[0];
+        auto& zc = zeroCopy_[idx];
+
+        if(total >= zeroCopyThreshold_ && zc.enabled && !zc.copied) {
+            ssize_t n = ::sendmsg(ctx->socket, &msg, MSG_NOSIGNAL | MSG_ZEROCOPY);
+            if(n >= 0) {
+                zc.issued++;
+                return n;
+            }
+
+            // ENOBUFS = Ran out of optmem for pinning pages, just fall back to a normal copy
+            if(errno != ENOBUFS)
+                return n;
+        }
+    }
+
+    return ::sendmsg(ctx->socket, &msg, MSG_NOSIGNAL);
+}
+
 ssize_t EpollConnectionHandler::WrapFile(ConnectionContext* ctx, int fd, off_t* offset, std::size_t count)
 {
     if(!ctx->sslConn)
@@ -1111,7 +1384,12 @@ ssize_t EpollConnectionHandler::WrapFile(ConnectionContext* ctx, int fd, off_t*
             ctx->streamGenerator   = [
                 fileInfo = ctx->fileInfo
             ](StreamBuffer buffer) {
-                std::int64_t res = pread(fileInfo->fd, buffer.buffer, buffer.size, fileInfo->offset);
+                // Never past 'fileSize', for range requests thats the end of range and not the file
+                std::size_t toRead = std::min<std::size_t>(buffer.size, fileInfo->fileSize - fileInfo->offset);
+                if(toRead == 0)
+                    return StreamResult{ 0, StreamAction::STOP_AND_ALIVE_CONN };
+
+                std::int64_t res = pread(fileInfo->fd, buffer.buffer, toRead, fileInfo->offset);
                 // Error or EOF
                 if(res <= 0)
                     return StreamResult{ 
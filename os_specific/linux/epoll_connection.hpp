@@ -12,7 +12,10 @@
 #include "utils/timer/timer_heap/timer_heap.hpp"
 
 #include <sys/epoll.h>
+#include <sys/uio.h>
 #include <atomic>
+#include <memory>
+#include <vector>
 
 namespace WFX::OSSpecific {
 
@@ -22,6 +25,15 @@ using namespace WFX::Core;  // For 'Config'
 
 using SteadyClock = std::chrono::steady_clock;
 
+// MSG_ZEROCOPY bookkeeping, kernel hands out a sequence number for every zero copy send-
+// -and reports them back (in order) through the socket error queue once its done with our pages
+struct ZeroCopyTrack {
+    std::uint32_t issued    = 0; // Sequence number the next zero copy send will get
+    std::uint32_t completed = 0; // Every sequence number below this one is done
+    bool          enabled   = false; // SO_ZEROCOPY is set on the socket
+    bool          copied    = false; // Kernel copied anyways, so stop asking for zero copy
+};
+
 class EpollConnectionHandler : public HttpConnectionHandler {
 public:
     EpollConnectionHandler(bool useHttps);
@@ -34,7 +46,7 @@ public: // Initializing
 public: // I/O Operations
     void ResumeReceive(ConnectionContext* ctx)                                         override;
     void Write(ConnectionContext* ctx, std::string_view buffer = {})                   override;
-    void WriteFile(ConnectionContext* ctx, std::string path)                           override;
+    void WriteFile(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length) override;
     void Stream(ConnectionContext* ctx, StreamGenerator generator, bool streamChunked) override;
     void Close(ConnectionContext* ctx, bool forceClose = false)                        override;
     
@@ -52,11 +64,15 @@ private: // Helper Functions
     
     std::uint64_t      NowMs();
     bool               SetNonBlocking(int fd);
-    bool               EnsureFileReady(ConnectionContext* ctx, std::string path);
+    bool               EnsureFileReady(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length);
     bool               EnsureReadReady(ConnectionContext* ctx);
     bool               ResolveHostToIpv4(const char* host, in_addr* outAddr);
+    int                FillWriteIov(ConnectionContext* ctx, iovec (&iov)[2]);
+    bool               DrainZeroCopy(ConnectionContext* ctx);
+    bool               IsZeroCopyPending(ConnectionContext* ctx);
     
     void               Receive(ConnectionContext* ctx);
+    void               DrainPipelineQueue();
     void               SendFile(ConnectionContext* ctx);
     void               ResumeStream(ConnectionContext* ctx);
     void               UpdateAsyncTimer();
@@ -64,6 +80,7 @@ private: // Helper Functions
     void               WrapAccept(ConnectionContext* ctx);
     ssize_t            WrapRead(ConnectionContext* ctx, char* buf, std::size_t len);
     ssize_t            WrapWrite(ConnectionContext* ctx, const char* buf, std::size_t len);
+    ssize_t            WrapWriteV(ConnectionContext* ctx, iovec* iov, int iovCount);
     ssize_t            WrapFile(ConnectionContext* ctx, int fd, off_t* offset, std::size_t count);
 
 private: // Misc
@@ -91,21 +108,25 @@ private: // Timeout handler
     SteadyClock::time_point startTime_      = SteadyClock::now();
     int                     timeoutTimerFd_ = -1;
     int                     asyncTimerFd_   = -1;
+    int                     fileWatchFd_    = -1; // Not ours, belongs to 'FileCache'
 
 private: // Epoll + SSL
-    int           listenFd_  = -1;
-    int           epollFd_   = -1;
-    std::uint16_t maxEvents_ = config_.osSpecificConfig.maxEvents;
+    int           listenFd_          = -1;
+    int           epollFd_           = -1;
+    std::uint16_t maxEvents_         = config_.osSpecificConfig.maxEvents;
+    std::uint32_t zeroCopyThreshold_ = 0; // Plain sockets only, 0 = Disabled
 
     std::unique_ptr<HttpWFXSSL>    sslHandler_ = nullptr;
     std::unique_ptr<epoll_event[]> events_     = nullptr;
 
 private: // Connection Context
     std::unique_ptr<ConnectionContext[]> connections_   = nullptr;
+    std::unique_ptr<ZeroCopyTrack[]>     zeroCopy_      = nullptr; // Only allocated if zero copy is enabled
     std::unique_ptr<std::uint64_t[]>     connBitmap_    = nullptr;
     std::uint32_t                        connWords_     = 0;
     std::uint32_t                        connSlots_     = 0;
     std::uint32_t                        connLastIndex_ = 0;
+    std::vector<std::uint64_t>           pipelineQueue_;     // (generation << 32 | index) of connections with data waiting
 
     // TODO: FOR DEBUG ONLY, REMOVE IT AFTER
     std::uint64_t numConnectionsAlive_ = 0;
@@ -3,322 +3,589 @@
 #include "io_uring_connection.hpp"
 
 #include "http/common/http_error_msgs.hpp"
-
-#include <fcntl.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <netinet/tcp.h>
+#include "http/formatters/serializer/http_serializer.hpp"
+#include "http/ssl/http_ssl_factory.hpp"
 #include <sys/socket.h>
-#include <sys/sendfile.h>
-#include <sys/poll.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <errno.h>
 
 namespace WFX::OSSpecific {
 
-// vvv Destructor vvv
+// vvv Constructor & Destructor vvv
+IoUringConnectionHandler::IoUringConnectionHandler(bool useHttps)
+    : useHttps_(useHttps)
+{
+    if(useHttps)
+        sslHandler_ = CreateSSLHandler();
+}
+
 IoUringConnectionHandler::~IoUringConnectionHandler()
 {
-    if(listenFd_ > 0) {
-        close(listenFd_);
-        listenFd_ = -1;
+    // Pipes used for splicing files are per connection, clean up whatever is still hanging around
+    if(uringSlots_) {
+        for(std::uint32_t i = 0; i < connSlots_; i++) {
+            auto& slot = uringSlots_[i];
+            if(slot.pipeFds[0] >= 0) close(slot.pipeFds[0]);
+            if(slot.pipeFds[1] >= 0) close(slot.pipeFds[1]);
+        }
+    }
+
+    if(listenFd_ > 0)       { close(listenFd_);       listenFd_ = -1;       }
+    if(timeoutTimerFd_ > 0) { close(timeoutTimerFd_); timeoutTimerFd_ = -1; }
+    if(asyncTimerFd_ > 0)   { close(asyncTimerFd_);   asyncTimerFd_ = -1;   }
+
+    if(bufRing_) {
+        io_uring_free_buf_ring(&ring_, bufRing_, bufCount_, BUFFER_GROUP_ID);
+        bufRing_ = nullptr;
     }
-    io_uring_queue_exit(&ring_);
+    if(ringInit_) { io_uring_queue_exit(&ring_); ringInit_ = false; }
 
-    logger_.Info("[IoUring]: Cleaned up sockets successfully");
+    logger_.Info("[IoUring]: Cleaned up resources successfully");
 }
 
 // vvv Initializing Functions vvv
-void IoUringConnectionHandler::Initialize(const std::string &host, int port)
+void IoUringConnectionHandler::Initialize(const std::string& host, int port)
 {
-    // vvv Initialize our pre-fixed array of connections and accept handlers vvv
     auto& osConfig      = config_.osSpecificConfig;
     auto& networkConfig = config_.networkConfig;
 
-    connWords_   = (networkConfig.maxConnections + 63) / 64;
-    acceptWords_ = (osConfig.acceptSlots + 63) / 64;
+    // Connection index only gets 24 bits inside of 'user_data', so that's our hard limit
+    // Rounded down to 64 so bitmap stays happy
+    constexpr std::uint32_t MAX_64_ALIGNED = (MAX_SLOT_INDEX + 1) & ~std::uint32_t(63);
+
+    // Round up to 64-bit boundary so every allocated bit always maps to valid storage
+    std::uint64_t rounded = std::uint64_t(networkConfig.maxConnections) + 63;
+    rounded &= ~std::uint64_t(63);
+
+    // Clamp to avoid exceeding valid range
+    if(rounded > MAX_64_ALIGNED)
+        rounded = MAX_64_ALIGNED;
 
-    connections_  = std::make_unique<ConnectionContext[]>(networkConfig.maxConnections);
-    connBitmap_   = std::make_unique<std::uint64_t[]>(connWords_);
+    connSlots_ = std::uint32_t(rounded);
+    connWords_ = connSlots_ >> 6;
 
-    acceptSlots_  = std::make_unique<AcceptSlot[]>(osConfig.acceptSlots);
-    acceptBitmap_ = std::make_unique<std::uint64_t[]>(acceptWords_);
+    // Connections
+    connections_ = std::make_unique<ConnectionContext[]>(connSlots_);
+    uringSlots_  = std::make_unique<UringSlot[]>(connSlots_);
+    connBitmap_  = std::make_unique<std::uint64_t[]>(connWords_);
 
-    std::fill_n(connBitmap_.get(), (networkConfig.maxConnections + 63)/64, 0);
-    std::fill_n(acceptBitmap_.get(), (osConfig.acceptSlots + 63)/64, 0);
+    std::fill_n(connBitmap_.get(), connWords_, 0);
 
-    // vvv Initialize our sockets vvv
+    // Zero copy only makes sense for plain sockets, with SSL the data gets encrypted into-
+    // -OpenSSL's own buffer so there is nothing of ours left for the kernel to reference
+    if(!useHttps_)
+        zeroCopyThreshold_ = networkConfig.zeroCopyThreshold;
+
+    // NOTE: Listening socket is left blocking on purpose, io_uring will hand us back -EAGAIN-
+    //       -instead of waiting internally if the file is marked O_NONBLOCK
     listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
     if(listenFd_ < 0)
-        logger_.Fatal("[IoUring]: Failed to create listening socket for host: ", host);
+        logger_.Fatal("[IoUring]: Failed to create listening socket: ", strerror(errno));
 
     int opt = 1;
-    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+    if(setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+        logger_.Fatal("[IoUring]: Failed to set SO_REUSEADDR: ", strerror(errno));
+
+    if(setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+        logger_.Fatal("[IoUring]: Failed to set SO_REUSEPORT: ", strerror(errno));
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_port   = htons(port);
+    if(!ResolveHostToIpv4(host.c_str(), &addr.sin_addr))
+        logger_.Fatal("[IoUring]: Failed to resolve host '", host, '\'');
 
-    if(ResolveHostToIpv4(host.c_str(), &addr.sin_addr) != 0)
-        logger_.Fatal("[IoUring]: Failed to resolve host address");
-
-    if(bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr)) < 0)
-        logger_.Fatal("[IoUring]: Failed to bind to socket");
+    if(bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) < 0)
+        logger_.Fatal("[IoUring]: Failed to bind socket: ", strerror(errno));
 
     if(listen(listenFd_, osConfig.backlog) < 0)
-        logger_.Fatal("[IoUring]: Failed to listen on socket");
+        logger_.Fatal("[IoUring]: Failed to listen: ", strerror(errno));
+
+    // Only this thread ever touches the ring, let the kernel know so it can skip some work
+    // Older kernels don't know about these flags, fallback to a plain ring for them
+    io_uring_params params{};
+    params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+
+    int ret = io_uring_queue_init_params(osConfig.queueDepth, &ring_, &params);
+    if(ret == -EINVAL)
+        ret = io_uring_queue_init(osConfig.queueDepth, &ring_, 0);
+    if(ret < 0)
+        logger_.Fatal("[IoUring]: Failed to initialize io_uring: ", strerror(-ret));
+
+    ringInit_ = true;
+
+    // vvv Initialize provided buffer ring vvv
+    InitBufferRing();
+
+    // vvv Initialize timeout handler vvv
+    timerWheel_.Init(
+        connSlots_,
+        1024, 1, TimeUnit::SECONDS,
+        [this](std::uint32_t connId) {
+            ConnectionContext* ctx = &connections_[connId];
+
+            // Same logic as epoll, sync path closes itself after sending data, async path-
+            // -which hung up for too long gets nuked by us
+            if(
+                ctx->GetConnectionState() != ConnectionState::CONNECTION_CLOSE
+                || ctx->IsAsyncOperation()
+            )
+                Close(ctx, true);
+        }
+    );
+
+    // Same deal as the listening socket, timerfds stay blocking so the READ SQE waits on them
+    timeoutTimerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if(timeoutTimerFd_ < 0)
+        logger_.Fatal("[IoUring]: Failed to create timeout timer: ", strerror(errno));
 
-    SetNonBlocking(listenFd_);
+    itimerspec ts{};
+    ts.it_interval.tv_sec  = INVOKE_TIMEOUT_COOLDOWN;
+    ts.it_interval.tv_nsec = 0;
+    ts.it_value.tv_sec     = INVOKE_TIMEOUT_DELAY;
+    ts.it_value.tv_nsec    = 0;
 
-    if(io_uring_queue_init(osConfig.queueDepth, &ring_, 0) < 0)
-        logger_.Fatal("[IoUring]: Failed to initialize io_uring");
+    if(timerfd_settime(timeoutTimerFd_, 0, &ts, nullptr) < 0)
+        logger_.Fatal("[IoUring]: Failed to set timeout timer: ", strerror(errno));
+
+    // vvv Initializing async timer vvv
+    asyncTimerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if(asyncTimerFd_ < 0)
+        logger_.Fatal("[IoUring]: Failed to create async timer: ", strerror(errno));
 }
 
-void IoUringConnectionHandler::SetReceiveCallback(ReceiveCallback onData)
+void IoUringConnectionHandler::SetEngineCallbacks(ReceiveCallback onData, CompletionCallback onComplete)
 {
-    onReceive_ = std::move(onData);
+    onReceive_         = std::move(onData);
+    onAsyncCompletion_ = std::move(onComplete);
 }
 
 // vvv I/O Operations vvv
-void IoUringConnectionHandler::ResumeReceive(ConnectionContext* ctx)                    { AddRecv(ctx); }
-void IoUringConnectionHandler::Write(ConnectionContext* ctx, std::string_view buffer)   { AddSend(ctx, buffer); }
-void IoUringConnectionHandler::Close(ConnectionContext* ctx)                            { ReleaseConnection(ctx); }
-void IoUringConnectionHandler::WriteFile(ConnectionContext *ctx, std::string path)
+void IoUringConnectionHandler::ResumeReceive(ConnectionContext* ctx)
 {
-    // Ensure that the file exists and our context is ready for sending file
-    // If not we 404 error
-    if(!EnsureFileReady(ctx, std::move(path))) {
-        AddSend(ctx, notFound);
+    auto& slot = uringSlots_[ctx - &connections_[0]];
+    ctx->eventType = EventType::EVENT_RECV;
+
+    // Stuff that came in while we were busy, or pipelined request already in read buffer
+    // We are usually deep inside of previous request's completion here, so let 'Run' pick it up-
+    // -instead of recursing
+    if(slot.stashCount > 0 || ctx->HasPipelinedData()) {
+        pipelineQueue_.push_back((static_cast<std::uint64_t>(ctx->generationId) << 32) | (ctx - &connections_[0]));
         return;
     }
 
-    // Cool we can send file, but before that we need to send header
-    // AddSend will handle the case where isFileOperation is 1, meaning it will invoke-
-    // -AddFile for us after header is sent successfully
-    ctx->isFileOperation = 1;
-    AddSend(ctx, {});
+    // SSL reads from socket on its own, nobody is watching it unless we ask
+    if(ctx->sslConn) {
+        // Handler waiting on its streamed body asked for this from inside of itself, don't recurse into it
+        if(ctx->isBodyWait) {
+            pipelineQueue_.push_back((static_cast<std::uint64_t>(ctx->generationId) << 32) | (ctx - &connections_[0]));
+            return;
+        }
+
+        Receive(ctx);
+        return;
+    }
+
+    // Multishot recv gets cancelled while we are busy (or ends on its own), bring it back
+    if(!slot.recvArmed)
+        AddRecv(ctx);
+
+    // Nothing buffered, idle connection has no business holding onto a read buffer
+    // Ring hands us a buffer only once data actually arrives
+    auto* readMeta = ctx->rwBuffer.GetReadMeta();
+    if(readMeta && readMeta->dataLength == 0)
+        ctx->rwBuffer.ReleaseReadBuffer();
 }
 
-// vvv Main Functions vvv
-void IoUringConnectionHandler::Run()
+void IoUringConnectionHandler::Write(ConnectionContext* ctx, std::string_view msg)
 {
-    // Sanity checks
-    if(!onReceive_)
-        logger_.Fatal("[IoUring]: 'onReceive_' function is not initialized");
+    auto& slot = uringSlots_[ctx - &connections_[0]];
 
-    running_ = true;
+    // Case 1: Direct send (used only for static error codes)
+    // Fire and forget just like epoll, its a single non blocking send so no need for a SQE
+    if(!msg.empty()) {
+        (void)WrapWrite(ctx, msg.data(), msg.size());
+        goto __CleanupOrRearm;
+    }
 
-    // Initial accept SQEs
-    for(int i = 0; i < config_.osSpecificConfig.acceptSlots; ++i)
-        AddAccept();
-    SubmitBatch();
+    // Case 2: Send from buffer (+ external body if any)
+    else {
+        // Pipelined responses are still on their way out (flushed before an async handler got-
+        // -suspended), completion picks up whatever got appended behind them meanwhile
+        if(slot.sendArmed)
+            return;
 
-    // Simple lambda for re-arming accept slots
-    auto RearmAcceptSlot = [this](AcceptSlot* slot) {
-        ReleaseAccept(slot);
-        AddAccept();
-    };
+        auto& rwBuffer = ctx->rwBuffer;
+        if(!rwBuffer.HasPendingWrite())
+            goto __CleanupOrRearm;
 
-    while(running_) {
-        io_uring_cqe* cqe = nullptr;
-        int ret = io_uring_wait_cqe(&ring_, &cqe);
-        if(ret < 0) {
-            if(errno == EINTR)
-                continue;
+        // Plain sockets, hand it to the kernel, SEND completion will call us back
+        if(!ctx->sslConn) {
+            ctx->eventType = EventType::EVENT_SEND;
+            slot.sendArmed = 1;
+            AddSend(ctx);
+            return;
+        }
 
-            break;
+        // SSL needs to encrypt in userspace, so write it ourselves and only use the ring-
+        // -to wait until socket is writable again
+        // SSL can't gather either, so regions go out one after the other
+        while(rwBuffer.HasPendingWrite()) {
+            iovec iov[2];
+            (void)FillWriteIov(ctx, iov);
+
+            ssize_t n = WrapWrite(ctx, static_cast<const char*>(iov[0].iov_base), iov[0].iov_len);
+
+            if(n > 0)
+                rwBuffer.AdvanceGatherLength(n);
+
+            // Partial progress, wait for socket to be writable again
+            else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                ctx->eventType = EventType::EVENT_SEND;
+                slot.sendArmed = 1;
+                AddPoll(ctx, POLLOUT);
+                return;
+            }
+
+            // Connection closed / Fatal error
+            else {
+                Close(ctx);
+                return;
+            }
         }
+    }
 
-        auto* ptr = static_cast<void*>(io_uring_cqe_get_data(cqe));
-        if(!ptr) { 
-            io_uring_cqe_seen(&ring_, cqe); 
-            continue; 
+__CleanupOrRearm:
+    // Kernel might still be reading our write buffer (SEND_ZC), we cannot reuse or release it yet
+    // Last notification CQE calls us back
+    if(slot.zcInflight > 0) {
+        slot.zcWaiting = 1;
+        return;
+    }
+
+    // Only flushed responses of earlier pipelined requests (or sent 100 Continue), current one-
+    // -is still in progress
+    if(ctx->isPipelineFlush) {
+        if(auto* writeMeta = ctx->rwBuffer.GetWriteMeta()) {
+            writeMeta->dataLength    = 0;
+            writeMeta->writtenLength = 0;
         }
-        
-        int res = cqe->res;
-        // Safely cast to the base Tag to read the type
-        ConnectionTag* baseTag = static_cast<ConnectionTag*>(ptr);
-
-        switch(baseTag->eventType) {
-            case EventType::EVENT_ACCEPT:
-            {
-                AcceptSlot* acceptSlot = static_cast<AcceptSlot*>(baseTag);
-
-                if(res >= 0) {
-                    int clientFd = res;
-                    SetNonBlocking(clientFd);
-
-                    int flag = 1;
-                    setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-
-                    // Extract IP info first
-                    WFXIpAddress tmpIp;
-                    sockaddr* sa = reinterpret_cast<sockaddr*>(&acceptSlot->addr);
-                    if(sa->sa_family == AF_INET) {
-                        tmpIp.ip.v4  = reinterpret_cast<sockaddr_in*>(sa)->sin_addr;
-                        tmpIp.ipType = AF_INET;
-                    }
-                    else if(sa->sa_family == AF_INET6) {
-                        tmpIp.ip.v6  = reinterpret_cast<sockaddr_in6*>(sa)->sin6_addr;
-                        tmpIp.ipType = AF_INET6;
-                    }
-                    else
-                        tmpIp.ipType = 255;
-
-                    // Check limiter
-                    if(!ipLimiter_.AllowConnection(tmpIp)) {
-                        close(clientFd);
-                        RearmAcceptSlot(acceptSlot);
-                        break;
-                    }
+        ctx->isPipelineFlush = 0;
 
-                    // Grab a connection slot
-                    ConnectionContext* ctx = GetConnection();
-                    if(!ctx) {
-                        close(clientFd);
-                        RearmAcceptSlot(acceptSlot);
-                        break;
-                    }
+        // Flushed right before its async handler got suspended, engine writes its response once it-
+        // -finishes. Nothing to receive till then
+        if(ctx->IsAsyncOperation() && !ctx->isBodyWait) {
+            ctx->eventType = EventType::EVENT_RECV;
+            return;
+        }
 
-                    ctx->socket    = clientFd;
-                    ctx->eventType = EventType::EVENT_RECV;
-                    ctx->connInfo  = tmpIp;
+        ResumeReceive(ctx);
+        return;
+    }
 
-                    // Start receiving immediately
-                    AddRecv(ctx);
-                }
+    // Response headers didn't fit in write buffer, serialize the next part now that its empty
+    if(ctx->isPartialResponse) {
+        switch(HttpSerializer::ResumeSerialize(*ctx->responseInfo, ctx->rwBuffer)) {
+            case SerializeResult::SERIALIZE_SUCCESS:
+                ctx->isPartialResponse = 0;
+                [[fallthrough]];
+
+            case SerializeResult::SERIALIZE_BUFFER_INSUFFICIENT:
+                Write(ctx);
+                return;
+
+            default:
+                logger_.Error("[IoUring]: Failed to serialize remaining response");
+                Close(ctx);
+                return;
+        }
+    }
 
-                // Re-arm accept for next incoming connection
-                RearmAcceptSlot(acceptSlot);
-                break;
-            }
+    // Special case, stream operation, stream the content via streamGenerator
+    if(ctx->streamGenerator) {
+        ResumeStream(ctx);
+        return;
+    }
+
+    // Special case, file operation, send it before anything else
+    if(ctx->isFileOperation) {
+        SendFile(ctx);
+        return;
+    }
 
-            case EventType::EVENT_RECV: {
-                ConnectionContext* ctx = static_cast<ConnectionContext*>(baseTag);
+    if(ctx->GetConnectionState() == ConnectionState::CONNECTION_CLOSE)
+        Close(ctx);
+    else {
+        ctx->ClearContext();
+        ResumeReceive(ctx);
+    }
+}
 
-                if(res <= 0) {
-                    // Client closed connection / Error
-                    ReleaseConnection(ctx);
-                    break;
-                }
+void IoUringConnectionHandler::WriteFile(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length)
+{
+    // Before we proceed, ensure stuffs ready for file operation
+    if(!EnsureFileReady(ctx, std::move(path), offset, length)) {
+        ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+        Write(ctx, HttpError::internalError);
+        return;
+    }
 
-                // TODO: FIX RandomPool which fixes SipHash24 which fixes ConcurrentHashMap which fixes the below
-                // if(!ipLimiter_.AllowRequest(ctx->connInfo)) {
-                //     SendHttp429(ctx);
-                //     break;
-                // }
+    // Headers first, 'Write' will call 'SendFile' once they are out
+    ctx->isFileOperation = 1;
+    Write(ctx, {});
+}
 
-                auto& rwBuffer = ctx->rwBuffer;
-                
-                // Update buffer state
-                rwBuffer.AdvanceReadLength(res);
+void IoUringConnectionHandler::Stream(ConnectionContext* ctx, StreamGenerator generator, bool streamChunked)
+{
+    // Sanity checks
+    if(!generator) {
+        logger_.Error("[IoUring]: Stream() called with null generator");
+        Close(ctx);
+        return;
+    }
 
-                // Add null terminator safely
-                ReadMetadata* readMeta = rwBuffer.GetReadMeta();
-                char*         dataPtr  = rwBuffer.GetReadData();
-                dataPtr[readMeta->dataLength] = '\0';
+    // Store the generator function in context for future use
+    ctx->streamGenerator = std::move(generator);
 
-                onReceive_(ctx);
-                break;
+    // Headers first, 'Write' will start the streaming process once they are out
+    ctx->isStreamOperation = 1;
+    ctx->streamChunked     = streamChunked;
+    Write(ctx, {});
+}
+
+void IoUringConnectionHandler::Close(ConnectionContext* ctx, bool forceClose)
+{
+    // Sanity check
+    if(!ctx)
+        return;
+
+    std::uint32_t idx  = ctx - &connections_[0];
+    auto&         slot = uringSlots_[idx];
+
+    // Already waiting for in flight SQEs to drain, nothing more to do
+    if(slot.closing)
+        return;
+
+    // Force close bypasses any in-progress shutdown or state checks
+    if(!forceClose && ctx->isShuttingDown)
+        return;
+
+    ctx->isShuttingDown = 1;
+
+    // Clean SSL shutdown needs the ring for itself, if something else is still in flight-
+    // -(timeout hit mid operation), just nuke it
+    if(ctx->sslConn && slot.pending > 0)
+        forceClose = true;
+
+    if(ctx->sslConn) {
+        // Skip clean shutdown, nuke it immediately
+        if(forceClose) {
+            sslHandler_->ForceShutdown(ctx->sslConn);
+            ctx->sslConn = nullptr;
+        }
+        else {
+            auto res = sslHandler_->Shutdown(ctx->sslConn);
+
+            // Shutdown finished or failed immediately. Proceed to cleanup
+            if(res == SSLReturn::SUCCESS || res == SSLReturn::FATAL)
+                ctx->sslConn = nullptr;
+
+            // Wait for the ring to tell us when we can continue the shutdown
+            else {
+                ctx->eventType = EventType::EVENT_SHUTDOWN;
+                AddPoll(ctx, res == SSLReturn::WANT_WRITE ? POLLOUT : POLLIN);
+                return;
             }
+        }
+    }
 
-            case EventType::EVENT_SEND: {
-                ConnectionContext* ctx = static_cast<ConnectionContext*>(baseTag);
+    // Kernel might still be reading into / writing from our buffers, we cannot release-
+    // -them under its feet. Cancel everything and let the last CQE release the connection
+    if(slot.pending > 0) {
+        slot.closing = 1;
+        AddCancel(ctx);
+        return;
+    }
 
-                if(res < 0) {
-                    // Just retry with whatever was pending
-                    if(res == -EAGAIN || res == -EWOULDBLOCK) {
-                        AddSend(ctx, {});
-                        break;
-                    }
-                    // Fatal send error
-                    ReleaseConnection(ctx);
-                    break;
-                }
-                
-                auto& rwBuffer  = ctx->rwBuffer;
-                auto* writeMeta = rwBuffer.GetWriteMeta();
-
-                if(writeMeta && writeMeta->dataLength > 0) {
-                    // This was a buffered send -> advance writtenLength
-                    rwBuffer.AdvanceWriteLength(res);
-
-                    if(writeMeta->writtenLength < writeMeta->dataLength) {
-                        // Still data left -> re-arm send from buffer
-                        AddSend(ctx, {});
-                        break;
-                    }
-                }
+    ReleaseConnection(ctx);
+}
 
-                // Before we do anything else, check if its a file operation, if it-
-                // -is, then send file before doing anything else
-                if(ctx->isFileOperation) {
-                    AddFile(ctx);
-                    break;
-                }
+// vvv Main Functions vvv
+void IoUringConnectionHandler::Run()
+{
+    // Just a simple sanity check before we do anything
+    if(!onReceive_ || !onAsyncCompletion_)
+        logger_.Fatal(
+            "[IoUring]: Member 'onReceive_' or 'onAsyncCompletion_' was not initialized."
+            " Call 'SetEngineCallbacks' before calling 'Run'"
+        );
+
+    auto& osConfig = config_.osSpecificConfig;
+
+    // Prime the ring, multishot accept stays armed for the entire lifetime of the server
+    AddAccept();
+    AddTimerRead(timeoutTimerFd_, &timeoutExpirations_, UringOp::TIMEOUT_TIMER);
+    AddTimerRead(asyncTimerFd_, &asyncExpirations_, UringOp::ASYNC_TIMER);
+    AddFileWatch();
+
+    std::uint32_t batchSize = std::max<std::uint32_t>(osConfig.batchSize, 1);
+    auto          cqes      = std::make_unique<io_uring_cqe*[]>(batchSize);
 
-                // If we get here, send is fully done
-                if(ctx->GetConnectionState() == ConnectionState::CONNECTION_CLOSE)
-                    ReleaseConnection(ctx);
-                else {
-                    ctx->ClearContext();
-                    AddRecv(ctx);
+    while(running_) {
+        // Flush everything queued during the previous batch and wait for at least one completion
+        // This is the only syscall in the hot path, everything else rides on it
+        // Don't block if some connection already has a pipelined request waiting on us
+        int ret = io_uring_submit_and_wait(&ring_, pipelineQueue_.empty() ? 1 : 0);
+        if(ret < 0) {
+            // Interrupted by signal
+            if(ret == -EINTR)
+                continue;
+            logger_.Error("[IoUring]: io_uring_submit_and_wait failed: ", strerror(-ret));
+            break;
+        }
+
+        unsigned count = io_uring_peek_batch_cqe(&ring_, cqes.get(), batchSize);
+
+        for(unsigned i = 0; i < count; i++) {
+            std::uint64_t meta  = io_uring_cqe_get_data64(cqes[i]);
+            int           res   = cqes[i]->res;
+            std::uint32_t flags = cqes[i]->flags;
+            std::uint32_t gen  = meta >> 32;
+            UringOp       op   = static_cast<UringOp>((meta >> 24) & 0xFF);
+            std::uint32_t idx  = meta & MAX_SLOT_INDEX;
+
+            // Existing connection, handle it
+            if(gen > 0) {
+                ConnectionContext* ctx  = &connections_[idx];
+                auto&              slot = uringSlots_[idx];
+
+                // Slots are only ever reused once all of their SQEs drained, so this should not happen
+                // But if it does, its for a dead connection, so skip it
+                if(ctx->generationId != gen)
+                    continue;
+
+                // Multishot SQEs stay in flight till they post a CQE without F_MORE
+                if(slot.pending > 0 && !(flags & IORING_CQE_F_MORE))
+                    slot.pending--;
+
+                // Connection is being torn down, wait for the last CQE then release it
+                if(slot.closing) {
+                    if(slot.pending == 0)
+                        ReleaseConnection(ctx);
+                    continue;
                 }
-                break;
+
+                HandleCompletion(ctx, op, res, flags);
+                continue;
             }
 
-            case EventType::EVENT_SEND_FILE: {
-                ConnectionContext* ctx = static_cast<ConnectionContext*>(baseTag);
+            switch(op) {
+                case UringOp::ACCEPT:
+                    HandleAccept(res);
 
-                // For some stupid reason, if it were to be nullptr, even tho it shouldnt be
-                auto* fileInfo = ctx->fileInfo;
-                if(!fileInfo) {
-                    ReleaseConnection(ctx);
+                    // Kernel dropped our multishot accept (error / overflow), re-arm it
+                    if(!(flags & IORING_CQE_F_MORE))
+                        AddAccept();
                     break;
-                }
 
-                // Check for <= 0 to handle both errors and client disconnects
-                if(res <= 0) {
-                    // Re-arm the same sendfile SQE later
-                    if(res < 0 && (res == -EAGAIN || res == -EWOULDBLOCK))
-                        AddFile(ctx);
-                    // Fatal error
-                    else
-                        ReleaseConnection(ctx);
+                // Handle timeouts timers
+                case UringOp::TIMEOUT_TIMER:
+                {
+                    // Calculate elapsed time since the server started in seconds
+                    std::uint64_t nowSec = NowMs() / 1000;
+
+                    timerWheel_.Tick(nowSec);
+                    AddTimerRead(timeoutTimerFd_, &timeoutExpirations_, UringOp::TIMEOUT_TIMER);
                     break;
                 }
 
-                // res bytes were successfully sent
-                fileInfo->offset += res;
+                // Handle async timers
+                case UringOp::ASYNC_TIMER:
+                {
+                    std::uint64_t newTick = NowMs();
+                    std::uint64_t connId  = 0;
+
+                    while(timerHeap_.PopExpired(newTick, connId)) {
+                        ConnectionContext* ctx = &connections_[connId];
+
+                        // Well, we are done with our timer operation so yeah
+                        ctx->isAsyncTimerOperation = 0;
+
+                        // Connection is already on its way out, don't resume it
+                        if(uringSlots_[connId].closing)
+                            continue;
+
+                        switch(ctx->TryFinishCoroutines()) {
+                            case Async::Status::COMPLETED:
+                                onAsyncCompletion_(ctx);
+                                break;
+
+                            // Errors
+                            case Async::Status::TIMER_FAILURE:
+                            case Async::Status::IO_FAILURE:
+                            case Async::Status::INTERNAL_FAILURE:
+                                ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+                                Write(ctx, HttpError::internalError);
+                                break;
+                        }
+                    }
 
-                off_t remaining = fileInfo->fileSize - fileInfo->offset;
-                
-                // More to send -> re-arm another sendfile SQE
-                if(remaining > 0) {
-                    AddFile(ctx);
+                    // Async timer is one shot, update it just in case there exists more async-
+                    // -registered timers
+                    UpdateAsyncTimer();
+                    AddTimerRead(asyncTimerFd_, &asyncExpirations_, UringOp::ASYNC_TIMER);
                     break;
                 }
 
-                if(ctx->GetConnectionState() == ConnectionState::CONNECTION_CLOSE)
-                    ReleaseConnection(ctx);
-                else {
-                    ctx->ClearContext();
-                    AddRecv(ctx);
-                }
-                break;
+                // Files under watched directories changed, drop their cached fds
+                case UringOp::FILE_WATCH:
+                    fileCache_.ProcessWatchEvents();
+
+                    // One shot poll, re-arm unless it was cancelled / failed for good
+                    if(res >= 0)
+                        AddFileWatch();
+                    break;
+
+                // Cancel results, we don't care about them, the cancelled SQE reports back on its own
+                case UringOp::CANCEL:
+                default:
+                    break;
             }
         }
 
-        io_uring_cqe_seen(&ring_, cqe);
+        io_uring_cq_advance(&ring_, count);
 
-        // Submit any batched SQEs
-        SubmitBatch();
+        DrainPipelineQueue();
     }
 }
 
 void IoUringConnectionHandler::RefreshExpiry(ConnectionContext* ctx, std::uint16_t timeoutSeconds)
 {
-    ctx->expiry = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+    std::uint32_t idx = ctx - &connections_[0];
+    timerWheel_.Schedule(idx, timeoutSeconds);
+}
+
+bool IoUringConnectionHandler::RefreshAsyncTimer(ConnectionContext* ctx, std::uint32_t delayMilliseconds)
+{
+    std::uint32_t idx    = ctx - &connections_[0];
+    std::uint64_t expire = NowMs() + delayMilliseconds;
+
+    // Timers are coalesced if they fall within +-10ms of each other
+    if(!timerHeap_.Insert(idx, expire, 10)) {
+        logger_.Warn("[IoUring]: Failed to refresh async timer");
+        return false;
+    }
+
+    ctx->isAsyncTimerOperation = 1;
+    UpdateAsyncTimer();
+
+    return true;
 }
 
 void IoUringConnectionHandler::Stop()
@@ -328,86 +595,108 @@ void IoUringConnectionHandler::Stop()
 
 // vvv Helper Functions vvv
 //  --- Connection Handlers ---
-int IoUringConnectionHandler::AllocSlot(std::uint64_t* bitmap, int numWords, int maxSlots)
-{
-    for(int w = 0; w < numWords; w++) {
-        std::uint64_t bits = bitmap[w];
-
-        // If even a single '0' exists in the bitmap, we will take it
-        // '0' means free slot
-        if(~bits) {
-            int bit = __builtin_ctzll(~bits);
-            int idx = (w << 6) + bit;
-            if(idx < maxSlots) {
-                bitmap[w] |= (1ULL << bit);
-                return idx;
-            }
+std::int64_t IoUringConnectionHandler::AllocSlot(std::uint64_t* bitmap, std::uint32_t numWords)
+{
+    std::uint32_t w = connLastIndex_;
+
+    // Primary scan: from last index to end
+    for(; w < numWords; ++w) {
+        std::uint64_t inv = ~bitmap[w];
+        if(inv) {
+            int bit = __builtin_ctzll(inv);
+            bitmap[w] |= 1ULL << bit;
+            connLastIndex_ = w;
+            return (std::int64_t(w) << 6) + bit;
         }
     }
-    return -1;
+
+    // Wrap around scan: from start to old index
+    w = 0;
+    for(; w < connLastIndex_; ++w) {
+        std::uint64_t inv = ~bitmap[w];
+        if(inv) {
+            int bit = __builtin_ctzll(inv);
+            bitmap[w] |= 1ULL << bit;
+            connLastIndex_ = w;
+            return (std::int64_t(w) << 6) + bit;
+        }
+    }
+
+    return -1; // Fully exhausted
 }
 
-void IoUringConnectionHandler::FreeSlot(std::uint64_t* bitmap, int idx)
+void IoUringConnectionHandler::FreeSlot(std::uint64_t* bitmap, std::uint32_t idx)
 {
-    int w   = idx >> 6;
-    int bit = idx & 63;
+    std::uint32_t w   = idx >> 6;
+    std::uint32_t bit = idx & 63;
     bitmap[w] &= ~(1ULL << bit);
 }
 
 ConnectionContext* IoUringConnectionHandler::GetConnection()
 {
-    int idx = AllocSlot(connBitmap_.get(), connWords_, config_.networkConfig.maxConnections);
+    std::int64_t idx = AllocSlot(connBitmap_.get(), connWords_);
     if(idx < 0)
         return nullptr;
 
-    return &connections_[idx];
+    auto* ctx = &connections_[idx];
+    ctx->generationId++;
+
+    // If it wraps to 0, bump it to 1 cuz 0 is reserved for accepts / timers / cancels
+    if(ctx->generationId == 0)
+        ctx->generationId = 1;
+
+    return ctx;
 }
 
 void IoUringConnectionHandler::ReleaseConnection(ConnectionContext* ctx)
 {
-    // Sanity checks
     if(!ctx)
         return;
 
+    // Slot index is [current pointer] - [base pointer]
+    std::uint32_t idx  = ctx - &connections_[0];
+    auto&         slot = uringSlots_[idx];
+
+    timerWheel_.Cancel(idx);
+
+    if(ctx->isAsyncTimerOperation) {
+        if(timerHeap_.Remove(idx))
+            UpdateAsyncTimer();
+        else
+            logger_.Warn("[IoUring]: Failed to cancel async timer");
+    }
+
     if(ctx->socket > 0)
         close(ctx->socket);
 
-    ipLimiter_.ReleaseConnection(ctx->connInfo);
+    // Buffers which arrived while connection was busy go back to the ring
+    for(std::uint8_t i = 0; i < slot.stashCount; i++)
+        RecycleBuffer(slot.stashBids[i]);
 
-    ctx->ResetContext();
+    if(slot.spilled)
+        stashSpill_.erase(idx);
 
-    // Slot index is [current pointer] - [base pointer]
-    FreeSlot(connBitmap_.get(), ctx - (&connections_[0]));
-}
+    // Pipe might have leftover bytes from a half sent file, no reusing it
+    if(slot.pipeFds[0] >= 0) close(slot.pipeFds[0]);
+    if(slot.pipeFds[1] >= 0) close(slot.pipeFds[1]);
 
-AcceptSlot* IoUringConnectionHandler::GetAccept()
-{
-    int idx = AllocSlot(acceptBitmap_.get(), acceptWords_, config_.osSpecificConfig.acceptSlots);
-    if(idx < 0)
-        return nullptr;
+    ipLimiter_.ReleaseConnection(ctx->connInfo);
 
-    return &acceptSlots_[idx];
-}
+    ctx->ResetContext();
+    slot = UringSlot{};
 
-void IoUringConnectionHandler::ReleaseAccept(AcceptSlot *slot)
-{
-    // Sanity checks
-    if(!slot)
-        return;
-    
-    // Slot index is [current pointer] - [base pointer]
-    FreeSlot(acceptBitmap_.get(), slot - (&acceptSlots_[0]));
+    FreeSlot(connBitmap_.get(), idx);
 }
 
 //  --- MISC Handlers ---
-void IoUringConnectionHandler::SetNonBlocking(int fd)
+std::uint64_t IoUringConnectionHandler::NowMs()
 {
-    int flags = fcntl(fd, F_GETFL, 0);
-    if(flags != -1)
-        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        SteadyClock::now() - startTime_
+    ).count();
 }
 
-bool IoUringConnectionHandler::EnsureFileReady(ConnectionContext* ctx, std::string path)
+bool IoUringConnectionHandler::EnsureFileReady(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length)
 {
     auto [fd, size] = fileCache_.GetFileDesc(std::move(path));
     if(fd < 0)
@@ -415,189 +704,1251 @@ bool IoUringConnectionHandler::EnsureFileReady(ConnectionContext* ctx, std::stri
 
     if(!ctx->fileInfo)
         ctx->fileInfo = new FileInfo{};
-    
+
+    // Keeps fd open till this transfer is done with it ('ClearContext' / 'ResetContext' let go)
     auto* fileInfo = ctx->fileInfo;
+    if(fileInfo->fd >= 0)
+        fileCache_.Release(fileInfo->fd);
+
+    fileCache_.Retain(fd);
+
+    // Range requests send only a slice, 'fileSize' then marks where that slice ends
+    std::uint64_t fileSize = static_cast<std::uint64_t>(size);
+    std::uint64_t start    = std::min(offset, fileSize);
+    std::uint64_t end      = length < fileSize - start ? start + length : fileSize;
+
     fileInfo->fd       = fd;
-    fileInfo->offset   = 0;
-    fileInfo->fileSize = size;
+    fileInfo->offset   = static_cast<off_t>(start);
+    fileInfo->fileSize = static_cast<off_t>(end);
+
+    return true;
+}
+
+bool IoUringConnectionHandler::EnsureReadReady(ConnectionContext* ctx)
+{
+    auto& rwBuffer = ctx->rwBuffer;
+    auto& netCfg   = config_.networkConfig;
+
+    if(rwBuffer.IsReadInitialized())
+        return true;
+
+    if(!rwBuffer.InitReadBuffer(netCfg.bufferIncrSize)) {
+        logger_.Error("[IoUring]: Failed to init read buffer");
+        Close(ctx);
+        return false;
+    }
+    return true;
+}
+
+bool IoUringConnectionHandler::EnsurePipeReady(ConnectionContext* ctx)
+{
+    auto& slot = uringSlots_[ctx - &connections_[0]];
+    if(slot.pipeFds[0] >= 0)
+        return true;
+
+    // Non blocking so a splice out of an empty pipe gives us EAGAIN instead of hanging a worker
+    if(pipe2(slot.pipeFds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        logger_.Error("[IoUring]: Failed to create splice pipe: ", strerror(errno));
+        slot.pipeFds[0] = slot.pipeFds[1] = -1;
+        return false;
+    }
+
+    // Try to fit an entire file chunk in the pipe, if the system says no, live with the default
+    (void)fcntl(slot.pipeFds[1], F_SETPIPE_SZ, config_.osSpecificConfig.fileChunkSize);
+
+    int pipeSize = fcntl(slot.pipeFds[1], F_GETPIPE_SZ);
+    slot.pipeSize  = pipeSize > 0 ? static_cast<std::uint32_t>(pipeSize) : 64 * 1024;
+    slot.pipeBytes = 0;
 
     return true;
 }
 
-int IoUringConnectionHandler::ResolveHostToIpv4(const char *host, in_addr *outAddr)
+bool IoUringConnectionHandler::ResolveHostToIpv4(const char* host, in_addr* outAddr)
 {
     addrinfo hints = { 0 };
     addrinfo *res = nullptr, *rp = nullptr;
-    int ret = -1;
 
     hints.ai_family   = AF_INET;       // Force IPv4
     hints.ai_socktype = SOCK_STREAM;   // TCP style (doesn't really matter here)
     hints.ai_flags    = AI_ADDRCONFIG; // Use only configured addr families
 
-    ret = getaddrinfo(host, NULL, &hints, &res);
+    int ret = getaddrinfo(host, NULL, &hints, &res);
     if(ret != 0)
-        return -1;
+        return false;
 
     // Pick the first IPv4 result
+    bool found = false;
     for(rp = res; rp != NULL; rp = rp->ai_next) {
         if(rp->ai_family == AF_INET) {
             sockaddr_in* addr = (sockaddr_in*)rp->ai_addr;
             *outAddr = addr->sin_addr; // Copy the IPv4 address
-            freeaddrinfo(res);
-            return 0;
+            found = true;
+            break;
         }
     }
 
     freeaddrinfo(res);
-    return -1;
+    return found;
 }
 
-//  --- Socket Handlers ---
-void IoUringConnectionHandler::AddAccept()
+void IoUringConnectionHandler::Receive(ConnectionContext* ctx)
 {
-    // Base checks
-    io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
-    if(!sqe)
-        return;
-    
-    AcceptSlot* slot = GetAccept();
-    if(!slot)
+    // NOTE: Only SSL comes here, plain sockets are fed by multishot recv (see 'HandleRecv')
+    // Ensure buffer is ready
+    if(!EnsureReadReady(ctx))
         return;
 
-    slot->addrLen = sizeof(slot->addr);
+    auto& rwBuffer = ctx->rwBuffer;
+    bool  gotData  = false;
+
+    ctx->eventType = EventType::EVENT_RECV;
+
+    // SSL decrypts in userspace, drain whatever is there and wait for readiness if nothing is
+    while(true) {
+        ValidRegion region = rwBuffer.GetWritableReadRegion();
+        if(!region.ptr || region.len == 0) {
+            if(!rwBuffer.GrowReadBuffer(config_.networkConfig.bufferIncrSize,
+                                        config_.networkConfig.maxRecvBufferSize)) {
+                // Streamed body gets consumed chunk by chunk, let handler make room and come back-
+                // -for the rest of it ('ResumeReceive' calls us again)
+                if(ctx->isBodyWait && gotData)
+                    break;
+
+                logger_.Warn("[IoUring]: Read buffer full, closing connection");
+                Close(ctx);
+                return;
+            }
+            region = rwBuffer.GetWritableReadRegion();
+        }
+
+        ssize_t res = WrapRead(ctx, region.ptr, region.len);
+        if(res > 0) {
+            rwBuffer.AdvanceReadLength(res);
+            gotData = true;
+        }
+        // Connection closed by peer
+        else if(res == 0) {
+            Close(ctx);
+            return;
+        }
+        // res < 0
+        else {
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Only wait if we got nothing, otherwise engine decides if it wants more
+                if(!gotData) {
+                    // Don't hold onto an empty read buffer while waiting
+                    if(rwBuffer.GetReadMeta()->dataLength == 0)
+                        rwBuffer.ReleaseReadBuffer();
+
+                    AddPoll(ctx, POLLIN);
+                }
+                break;
+            }
 
-    io_uring_prep_accept(sqe, listenFd_, reinterpret_cast<sockaddr*>(&slot->addr),
-                            &slot->addrLen, 0);
-    io_uring_sqe_set_data(sqe, slot);
+            // Fatal error
+            Close(ctx);
+            return;
+        }
+    }
 
-    if(++sqeBatch_ >= config_.osSpecificConfig.batchSize)
-        SubmitBatch();
+    // Notify app
+    if(gotData)
+        onReceive_(ctx);
 }
 
-void IoUringConnectionHandler::AddRecv(ConnectionContext* ctx)
+int IoUringConnectionHandler::FillWriteIov(ConnectionContext* ctx, iovec (&iov)[2])
 {
-    // Base checks
-    io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
-    if(!sqe)
-        return;
+    auto* writeMeta = ctx->rwBuffer.GetWriteMeta();
+    int   iovCount  = 0;
+
+    // Headers (or whatever else got buffered) first, then the external body
+    if(writeMeta->writtenLength < writeMeta->dataLength)
+        iov[iovCount++] = {
+            ctx->rwBuffer.GetWriteData() + writeMeta->writtenLength,
+            writeMeta->dataLength - writeMeta->writtenLength
+        };
+
+    if(writeMeta->bodyWritten < writeMeta->bodyLength)
+        iov[iovCount++] = {
+            const_cast<char*>(writeMeta->bodyData) + writeMeta->bodyWritten, // Kernel only reads from it
+            writeMeta->bodyLength - writeMeta->bodyWritten
+        };
+
+    return iovCount;
+}
 
-    auto& networkConfig = config_.networkConfig;
+bool IoUringConnectionHandler::AppendReadData(ConnectionContext* ctx, const char* data, std::uint32_t len)
+{
+    if(!EnsureReadReady(ctx))
+        return false;
 
-    // Ensure read buffer exists
-    if(!ctx->rwBuffer.IsReadInitialized() && 
-        !ctx->rwBuffer.InitReadBuffer(pool_, networkConfig.bufferIncrSize))
-    {
-        logger_.Error("[IoUring]: Failed to init read buffer");
-        return;
-    }
+    auto& rwBuffer = ctx->rwBuffer;
 
-    // Get writable region of read buffer, try to grow if necessary
-    ValidRegion region = ctx->rwBuffer.GetWritableReadRegion();
-    if(!region.ptr || region.len == 0) {
-        if(!ctx->rwBuffer.GrowReadBuffer(networkConfig.bufferIncrSize, networkConfig.maxRecvBufferSize)) {
-            logger_.Warn("[IoUring]: Read buffer full, closing connection");
-            ReleaseConnection(ctx);
-            return;
+    while(len > 0) {
+        ValidRegion region = rwBuffer.GetWritableReadRegion();
+        if(!region.ptr || region.len == 0) {
+            if(!rwBuffer.GrowReadBuffer(config_.networkConfig.bufferIncrSize,
+                                        config_.networkConfig.maxRecvBufferSize)) {
+                logger_.Warn("[IoUring]: Read buffer full, closing connection");
+                Close(ctx);
+                return false;
+            }
+            continue;
         }
-        region = ctx->rwBuffer.GetWritableReadRegion();
-    }
 
-    // Leave -1 space for null terminator
-    io_uring_prep_recv(sqe, ctx->socket, region.ptr, region.len - 1, 0);
-    io_uring_sqe_set_data(sqe, ctx);
+        std::uint32_t n = static_cast<std::uint32_t>(std::min<std::size_t>(region.len, len));
+        std::memcpy(region.ptr, data, n);
+        rwBuffer.AdvanceReadLength(n);
 
-    ctx->eventType = EventType::EVENT_RECV;
+        data += n;
+        len  -= n;
+    }
 
-    if(++sqeBatch_ >= config_.osSpecificConfig.batchSize)
-        SubmitBatch();
+    return true;
 }
 
-void IoUringConnectionHandler::AddSend(ConnectionContext* ctx, std::string_view msg)
+void IoUringConnectionHandler::DrainPipelineQueue()
 {
-    // Base checks
-    io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
-    if(!sqe)
-        return;
+    // Only go through what's queued right now, connections queued while draining wait for next round
+    std::size_t count = pipelineQueue_.size();
+
+    for(std::size_t i = 0; i < count; i++) {
+        std::uint64_t      meta = pipelineQueue_[i];
+        std::uint32_t      idx  = static_cast<std::uint32_t>(meta & 0xFFFFFFFF);
+        ConnectionContext* ctx  = &connections_[idx];
+        auto&              slot = uringSlots_[idx];
+
+        // Connection died / got reused, or something else already picked it up in the meantime
+        if(ctx->generationId != (meta >> 32) || slot.closing || ctx->eventType != EventType::EVENT_RECV)
+            continue;
+
+        // Anything that came in while we were busy goes first
+        bool gotData = false;
+        if(!DrainStash(ctx, gotData))
+            continue;
+
+        // Multishot recv gets cancelled while we are busy (or ends on its own), bring it back
+        if(!ctx->sslConn && !slot.recvArmed)
+            AddRecv(ctx);
+
+        // Handler is waiting on its streamed body, and SSL has to go get it itself
+        if(ctx->sslConn && ctx->isBodyWait) {
+            Receive(ctx);
+            continue;
+        }
 
-    auto& networkConfig = config_.networkConfig;
+        if(!gotData && !ctx->HasPipelinedData())
+            continue;
 
-    // Direct send (static string, no buffering involved)
-    // NOTE: MSG IS PURELY USED FOR STATIC ERROR CODES, IT SHOULD NOT BE USED AS NORMAL PATH
-    if(!msg.empty())
-        io_uring_prep_send(sqe, ctx->socket, msg.data(),
-                           static_cast<unsigned int>(msg.size()), MSG_NOSIGNAL);
-    // Send from buffer
-    else {
-        auto* writeMeta = ctx->rwBuffer.GetWriteMeta();
-        if(!writeMeta || writeMeta->writtenLength >= writeMeta->dataLength)
-            return;
+        // Check per ip request rate BEFORE processing anything (rest of a body isn't a new request)
+        if(!ctx->isBodyWait && !ipLimiter_.AllowRequest(ctx->connInfo)) {
+            ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+            Write(ctx, HttpError::tooManyRequests);
+            continue;
+        }
+        onReceive_(ctx);
+    }
+
+    pipelineQueue_.erase(pipelineQueue_.begin(), pipelineQueue_.begin() + count);
+}
 
-        char* buf = ctx->rwBuffer.GetWriteData() + writeMeta->writtenLength;
-        std::uint32_t remaining = writeMeta->dataLength - writeMeta->writtenLength;
+bool IoUringConnectionHandler::DrainStash(ConnectionContext* ctx, bool& gotData)
+{
+    auto& slot = uringSlots_[ctx - &connections_[0]];
+
+    gotData = false;
+    if(slot.stashCount == 0)
+        return true;
+
+    // Take local copies, 'Close' below might end up resetting the slot under us
+    std::uint8_t  count = slot.stashCount;
+    std::uint16_t bids[URING_STASH_SIZE];
+    std::uint32_t lens[URING_STASH_SIZE];
+    std::memcpy(bids, slot.stashBids, sizeof(bids));
+    std::memcpy(lens, slot.stashLens, sizeof(lens));
+    slot.stashCount = 0;
+
+    std::string spill;
+    if(slot.spilled) {
+        auto it = stashSpill_.find(ctx - &connections_[0]);
+        spill   = std::move(it->second);
+        stashSpill_.erase(it);
+        slot.spilled = 0;
+    }
 
-        io_uring_prep_send(sqe, ctx->socket, buf, remaining, MSG_NOSIGNAL);
+    bool ok = true;
+    for(std::uint8_t i = 0; i < count; i++) {
+        if(ok)
+            ok = AppendReadData(ctx, GetRingBuffer(bids[i]), lens[i]);
+        RecycleBuffer(bids[i]);
     }
 
-    io_uring_sqe_set_data(sqe, ctx);
-    
-    ctx->eventType = EventType::EVENT_SEND;
+    // Came in after the ring buffers above, so it goes after them
+    if(ok && !spill.empty())
+        ok = AppendReadData(ctx, spill.data(), static_cast<std::uint32_t>(spill.size()));
 
-    if(++sqeBatch_ >= config_.osSpecificConfig.batchSize)
-        SubmitBatch();
+    gotData = ok;
+    return ok;
 }
 
-void IoUringConnectionHandler::AddFile(ConnectionContext *ctx)
+void IoUringConnectionHandler::SendFile(ConnectionContext* ctx)
 {
-    // AddSend after sending header, people expecting file im sending text
-    // Dawg im cooked
+    // This is called in this order: WriteFile() -> Write() [Headers sent] -> SendFile()
+    // This expects fileInfo to be constructed and set beforehand
     if(!ctx->fileInfo) {
-        ctx->isFileOperation = 0;
-        AddSend(ctx, internalError);
+        logger_.Warn("[IoUring]: SendFile expects ctx->fileInfo to be set, got nullptr");
+        ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+        Write(ctx, HttpError::internalError);
         return;
     }
 
     auto* fileInfo = ctx->fileInfo;
-    off_t offset   = fileInfo->offset;
-    off_t size     = fileInfo->fileSize;
-    off_t remain   = size - offset;
+    auto& slot     = uringSlots_[ctx - &connections_[0]];
+
+    // Plain sockets, splice file -> pipe -> socket entirely inside of the kernel
+    // SPLICE_OUT completion calls us back till everything is out of the pipe
+    if(!ctx->sslConn) {
+        if(fileInfo->offset < fileInfo->fileSize || slot.pipeBytes > 0) {
+            if(!EnsurePipeReady(ctx)) {
+                Close(ctx);
+                return;
+            }
 
-    if(remain <= 0)
-        return;
+            ctx->eventType = EventType::EVENT_SEND_FILE;
+            AddSplice(ctx);
+            return;
+        }
+    }
+
+    // SSL, same as epoll, kTLS sendfile or fallback to streaming
+    else {
+        int fd = fileInfo->fd;
+
+        while(fileInfo->offset < fileInfo->fileSize) {
+            ssize_t n = WrapFile(ctx, fd, &fileInfo->offset,
+                                   fileInfo->fileSize - fileInfo->offset);
+            // Try to send more of file
+            if(n > 0)
+                continue;
+
+            if(n < 0) {
+                // Check if we are switching to streaming mode
+                if(n == SWITCH_FILE_TO_STREAM) {
+                    ResumeStream(ctx);
+                    return;
+                }
+
+                // Partial progress, wait for socket to be writable again
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    ctx->eventType = EventType::EVENT_SEND_FILE;
+                    AddPoll(ctx, POLLOUT);
+                }
+
+                // Fatal error, close connection
+                else
+                    Close(ctx);
+
+                return;
+            }
+
+            // EOF / nothing sent
+            break;
+        }
+    }
+
+    if(ctx->GetConnectionState() == ConnectionState::CONNECTION_CLOSE)
+        Close(ctx);
+    else {
+        ctx->ClearContext();
+        ResumeReceive(ctx);
+    }
+}
+
+void IoUringConnectionHandler::ResumeStream(ConnectionContext* ctx)
+{
+    // Paranoia check
+    if(!ctx->streamGenerator) {
+        logger_.Warn("[IoUring]: 'streamGenerator' function called but is nullptr");
+        Close(ctx);
+        return;
+    }
+
+    // Stuff for ease of understanding
+    constexpr std::size_t chunkHeaderReserve = 10;
+    auto& rwBuffer = ctx->rwBuffer;
+
+    // Before we call stream generator, we need to reset buffer because we assume-
+    // -the last time it was called, the content of it has been written of to socket
+    auto writeMeta = rwBuffer.GetWriteMeta();
+    if(!writeMeta) {
+        Close(ctx);
+        return;
+    }
+
+    writeMeta->dataLength    = 0;
+    writeMeta->writtenLength = 0;
+
+    // Call stream generator function, passing in the write buffer of rwBuffer
+    auto writeRegion = rwBuffer.GetWritableWriteRegion();
+    if(!writeRegion.ptr || writeRegion.len == 0) {
+        Close(ctx);
+        return;
+    }
+
+    // The format for chunk is (if framing is true):
+    // <Chunk Size in Hex> \r\n [3 - 10 bytes]
+    // <Chunk> \r\n             [2 bytes]
+    char*       chunkPtr = !ctx->streamChunked ? writeRegion.ptr : writeRegion.ptr + chunkHeaderReserve;
+    std::size_t chunkCap = !ctx->streamChunked ? writeRegion.len : writeRegion.len - chunkHeaderReserve - 2;
+
+    auto streamResult = ctx->streamGenerator({ chunkPtr, chunkCap });
+
+    // Refresh timeout everytime a chunk is sent
+    RefreshExpiry(ctx, config_.networkConfig.idleTimeout);
+
+    switch(streamResult.action) {
+        case StreamAction::CONTINUE:
+        {
+            // The actual rwbuffer allows chunks only upto uint32 max only, if its 0 or > uint32 max-
+            // -its an invalid / corrupted output, 'Close' connection
+            if(streamResult.writtenBytes == 0 || streamResult.writtenBytes > UINT32_MAX) {
+                Close(ctx);
+                return;
+            }
+
+            // No need to add all the stuff, just send it as is
+            if(!ctx->streamChunked) {
+                writeMeta->dataLength = streamResult.writtenBytes;
+                Write(ctx);
+                return;
+            }
+
+            // Write chunk header to an intermediate buffer first
+            char chunkHeader[chunkHeaderReserve + 1] = { 0 };
+            int headerLen = snprintf(
+                chunkHeader, chunkHeaderReserve, "%zX\r\n", streamResult.writtenBytes
+            );
+            if(headerLen <= 0 || headerLen >= chunkHeaderReserve) {
+                Close(ctx);
+                return;
+            }
+
+            // Data length covers the entire reserved region, 'AdvanceWriteLength' below skips-
+            // -the unused part of the reserve so header sits right before the chunk
+            writeMeta->dataLength = chunkHeaderReserve + streamResult.writtenBytes + 2;
+
+            std::memcpy(chunkPtr - headerLen, chunkHeader, headerLen);
+            rwBuffer.AdvanceWriteLength(chunkHeaderReserve - headerLen);
+
+            // Append CRLF after data
+            char* trailer = chunkPtr + streamResult.writtenBytes;
+            *trailer++ = '\r';
+            *trailer++ = '\n';
+
+            Write(ctx);
+            return;
+        }
+        // Just resume the connection, we are done streaming
+        case StreamAction::STOP_AND_ALIVE_CONN:
+            ctx->SetConnectionState(ConnectionState::CONNECTION_ALIVE);
+            break;
+
+        // Do not resume connection, close it
+        case StreamAction::STOP_AND_CLOSE_CONN:
+        default:
+            ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+            break;
+    }
+
+    // Storing value before resetting it below
+    bool wasChunked = static_cast<bool>(ctx->streamChunked);
+
+    // Only STOP_AND_... states can reach here
+    writeMeta->dataLength    = 0;
+    writeMeta->writtenLength = 0;
+    ctx->isStreamOperation   = 0;
+    ctx->streamChunked       = 0;
+    ctx->streamGenerator     = {};
+
+    // Write final chunk or finalize stream
+    if(wasChunked)
+        rwBuffer.AppendData(CHUNK_END, sizeof(CHUNK_END) - 1)
+            ? Write(ctx)
+            : Close(ctx);
+
+    else if(ctx->GetConnectionState() == ConnectionState::CONNECTION_ALIVE) {
+        ctx->ClearContext();
+        ResumeReceive(ctx);
+    }
+
+    else Close(ctx);
+}
+
+void IoUringConnectionHandler::UpdateAsyncTimer()
+{
+    TimerNode* min = timerHeap_.GetMin();
+
+    // Base check, nothing is pending so disarm the timer
+    if(!min) {
+        itimerspec disarm{};
+        timerfd_settime(asyncTimerFd_, 0, &disarm, nullptr);
+        return;
+    }
+
+    std::uint64_t now     = NowMs();
+    std::uint64_t expire  = min->delay;
+    std::uint64_t remain  = (expire <= now) ? 1 : (expire - now);
+
+    itimerspec ts{};
+    ts.it_value.tv_sec  = remain / 1000;
+    ts.it_value.tv_nsec = (remain % 1000) * 1'000'000;
+    ts.it_interval      = {0, 0}; // Timer is one shot
+
+    while(timerfd_settime(asyncTimerFd_, 0, &ts, nullptr) < 0) {
+        if(errno == EINTR)
+            continue;
+        logger_.Error("[IoUring]: Failed to set async timer: ", strerror(errno));
+        break;
+    }
+}
+
+void IoUringConnectionHandler::HandleAccept(int res)
+{
+    // Transient error (EAGAIN, ECONNABORTED, EMFILE, ...), accept gets re-armed by caller
+    if(res < 0)
+        return;
+
+    int clientFd = res;
+
+    // Multishot accept shares one address buffer between all completions, so its useless-
+    // -by the time we see the CQE. Ask the socket itself
+    sockaddr_storage addr{};
+    socklen_t        len = sizeof(addr);
+    if(getpeername(clientFd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+        close(clientFd);
+        return;
+    }
+
+    // Extract IP info first
+    WFXIpAddress tmpIp;
+    sockaddr* sa = reinterpret_cast<sockaddr*>(&addr);
+    if(sa->sa_family == AF_INET) {
+        tmpIp.ip.v4  = reinterpret_cast<sockaddr_in*>(sa)->sin_addr;
+        tmpIp.ipType = AF_INET;
+    }
+    else if(sa->sa_family == AF_INET6) {
+        tmpIp.ip.v6  = reinterpret_cast<sockaddr_in6*>(sa)->sin6_addr;
+        tmpIp.ipType = AF_INET6;
+    }
+    // Garbage IPs not allowed, close connection
+    else {
+        close(clientFd);
+        return;
+    }
+
+    // Check limiter and try to grab a slot if its valid
+    ConnectionContext* ctx = nullptr;
+    if(!ipLimiter_.AllowConnection(tmpIp) || !(ctx = GetConnection())) {
+        close(clientFd);
+        return;
+    }
+
+    // Set connection info
+    ctx->socket   = clientFd;
+    ctx->connInfo = tmpIp;
+
+    WrapAccept(ctx);
+}
+
+void IoUringConnectionHandler::HandleCompletion(ConnectionContext* ctx, UringOp op, int res, std::uint32_t flags)
+{
+    auto& slot = uringSlots_[ctx - &connections_[0]];
+
+    switch(op) {
+        case UringOp::RECV:
+            HandleRecv(ctx, res, flags);
+            return;
+
+        case UringOp::SEND_ZC:
+            // Notification, kernel no longer references the buffer of some earlier send
+            if(flags & IORING_CQE_F_NOTIF) {
+                if(slot.zcInflight > 0 && --slot.zcInflight == 0 && slot.zcWaiting) {
+                    slot.zcWaiting = 0;
+                    Write(ctx);
+                }
+                return;
+            }
+
+            // Send failed before kernel pinned anything, no notification is coming for this one
+            if(!(flags & IORING_CQE_F_MORE) && slot.zcInflight > 0)
+                slot.zcInflight--;
+
+            slot.sendArmed = 0;
+
+            // Kernel (< 6.0) or socket doesn't support it, stop using it and resend normally
+            if(res == -EINVAL || res == -EOPNOTSUPP) {
+                logger_.Warn("[IoUring]: Zero copy send is not supported, falling back to normal send");
+                zeroCopyThreshold_ = 0;
+                Write(ctx);
+                return;
+            }
+            [[fallthrough]];
+
+        case UringOp::SEND:
+        {
+            // Socket buffer full, wait till it drains a bit
+            if(res == -EAGAIN) {
+                slot.sendArmed = 1;
+                AddPoll(ctx, POLLOUT);
+                return;
+            }
+
+            slot.sendArmed = 0;
+
+            if(res <= 0 || !ctx->rwBuffer.IsWriteInitialized()) {
+                Close(ctx);
+                return;
+            }
+
+            // 'Write' either queues the rest or moves on to whatever comes next
+            ctx->rwBuffer.AdvanceGatherLength(res);
+            Write(ctx);
+            return;
+        }
+
+        case UringOp::POLL:
+            if(res < 0) {
+                Close(ctx);
+                return;
+            }
+            HandleReady(ctx, res);
+            return;
+
+        // SPLICE_OUT is linked to this, so just do the bookkeeping here and let it decide
+        case UringOp::SPLICE_IN:
+            if(res <= 0) {
+                slot.spliceErr = 1;
+                return;
+            }
+            ctx->fileInfo->offset += res;
+            slot.pipeBytes        += res;
+            return;
+
+        case UringOp::SPLICE_OUT:
+            if(res > 0) {
+                slot.pipeBytes -= std::min<std::uint32_t>(res, slot.pipeBytes);
+                SendFile(ctx);
+                return;
+            }
+
+            // Socket is full but pipe still has stuff, wait for socket to be writable again
+            // If pipe is empty, SPLICE_IN found nothing to read (file got truncated), bail out
+            if(res == -EAGAIN && !slot.spliceErr && slot.pipeBytes > 0) {
+                AddPoll(ctx, POLLOUT);
+                return;
+            }
+
+            Close(ctx);
+            return;
+
+        default:
+            return;
+    }
+}
+
+void IoUringConnectionHandler::HandleRecv(ConnectionContext* ctx, int res, std::uint32_t flags)
+{
+    auto& slot = uringSlots_[ctx - &connections_[0]];
+    bool  busy = !ctx->CanReceive();
+
+    if(!(flags & IORING_CQE_F_MORE))
+        slot.recvArmed = 0;
+
+    if(res <= 0) {
+        // Ring ran dry, buffers come back as soon as CQEs get processed so just try again
+        // If we are busy, 'ResumeReceive' will re-arm it once we are done
+        if(res == -ENOBUFS) {
+            if(!busy && !slot.recvArmed)
+                AddRecv(ctx);
+            return;
+        }
+
+        // We cancelled it ourselves because connection was busy
+        if(res == -ECANCELED)
+            return;
+
+        // Peer half closed while we were still working on its request, epoll wouldn't notice it-
+        // -either, let the response go out and 'ResumeReceive' will see the EOF again
+        if(res == 0 && busy)
+            return;
+
+        // Connection closed by peer / Fatal error
+        Close(ctx);
+        return;
+    }
+
+    if(!(flags & IORING_CQE_F_BUFFER)) {
+        Close(ctx);
+        return;
+    }
+
+    std::uint16_t bid = static_cast<std::uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+
+    // Connection is still working on previous request (pipelining / async), we cannot touch-
+    // -the read buffer as request is pointing into it. Hold onto the ring buffer till we are done
+    if(busy) {
+        // Cancel below was already sent, these are CQEs kernel posted before it landed (pipelining-
+        // -client / fast uploader). Data is out of the socket by now, so copy it aside and give-
+        // -the ring buffer back. Read buffer can't hold more than this anyways
+        if(slot.stashCount >= URING_STASH_SIZE) {
+            std::uint32_t idx   = ctx - &connections_[0];
+            std::string&  spill = stashSpill_[idx];
+
+            if(spill.size() + res > config_.networkConfig.maxRecvBufferSize) {
+                RecycleBuffer(bid);
+                logger_.Warn("[IoUring]: Read buffer full, closing connection");
+                Close(ctx);
+                return;
+            }
+
+            spill.append(GetRingBuffer(bid), static_cast<std::size_t>(res));
+            RecycleBuffer(bid);
+
+            // First cancel might not have made it (no SQE), try once more
+            if(!slot.spilled && slot.recvArmed)
+                AddCancelRecv(ctx);
+
+            slot.spilled = 1;
+            return;
+        }
+
+        slot.stashBids[slot.stashCount] = bid;
+        slot.stashLens[slot.stashCount] = static_cast<std::uint32_t>(res);
+        slot.stashCount++;
+
+        // Stop the kernel from feeding us more, rest can wait in the socket buffer
+        if(slot.recvArmed && slot.stashCount == 1)
+            AddCancelRecv(ctx);
+        return;
+    }
+
+    // Check per ip request rate BEFORE processing anything (rest of a body isn't a new request)
+    if(!ctx->isBodyWait && !ipLimiter_.AllowRequest(ctx->connInfo)) {
+        RecycleBuffer(bid);
+        ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+        Write(ctx, HttpError::tooManyRequests);
+        return;
+    }
+
+    bool ok = AppendReadData(ctx, GetRingBuffer(bid), static_cast<std::uint32_t>(res));
+    RecycleBuffer(bid);
+
+    if(ok)
+        onReceive_(ctx);
+}
+
+void IoUringConnectionHandler::HandleReady(ConnectionContext* ctx, int revents)
+{
+    // SSL handshake in progress
+    if(ctx->eventType == EventType::EVENT_HANDSHAKE) {
+        SSLReturn hsResult = sslHandler_->Handshake(ctx->sslConn);
+
+        switch(hsResult) {
+            // Handshake done, switch to EVENT_RECV as we are ready to read data
+            case SSLReturn::SUCCESS:
+                Receive(ctx);
+                break;
+
+            // Handshake isn't finished, wait for more events
+            case SSLReturn::WANT_READ:
+                AddPoll(ctx, POLLIN);
+                break;
+
+            case SSLReturn::WANT_WRITE:
+                AddPoll(ctx, POLLOUT);
+                break;
+
+            // Any error or closed connection
+            case SSLReturn::CLOSED:
+            case SSLReturn::SYSCALL:
+            case SSLReturn::FATAL:
+            default:
+                Close(ctx);
+                break;
+        }
+        return;
+    }
+
+    // SSL shutdown is in progress
+    if(ctx->eventType == EventType::EVENT_SHUTDOWN) {
+        auto res = sslHandler_->Shutdown(ctx->sslConn);
+
+        switch(res) {
+            // Shutdown still needs time, wait for more data
+            case SSLReturn::WANT_READ:
+                AddPoll(ctx, POLLIN);
+                break;
+
+            case SSLReturn::WANT_WRITE:
+                AddPoll(ctx, POLLOUT);
+                break;
+
+            // Success or Failure, manually shutdown the connection
+            // Nothing else is in flight (we are handling the only SQE), so release right away
+            case SSLReturn::SUCCESS:
+            case SSLReturn::FATAL:
+            default:
+                ctx->sslConn = nullptr;
+                ReleaseConnection(ctx);
+                break;
+        }
+        return;
+    }
+
+    if(revents & (POLLERR | POLLHUP)) {
+        Close(ctx);
+        return;
+    }
+
+    switch(ctx->eventType) {
+        case EventType::EVENT_RECV:
+            // Check per ip request rate BEFORE processing anything (rest of a body isn't a new request)
+            if(!ctx->isBodyWait && !ipLimiter_.AllowRequest(ctx->connInfo)) {
+                ctx->SetConnectionState(ConnectionState::CONNECTION_CLOSE);
+                Write(ctx, HttpError::tooManyRequests);
+                return;
+            }
+            Receive(ctx);
+            break;
+
+        case EventType::EVENT_SEND:
+            uringSlots_[ctx - &connections_[0]].sendArmed = 0;
+            Write(ctx, {});
+            break;
+
+        case EventType::EVENT_SEND_FILE:
+            SendFile(ctx);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void IoUringConnectionHandler::WrapAccept(ConnectionContext* ctx)
+{
+    // Set an initial timeout for the new connection so they don't connect-
+    // -and stay idle forever
+    RefreshExpiry(ctx, config_.networkConfig.idleTimeout);
+
+    if(!useHttps_) {
+        ResumeReceive(ctx);
+        return;
+    }
+
+    ctx->sslConn = sslHandler_->Wrap(ctx->socket);
+    if(!ctx->sslConn) {
+        Close(ctx);
+        return;
+    }
+
+    // Try handshake immediately
+    ctx->eventType = EventType::EVENT_HANDSHAKE;
+
+    SSLReturn hsResult = sslHandler_->Handshake(ctx->sslConn);
+
+    switch(hsResult) {
+        case SSLReturn::SUCCESS:
+            Receive(ctx);
+            break;
+
+        case SSLReturn::WANT_READ:
+            AddPoll(ctx, POLLIN);
+            break;
+
+        case SSLReturn::WANT_WRITE:
+            AddPoll(ctx, POLLOUT);
+            break;
+
+        // Handshake failed or connection closed
+        default:
+            Close(ctx);
+            break;
+    }
+}
+
+ssize_t IoUringConnectionHandler::WrapRead(ConnectionContext* ctx, char* buf, std::size_t len)
+{
+    if(!ctx->sslConn)
+        return ::recv(ctx->socket, buf, len, 0);
+
+    SSLResult result = sslHandler_->Read(ctx->sslConn, buf, static_cast<int>(len));
+
+    switch(result.error) {
+        case SSLReturn::SUCCESS:
+            return result.res;
+        case SSLReturn::WANT_READ:
+        case SSLReturn::WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSLReturn::CLOSED:
+            return 0;
+        case SSLReturn::SYSCALL:
+            return -1; // errno is already set by SSL
+        case SSLReturn::FATAL:
+        default:
+            errno = EIO;
+            return -1;
+    }
+}
+
+ssize_t IoUringConnectionHandler::WrapWrite(ConnectionContext* ctx, const char* buf, std::size_t len)
+{
+    if(!ctx->sslConn)
+        return ::send(ctx->socket, buf, len, MSG_NOSIGNAL);
+
+    SSLResult result = sslHandler_->Write(ctx->sslConn, buf, static_cast<int>(len));
+
+    switch(result.error) {
+        case SSLReturn::SUCCESS:
+            return result.res;
+        case SSLReturn::WANT_READ:
+        case SSLReturn::WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSLReturn::CLOSED:
+            return 0;
+        case SSLReturn::SYSCALL:
+            return -1; // errno is already set by SSL
+        case SSLReturn::FATAL:
+        default:
+            errno = EIO;
+            return -1;
+    }
+}
 
-    // Get submission queue entry
+ssize_t IoUringConnectionHandler::WrapFile(ConnectionContext* ctx, int fd, off_t* offset, std::size_t count)
+{
+    // Plain sockets never come here, they go through 'AddSplice'
+    SSLResult result = sslHandler_->WriteFile(ctx->sslConn, fd, offset ? *offset : 0, count);
+
+    switch(result.error) {
+        // Switch to streaming mode with Write instead
+        // Stream will uses a non chunked mode of transferring files (cuz we already sent the header)
+        case SSLReturn::NO_IMPL:
+            ctx->isFileOperation   = 0;
+            ctx->isStreamOperation = 1;
+            ctx->streamChunked     = 0;
+            ctx->streamGenerator   = [
+                fileInfo = ctx->fileInfo
+            ](StreamBuffer buffer) {
+                // Never past 'fileSize', for range requests thats the end of range and not the file
+                std::size_t toRead = std::min<std::size_t>(buffer.size, fileInfo->fileSize - fileInfo->offset);
+                if(toRead == 0)
+                    return StreamResult{ 0, StreamAction::STOP_AND_ALIVE_CONN };
+
+                std::int64_t res = pread(fileInfo->fd, buffer.buffer, toRead, fileInfo->offset);
+                // Error or EOF
+                if(res <= 0)
+                    return StreamResult{
+                        0, res == 0
+                            ? StreamAction::STOP_AND_ALIVE_CONN
+                            : StreamAction::STOP_AND_CLOSE_CONN
+                    };
+
+                // No error
+                fileInfo->offset += res;
+                return StreamResult{ static_cast<std::size_t>(res), StreamAction::CONTINUE };
+            };
+
+            // Signal to caller that streaming mode is engaged
+            return SWITCH_FILE_TO_STREAM;
+
+        case SSLReturn::SUCCESS:
+            if(offset)
+                *offset += result.res; // Manually track progress
+            return result.res;
+        case SSLReturn::WANT_READ:
+        case SSLReturn::WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSLReturn::CLOSED:
+            return 0;
+        case SSLReturn::SYSCALL:
+            return -1; // errno already set by SSL
+        case SSLReturn::FATAL:
+        default:
+            errno = EIO;
+            return -1;
+    }
+}
+
+//  --- SQE Handlers ---
+io_uring_sqe* IoUringConnectionHandler::GetSqe()
+{
     io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
-    if(!sqe)
+    if(sqe)
+        return sqe;
+
+    // Submission queue is full, flush it and try again
+    io_uring_submit(&ring_);
+    return io_uring_get_sqe(&ring_);
+}
+
+std::uint64_t IoUringConnectionHandler::PackUserData(ConnectionContext* ctx, UringOp op)
+{
+    // Pack GenerationID (High 32), Op (8) and Index (Low 24)
+    std::uint32_t idx = static_cast<std::uint32_t>(ctx - connections_.get());
+    return (static_cast<std::uint64_t>(ctx->generationId) << 32)
+        | (static_cast<std::uint64_t>(op) << 24)
+        | idx;
+}
+
+void IoUringConnectionHandler::AddAccept()
+{
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe) {
+        logger_.Error("[IoUring]: Failed to get SQE for accept");
         return;
+    }
 
-    // Use a chunk size for large files
-    off_t chunk = std::min<off_t>(remain, config_.osSpecificConfig.fileChunkSize);
+    // One SQE, a CQE for every connection. Client sockets are non blocking, SSL relies on-
+    // -EAGAIN to know when to wait
+    io_uring_prep_multishot_accept(sqe, listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    io_uring_sqe_set_data64(sqe, static_cast<std::uint64_t>(UringOp::ACCEPT) << 24);
+}
 
-    // Fully async file sending
-    io_uring_prep_splice(
-        sqe,
-        fileInfo->fd,       // input fd
-        fileInfo->offset,   // input offset
-        ctx->socket,        // output fd (socket)
-        -1,                 // offset ignored for sockets
-        chunk,
-        0                   // flags (0 for default)
-    );
+void IoUringConnectionHandler::AddTimerRead(int fd, std::uint64_t* expirations, UringOp op)
+{
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe) {
+        logger_.Error("[IoUring]: Failed to get SQE for timer");
+        return;
+    }
+
+    // We just need to drain the timerfd, we dont care about the 'expirations' value
+    io_uring_prep_read(sqe, fd, expirations, sizeof(*expirations), 0);
+    io_uring_sqe_set_data64(sqe, static_cast<std::uint64_t>(op) << 24);
+}
+
+void IoUringConnectionHandler::AddFileWatch()
+{
+    // Owned by 'FileCache', only there if it watches anything
+    int fd = fileCache_.GetWatchFd();
+    if(fd < 0)
+        return;
+
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe) {
+        logger_.Error("[IoUring]: Failed to get SQE for file watch");
+        return;
+    }
+
+    // Readiness only, 'FileCache' drains the fd itself
+    io_uring_prep_poll_add(sqe, fd, POLLIN);
+    io_uring_sqe_set_data64(sqe, static_cast<std::uint64_t>(UringOp::FILE_WATCH) << 24);
+}
+
+void IoUringConnectionHandler::AddRecv(ConnectionContext* ctx)
+{
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe) {
+        Close(ctx);
+        return;
+    }
+
+    auto& slot = uringSlots_[ctx - &connections_[0]];
+
+    // No buffer of our own, kernel picks one from the ring only once data actually arrives
+    io_uring_prep_recv_multishot(sqe, ctx->socket, nullptr, 0, 0);
+    io_uring_sqe_set_flags(sqe, IOSQE_BUFFER_SELECT);
+    sqe->buf_group = BUFFER_GROUP_ID;
+    io_uring_sqe_set_data64(sqe, PackUserData(ctx, UringOp::RECV));
+
+    slot.recvArmed = 1;
+    slot.pending++;
+}
+
+void IoUringConnectionHandler::AddSend(ConnectionContext* ctx)
+{
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe) {
+        Close(ctx);
+        return;
+    }
+
+    auto& slot     = uringSlots_[ctx - &connections_[0]];
+    int   iovCount = FillWriteIov(ctx, slot.sendIov);
+
+    std::size_t total = 0;
+    for(int i = 0; i < iovCount; i++)
+        total += slot.sendIov[i].iov_len;
+
+    // Large enough send, let kernel reference our pages instead of copying them
+    // Write buffer stays untouched till its notification CQE arrives (see 'Write')
+    bool    zeroCopy = zeroCopyThreshold_ > 0 && total >= zeroCopyThreshold_;
+    UringOp op       = zeroCopy ? UringOp::SEND_ZC : UringOp::SEND;
+
+    // Just headers (or a body which fit in buffer), plain send does the job
+    if(iovCount == 1) {
+        if(zeroCopy)
+            io_uring_prep_send_zc(sqe, ctx->socket, slot.sendIov[0].iov_base, total, MSG_NOSIGNAL, 0);
+        else
+            io_uring_prep_send(sqe, ctx->socket, slot.sendIov[0].iov_base, total, MSG_NOSIGNAL);
+    }
+
+    // Headers + external body, gather them into one send. 'msghdr' lives in the slot cuz-
+    // -kernel may read it after submission
+    else {
+        slot.sendMsg            = {};
+        slot.sendMsg.msg_iov    = slot.sendIov;
+        slot.sendMsg.msg_iovlen = iovCount;
+
+        if(zeroCopy)
+            io_uring_prep_sendmsg_zc(sqe, ctx->socket, &slot.sendMsg, MSG_NOSIGNAL);
+        else
+            io_uring_prep_sendmsg(sqe, ctx->socket, &slot.sendMsg, MSG_NOSIGNAL);
+    }
+
+    io_uring_sqe_set_data64(sqe, PackUserData(ctx, op));
+
+    if(zeroCopy)
+        slot.zcInflight++;
+    slot.pending++;
+}
+
+void IoUringConnectionHandler::AddPoll(ConnectionContext* ctx, unsigned pollMask)
+{
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe) {
+        Close(ctx, true);
+        return;
+    }
+
+    // One shot, 'ctx->eventType' decides what happens once it fires
+    io_uring_prep_poll_add(sqe, ctx->socket, pollMask);
+    io_uring_sqe_set_data64(sqe, PackUserData(ctx, UringOp::POLL));
+    uringSlots_[ctx - &connections_[0]].pending++;
+}
+
+void IoUringConnectionHandler::AddSplice(ConnectionContext* ctx)
+{
+    auto* fileInfo = ctx->fileInfo;
+    auto& slot     = uringSlots_[ctx - &connections_[0]];
+
+    slot.spliceErr = 0;
+
+    // Pipe is empty, fill it from file and drain it into socket in one linked go
+    if(slot.pipeBytes == 0) {
+        std::uint32_t chunk = static_cast<std::uint32_t>(std::min<off_t>(
+            fileInfo->fileSize - fileInfo->offset,
+            std::min(config_.osSpecificConfig.fileChunkSize, slot.pipeSize)
+        ));
+
+        // Both halves of the link must go out in the same submit, otherwise the chain gets cut-
+        // -and SPLICE_OUT could run before SPLICE_IN even started
+        if(io_uring_sq_space_left(&ring_) < 2)
+            io_uring_submit(&ring_);
+
+        io_uring_sqe* inSqe  = io_uring_get_sqe(&ring_);
+        io_uring_sqe* outSqe = io_uring_get_sqe(&ring_);
+        if(!inSqe || !outSqe) {
+            // Grabbed one but not the other, turn it into a no-op so it doesn't do anything stupid
+            if(inSqe) {
+                io_uring_prep_nop(inSqe);
+                io_uring_sqe_set_data64(inSqe, static_cast<std::uint64_t>(UringOp::CANCEL) << 24);
+            }
+            Close(ctx);
+            return;
+        }
 
-    io_uring_sqe_set_data(sqe, ctx);
-    ctx->eventType = EventType::EVENT_SEND_FILE;
+        io_uring_prep_splice(inSqe, fileInfo->fd, fileInfo->offset, slot.pipeFds[1], -1, chunk, 0);
+        io_uring_sqe_set_data64(inSqe, PackUserData(ctx, UringOp::SPLICE_IN));
+        io_uring_sqe_set_flags(inSqe, IOSQE_IO_LINK);
+        slot.pending++;
 
-    if(++sqeBatch_ >= config_.osSpecificConfig.batchSize)
-        SubmitBatch();
+        io_uring_prep_splice(outSqe, slot.pipeFds[0], -1, ctx->socket, -1, chunk, 0);
+        io_uring_sqe_set_data64(outSqe, PackUserData(ctx, UringOp::SPLICE_OUT));
+        slot.pending++;
+        return;
+    }
+
+    // Leftovers from last time, socket couldn't take everything, just drain the pipe
+    io_uring_sqe* outSqe = GetSqe();
+    if(!outSqe) {
+        Close(ctx);
+        return;
+    }
+
+    io_uring_prep_splice(outSqe, slot.pipeFds[0], -1, ctx->socket, -1, slot.pipeBytes, 0);
+    io_uring_sqe_set_data64(outSqe, PackUserData(ctx, UringOp::SPLICE_OUT));
+    slot.pending++;
 }
 
-void IoUringConnectionHandler::SubmitBatch()
+void IoUringConnectionHandler::AddCancel(ConnectionContext* ctx)
 {
-    if(sqeBatch_ > 0) {
-        io_uring_submit(&ring_);
-        sqeBatch_ = 0;
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe) {
+        // Can't even cancel, shutting down the socket wakes up anything waiting on it anyways
+        ::shutdown(ctx->socket, SHUT_RDWR);
+        return;
     }
+
+    // Cancel everything on this socket, each cancelled SQE completes with -ECANCELED
+    io_uring_prep_cancel_fd(sqe, ctx->socket, IORING_ASYNC_CANCEL_ALL);
+    io_uring_sqe_set_data64(sqe, static_cast<std::uint64_t>(UringOp::CANCEL) << 24);
+}
+
+void IoUringConnectionHandler::AddCancelRecv(ConnectionContext* ctx)
+{
+    io_uring_sqe* sqe = GetSqe();
+    if(!sqe)
+        return; // Not the end of the world, stash spills over if it has to
+
+    io_uring_prep_cancel64(sqe, PackUserData(ctx, UringOp::RECV), 0);
+    io_uring_sqe_set_data64(sqe, static_cast<std::uint64_t>(UringOp::CANCEL) << 24);
+}
+
+//  --- Provided Buffer Ring ---
+void IoUringConnectionHandler::InitBufferRing()
+{
+    auto& osConfig = config_.osSpecificConfig;
+
+    bufCount_ = osConfig.recvBufferCount;
+    bufSize_  = osConfig.recvBufferSize;
+
+    if(bufCount_ == 0 || bufCount_ > 32768 || (bufCount_ & (bufCount_ - 1)))
+        logger_.Fatal("[IoUring]: 'recv_buffer_count' must be a power of 2 between 1 and 32768, got ", bufCount_);
+
+    if(bufSize_ == 0)
+        logger_.Fatal("[IoUring]: 'recv_buffer_size' must be greater than 0");
+
+    int ret  = 0;
+    bufRing_ = io_uring_setup_buf_ring(&ring_, bufCount_, BUFFER_GROUP_ID, 0, &ret);
+    if(!bufRing_)
+        logger_.Fatal("[IoUring]: Failed to setup provided buffer ring: ", strerror(-ret));
+
+    // Not using 'make_unique', it zeroes out the memory which makes all of it resident right away
+    bufRingMem_ = std::unique_ptr<char[]>(new char[std::size_t(bufCount_) * bufSize_]);
+    bufMask_    = io_uring_buf_ring_mask(bufCount_);
+
+    for(std::uint16_t i = 0; i < bufCount_; i++)
+        io_uring_buf_ring_add(bufRing_, GetRingBuffer(i), bufSize_, i, bufMask_, i);
+
+    io_uring_buf_ring_advance(bufRing_, bufCount_);
+}
+
+char* IoUringConnectionHandler::GetRingBuffer(std::uint16_t bid)
+{
+    return bufRingMem_.get() + std::size_t(bid) * bufSize_;
+}
+
+void IoUringConnectionHandler::RecycleBuffer(std::uint16_t bid)
+{
+    io_uring_buf_ring_add(bufRing_, GetRingBuffer(bid), bufSize_, bid, bufMask_, 0);
+    io_uring_buf_ring_advance(bufRing_, 1);
 }
 
 } // namespace WFX::OSSpecific
 
-#endif // WFX_LINUX_USE_IO_URING
\ No newline at end of file
+#endif // WFX_LINUX_USE_IO_URING
@@ -6,11 +6,18 @@
 #include "config/config.hpp"
 #include "http/connection/http_connection.hpp"
 #include "http/limits/ip_limiter/ip_limiter.hpp"
-#include "utils/buffer_pool/buffer_pool.hpp"
+#include "http/ssl/http_ssl.hpp"
+#include "utils/fileops/filecache.hpp"
+#include "utils/timer/timer_wheel/timer_wheel.hpp"
+#include "utils/timer/timer_heap/timer_heap.hpp"
 
 #include <liburing.h>
+#include <sys/uio.h>
 #include <atomic>
-#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace WFX::OSSpecific {
 
@@ -18,80 +25,183 @@ using namespace WFX::Http;  // For 'HttpConnectionHandler', 'ReceiveCallback', '
 using namespace WFX::Utils; // For 'Logger', 'RWBuffer', ...
 using namespace WFX::Core;  // For 'Config'
 
-struct AcceptSlot : public ConnectionTag {
-    socklen_t        addrLen = 0;
-    sockaddr_storage addr    = { 0 };
+using SteadyClock = std::chrono::steady_clock;
+
+// What a submitted SQE was for, packed into its 'user_data' alongside generation + index
+// Layout of 'user_data': [ Generation (32) | Op (8) | Index (24) ]
+// Generation 0 is reserved for non connection stuff (accepts, timers, cancels)
+enum class UringOp : std::uint8_t {
+    // Special (Generation == 0)
+    ACCEPT,
+    TIMEOUT_TIMER,
+    ASYNC_TIMER,
+    FILE_WATCH, // 'FileCache' inotify fd became readable
+    CANCEL,
+
+    // Per connection (Generation > 0)
+    RECV,       // Multishot, fed from the provided buffer ring
+    SEND,
+    SEND_ZC,    // Zero copy send, posts an extra notification CQE once kernel is done with our buffer
+    POLL,       // Readiness wait, used by SSL and as EAGAIN fallback
+    SPLICE_IN,  // File -> Pipe
+    SPLICE_OUT  // Pipe -> Socket
+};
+
+// Max provided buffers a busy connection holds onto, anything past it gets copied aside (see 'HandleRecv')
+constexpr std::uint8_t URING_STASH_SIZE = 4;
+
+// io_uring specific per connection state, kept outside of 'ConnectionContext' so it stays <= 128 bytes
+struct UringSlot {
+    std::uint8_t  pending    = 0;  // SQEs in flight which still reference this connection (multishot counts once)
+    std::uint8_t  closing    = 0;  // Release connection once 'pending' drains to 0
+    std::uint8_t  spliceErr  = 0;  // SPLICE_IN failed, SPLICE_OUT should bail
+    std::uint8_t  recvArmed  = 0;  // Multishot recv is still active
+    std::uint8_t  sendArmed  = 0;  // SEND (or POLLOUT for one) in flight, its completion calls 'Write'
+    std::uint8_t  stashCount = 0;  // Provided buffers which arrived while connection was busy
+    std::uint8_t  spilled    = 0;  // Stash overflowed, rest of it sits in 'stashSpill_'
+    std::uint8_t  zcInflight = 0;  // SEND_ZCs whose notification hasn't arrived yet
+    std::uint8_t  zcWaiting  = 0;  // 'Write' is done but write buffer can't be reused till 'zcInflight' hits 0
+    int           pipeFds[2] = { -1, -1 };
+    std::uint32_t pipeSize   = 0;  // Capacity of the pipe
+    std::uint32_t pipeBytes  = 0;  // Bytes spliced into the pipe but not yet out of it
+
+    std::uint16_t stashBids[URING_STASH_SIZE] = {};
+    std::uint32_t stashLens[URING_STASH_SIZE] = {};
+
+    iovec         sendIov[2] = {};  // |
+    msghdr        sendMsg    = {};  // |-> Gather send (headers + external body), must outlive the SQE
 };
 
 class IoUringConnectionHandler : public HttpConnectionHandler {
 public:
-    IoUringConnectionHandler() = default;
+    IoUringConnectionHandler(bool useHttps);
     ~IoUringConnectionHandler();
 
 public: // Initializing
-    void Initialize(const std::string& host, int port) override;
-    void SetReceiveCallback(ReceiveCallback onData)    override;
-    
+    void Initialize(const std::string& host, int port)                                 override;
+    void SetEngineCallbacks(ReceiveCallback onData, CompletionCallback onComplete)     override;
+
 public: // I/O Operations
-    void ResumeReceive(ConnectionContext* ctx)                       override;
-    void Write(ConnectionContext* ctx, std::string_view buffer = {}) override;
-    void WriteFile(ConnectionContext* ctx, std::string path)         override;
-    void Close(ConnectionContext* ctx)                               override;
-    
+    void ResumeReceive(ConnectionContext* ctx)                                         override;
+    void Write(ConnectionContext* ctx, std::string_view buffer = {})                   override;
+    void WriteFile(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length) override;
+    void Stream(ConnectionContext* ctx, StreamGenerator generator, bool streamChunked) override;
+    void Close(ConnectionContext* ctx, bool forceClose = false)                        override;
+
 public: // Main Functions
-    void Run()                                                               override;
-    void RefreshExpiry(ConnectionContext* ctx, std::uint16_t timeoutSeconds) override;
-    void Stop()                                                              override;
+    void Run()                                                                      override;
+    void RefreshExpiry(ConnectionContext* ctx, std::uint16_t timeoutSeconds)        override;
+    bool RefreshAsyncTimer(ConnectionContext* ctx, std::uint32_t delayMilliseconds) override;
+    void Stop()                                                                     override;
 
 private: // Helper Functions
-    int                AllocSlot(std::uint64_t* bitmap, int numWords, int maxSlots);
-    void               FreeSlot(std::uint64_t* bitmap, int idx);
-    
+    std::int64_t       AllocSlot(std::uint64_t* bitmap, std::uint32_t numWords);
+    void               FreeSlot(std::uint64_t* bitmap, std::uint32_t idx);
     ConnectionContext* GetConnection();
     void               ReleaseConnection(ConnectionContext* ctx);
-    AcceptSlot*        GetAccept();
-    void               ReleaseAccept(AcceptSlot* slot);
-
-    void               SetNonBlocking(int fd);
-    bool               EnsureFileReady(ConnectionContext* ctx, std::string path);
-    int                ResolveHostToIpv4(const char* host, in_addr* outAddr);
 
+    std::uint64_t      NowMs();
+    bool               EnsureFileReady(ConnectionContext* ctx, std::string path, std::uint64_t offset, std::uint64_t length);
+    bool               EnsureReadReady(ConnectionContext* ctx);
+    bool               EnsurePipeReady(ConnectionContext* ctx);
+    bool               ResolveHostToIpv4(const char* host, in_addr* outAddr);
+
+    void               Receive(ConnectionContext* ctx);
+    void               SendFile(ConnectionContext* ctx);
+    void               ResumeStream(ConnectionContext* ctx);
+    void               UpdateAsyncTimer();
+    void               HandleAccept(int res);
+    void               HandleCompletion(ConnectionContext* ctx, UringOp op, int res, std::uint32_t flags);
+    void               HandleRecv(ConnectionContext* ctx, int res, std::uint32_t flags);
+    void               HandleReady(ConnectionContext* ctx, int revents);
+    bool               AppendReadData(ConnectionContext* ctx, const char* data, std::uint32_t len);
+    bool               DrainStash(ConnectionContext* ctx, bool& gotData);
+    void               DrainPipelineQueue();
+    int                FillWriteIov(ConnectionContext* ctx, iovec (&iov)[2]);
+
+    void               WrapAccept(ConnectionContext* ctx);
+    ssize_t            WrapRead(ConnectionContext* ctx, char* buf, std::size_t len);
+    ssize_t            WrapWrite(ConnectionContext* ctx, const char* buf, std::size_t len);
+    ssize_t            WrapFile(ConnectionContext* ctx, int fd, off_t* offset, std::size_t count);
+
+private: // SQE Helpers
+    io_uring_sqe*      GetSqe();
+    std::uint64_t      PackUserData(ConnectionContext* ctx, UringOp op);
     void               AddAccept();
+    void               AddTimerRead(int fd, std::uint64_t* expirations, UringOp op);
+    void               AddFileWatch();
     void               AddRecv(ConnectionContext* ctx);
-    void               AddSend(ConnectionContext* ctx, std::string_view msg);
-    void               AddFile(ConnectionContext* ctx);
-    void               SubmitBatch();
-
-private:
-    // Misc
-    IpLimiter&        ipLimiter_  = IpLimiter::GetInstance();
-    Config&           config_     = Config::GetInstance();
-    Logger&           logger_     = Logger::GetInstance();
-    std::atomic<bool> running_    = true;
-    ReceiveCallback   onReceive_;
-    BufferPool        pool_{1, 1024 * 1024, [](std::size_t currSize){ return currSize * 2; }};
-    FileCache*        fileCache_  = GetGlobalState().fileCache;
-
-private:
-    // IoUring
+    void               AddSend(ConnectionContext* ctx);
+    void               AddPoll(ConnectionContext* ctx, unsigned pollMask);
+    void               AddSplice(ConnectionContext* ctx);
+    void               AddCancel(ConnectionContext* ctx);
+    void               AddCancelRecv(ConnectionContext* ctx);
+
+private: // Provided Buffer Ring
+    void               InitBufferRing();
+    char*              GetRingBuffer(std::uint16_t bid);
+    void               RecycleBuffer(std::uint16_t bid);
+
+private: // Misc
+    Config&            config_     = Config::GetInstance();
+    Logger&            logger_     = Logger::GetInstance();
+    FileCache&         fileCache_  = FileCache::GetInstance();
+    BufferPool&        pool_       = BufferPool::GetInstance();
+
+    IpLimiter          ipLimiter_         = {pool_};
+    ReceiveCallback    onReceive_         = {};
+    CompletionCallback onAsyncCompletion_ = {};
+    std::atomic<bool>  running_           = true;
+    bool               useHttps_          = false;
+    std::uint32_t      zeroCopyThreshold_ = 0; // Plain sockets only, 0 = Disabled
+
+private: // Constexpr stuff
+    constexpr static char    CHUNK_END[]           = "0\r\n\r\n";
+    constexpr static ssize_t SWITCH_FILE_TO_STREAM = std::numeric_limits<ssize_t>::min();
+
+    constexpr static int INVOKE_TIMEOUT_COOLDOWN = 5; // In seconds
+    constexpr static int INVOKE_TIMEOUT_DELAY    = 1; // In seconds
+
+    constexpr static std::uint32_t MAX_SLOT_INDEX = (1u << 24) - 1; // 24 bits of 'user_data'
+
+private: // Timeout handler
+    TimerWheel              timerWheel_;
+    TimerHeap               timerHeap_          = {pool_};
+    SteadyClock::time_point startTime_          = SteadyClock::now();
+    int                     timeoutTimerFd_     = -1;
+    int                     asyncTimerFd_       = -1;
+    std::uint64_t           timeoutExpirations_ = 0; // |
+    std::uint64_t           asyncExpirations_   = 0; // |-> Read targets for the timerfd SQEs
+
+private: // IoUring + SSL
     int      listenFd_ = -1;
-    int      sqeBatch_ = 0;
-    io_uring ring_     = { 0 };
-
-private:
-    // Connection Context
-    std::unique_ptr<ConnectionContext[]> connections_;
-    std::unique_ptr<std::uint64_t[]>     connBitmap_;
-    // Connection Accept
-    std::unique_ptr<AcceptSlot[]>        acceptSlots_;
-    std::unique_ptr<std::uint64_t[]>     acceptBitmap_;
-    // Derived size
-    std::uint32_t connWords_      = 0;
-    std::uint32_t acceptWords_    = 0;
+    io_uring ring_     = {};
+    bool     ringInit_ = false;
+
+    std::unique_ptr<HttpWFXSSL> sslHandler_ = nullptr;
+
+private: // Provided Buffer Ring (shared by every plain connection for multishot recv)
+    constexpr static int BUFFER_GROUP_ID = 0;
+
+    io_uring_buf_ring*      bufRing_     = nullptr;
+    std::unique_ptr<char[]> bufRingMem_  = nullptr;
+    std::uint16_t           bufCount_    = 0;
+    std::uint32_t           bufSize_     = 0;
+    int                     bufMask_     = 0;
+
+private: // Connection Context
+    std::unique_ptr<ConnectionContext[]> connections_   = nullptr;
+    std::unique_ptr<UringSlot[]>         uringSlots_    = nullptr;
+    std::unique_ptr<std::uint64_t[]>     connBitmap_    = nullptr;
+    std::uint32_t                        connWords_     = 0;
+    std::uint32_t                        connSlots_     = 0;
+    std::uint32_t                        connLastIndex_ = 0;
+    std::vector<std::uint64_t>           pipelineQueue_;     // (generation << 32 | index) of connections with data waiting
+    std::unordered_map<std::uint32_t, std::string> stashSpill_; // Slot index -> Bytes that arrived after its stash filled up
 };
 
 } // namespace WFX::OSSpecific
 
 #endif // WFX_LINUX_IO_URING_CONNECTION_HPP
 
-#endif // WFX_LINUX_USE_IO_URING
\ No newline at end of file
+#endif // WFX_LINUX_USE_IO_URING
@@ -1,6 +1,7 @@
 #include "async_api.hpp"
 #include "utils/logger/logger.hpp"
 #include "http/connection/http_connection.hpp"
+#include "http/request/http_body_reader.hpp"
 
 namespace WFX::Shared {
 
@@ -35,6 +36,32 @@ const ASYNC_API_TABLE* GetAsyncAPIV1()
             return connHandler->RefreshAsyncTimer(cctx, delayMs);
         },
 
+        // vvv Streamed Request Body vvv
+        [](void* ctx, std::string_view* outChunk) { // ReadBodyChunk
+            auto& logger = Logger::GetInstance();
+
+            if(!ctx || !outChunk) {
+                logger.Warn("[AsyncApi]: 'ReadBodyChunk' recived null context or output");
+                return BodyReadState::FAILED;
+            }
+
+            return WFX::Http::HttpBodyReader::ReadChunk(
+                static_cast<ConnectionContext*>(ctx), __GlobalAsyncDataV1.connHandler, *outChunk
+            );
+        },
+        [](void* ctx, int* outFd, std::uint64_t* outSize) { // SpillBody
+            auto& logger = Logger::GetInstance();
+
+            if(!ctx || !outFd || !outSize) {
+                logger.Warn("[AsyncApi]: 'SpillBody' recived null context or output");
+                return BodyReadState::FAILED;
+            }
+
+            return WFX::Http::HttpBodyReader::Spill(
+                static_cast<ConnectionContext*>(ctx), __GlobalAsyncDataV1.connHandler, *outFd, *outSize
+            );
+        },
+
         // Version
         AsyncAPIVersion::V1
     };
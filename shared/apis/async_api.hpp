@@ -1,7 +1,10 @@
 #ifndef WFX_SHARED_ASYNC_API_HPP
 #define WFX_SHARED_ASYNC_API_HPP
 
+#include "http/common/http_route_common.hpp"
+
 #include <cstdint>
+#include <string_view>
 
 // Fwd declare stuff
 namespace WFX::Http {
@@ -23,12 +26,18 @@ struct AsyncAPIDataV1 {
 
 // vvv All aliases for clarity vvv
 using RegisterAsyncTimerFn = bool (*)(void*, std::uint32_t);
+using ReadBodyChunkFn      = BodyReadState (*)(void*, std::string_view*);
+using SpillBodyFn          = BodyReadState (*)(void*, int*, std::uint64_t*);
 
 // vvv API declarations vvv
 struct ASYNC_API_TABLE {
     // vvv Async Operations vvv
     RegisterAsyncTimerFn   RegisterAsyncTimer;
 
+    // vvv Streamed Request Body vvv
+    ReadBodyChunkFn        ReadBodyChunk;
+    SpillBodyFn            SpillBody;
+
     // Metadata
     AsyncAPIVersion apiVersion;
 };
@@ -34,6 +34,14 @@ const HTTP_API_TABLE* GetHttpAPIV1()
             auto* node = __GlobalHttpDataV1.router->RegisterRoute(method, path, std::move(cb));
             __GlobalHttpDataV1.middleware->RegisterPerRouteMiddleware(node, std::move(mwStack));
         },
+        [](HttpMethod method, std::string_view path, HttpMiddlewareStack mwStack, HttpCallbackType cb) { // RegisterStreamRoute
+            if(!__GlobalHttpDataV1.router || !__GlobalHttpDataV1.middleware)
+                Logger::GetInstance().Fatal("[HttpAPI]: Router or Middleware was nullptr for 'RegisterStreamRoute'");
+
+            auto* node = __GlobalHttpDataV1.router->RegisterRoute(method, path, std::move(cb), true);
+            if(!mwStack.empty())
+                __GlobalHttpDataV1.middleware->RegisterPerRouteMiddleware(node, std::move(mwStack));
+        },
         [](std::string_view prefix) {  // PushRoutePrefix
             if(!__GlobalHttpDataV1.router)
                 Logger::GetInstance().Fatal("[HttpAPI]: Router was nullptr for 'PushRoutePrefix'");
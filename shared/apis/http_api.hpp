@@ -35,6 +35,7 @@ struct HttpAPIDataV1 {
 // Routing
 using RegisterRouteFn         = void (*)(HttpMethod method, std::string_view path, HttpCallbackType callback);
 using RegisterRouteExFn       = void (*)(HttpMethod method, std::string_view path, HttpMiddlewareStack mwStack, HttpCallbackType callback);
+using RegisterStreamRouteFn   = void (*)(HttpMethod method, std::string_view path, HttpMiddlewareStack mwStack, HttpCallbackType callback);
 using PushRoutePrefixFn       = void (*)(std::string_view prefix);
 using PopRoutePrefixFn        = void (*)();
 
@@ -77,6 +78,7 @@ struct HTTP_API_TABLE {
     // Routing
     RegisterRouteFn         RegisterRoute;
     RegisterRouteExFn       RegisterRouteEx;
+    RegisterStreamRouteFn   RegisterStreamRoute;
     PushRoutePrefixFn       PushRoutePrefix;
     PopRoutePrefixFn        PopRoutePrefix;
 
@@ -0,0 +1,85 @@
+/*
+ * Build: g++ -std=c++20 -O2 -I. -Iinclude test/http_parser_test.cpp http/formatters/parser/http_parser.cpp
+ *        http/formatters/parser/http_scanner.cpp http/connection/http_connection.cpp http/headers/http_headers.cpp
+ *        http/request/http_body_reader.cpp utils/rw_buffer/rw_buffer.cpp utils/pool/buffer_pool.cpp utils/pool/arena.cpp
+ *        utils/fileops/filecache.cpp utils/fileops/filesystem.cpp utils/fileops/linux/filemanip.cpp
+ *        utils/logger/logger.cpp utils/crypt/string.cpp config/config.cpp -o http_parser_test
+ */
+
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cstring>
+
+#include "http/formatters/parser/http_parser.hpp"
+#include "config/config.hpp"
+
+using namespace WFX::Http;
+using namespace WFX::Utils;
+
+// Appends 'data' to read buffer as if recv just got it, then parses
+HttpParseState Feed(ConnectionContext& ctx, std::string_view data)
+{
+    ValidRegion region = ctx.rwBuffer.GetWritableReadRegion();
+    assert(region.len >= data.size());
+
+    std::memcpy(region.ptr, data.data(), data.size());
+    ctx.rwBuffer.AdvanceReadLength(static_cast<std::uint32_t>(data.size()));
+
+    return HttpParser::Parse(&ctx);
+}
+
+void RunExpectContinueTests()
+{
+    ConnectionContext ctx;
+    assert(ctx.rwBuffer.InitReadBuffer(4096));
+
+    const std::string head =
+        "POST /upload HTTP/1.1\r\n"
+        "Host: test\r\n"
+        "Content-Length: 11\r\n"
+        "Expect: 100-continue\r\n"
+        "\r\n";
+    const std::string next =
+        "GET /next HTTP/1.1\r\n"
+        "Host: test\r\n"
+        "\r\n";
+
+    // Head alone, client waits for 100 Continue
+    assert(Feed(ctx, head) == HttpParseState::PARSE_EXPECT_100);
+
+    // Body shows up in a second read, with a pipelined request right behind it
+    assert(Feed(ctx, "hello world" + next) == HttpParseState::PARSE_SUCCESS);
+    assert(ctx.requestInfo->body == "hello world");
+    assert(ctx.requestInfo->requestLength == head.size() + 11);
+
+    // Whatever comes after the body must be parsed as its own request, not as leftover body
+    assert(HttpParser::HasPipelinedRequest(&ctx));
+    ctx.ClearContext();
+    ctx.SetParseState(HttpParseState::PARSE_IDLE);
+
+    assert(HttpParser::Parse(&ctx) == HttpParseState::PARSE_SUCCESS);
+    assert(ctx.requestInfo->method == HttpMethod::GET);
+    assert(ctx.requestInfo->path == "/next");
+    assert(ctx.requestInfo->body.empty());
+    assert(ctx.requestInfo->requestLength == next.size());
+
+    ctx.ClearContext();
+    ctx.SetParseState(HttpParseState::PARSE_IDLE);
+
+    // Client didn't wait for 100 Continue and sent the body along with the head, nothing to continue
+    assert(Feed(ctx, head + "hello world") == HttpParseState::PARSE_SUCCESS);
+    assert(ctx.requestInfo->body == "hello world");
+
+    std::cout << "[PASS] Expect: 100-continue with Content-Length\n";
+}
+
+int main()
+{
+    BufferPool::GetInstance().Init(1024 * 64);
+
+    RunExpectContinueTests();
+
+    std::cout << "All HTTP parser tests passed\n";
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Build: g++ -std=c++20 -O2 -I. -Iinclude test/multipart_test.cpp utils/crypt/string.cpp -o multipart_test
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <cassert>
+
+#include "include/form/forms.hpp"
+
+static const auto UploadForm = Form::FormSchema{
+    "upload",
+    Form::Field("title", Form::Text{ .max = 64 }),
+    Form::Field("count", Form::Int{ .min = 0, .max = 100 })
+};
+
+using UploadFormSchema = std::remove_cvref_t<decltype(UploadForm)>;
+
+struct StringSink : Form::FileSink {
+    std::string field, fileName, contentType, data;
+    int         begins = 0, ends = 0;
+
+    bool OnFileBegin(const Form::FilePart& part) override
+    {
+        begins++;
+        field       = part.field;
+        fileName    = part.fileName;
+        contentType = part.contentType;
+        return true;
+    }
+
+    bool OnFileData(std::string_view chunk) override { data.append(chunk); return true; }
+    bool OnFileEnd()                        override { ends++; return true; }
+};
+
+void RunStringSearchTests()
+{
+    std::mt19937 rng(1);
+
+    for(int i = 0; i < 100000; i++) {
+        std::string haystack(rng() % 256, 'a'), needle(rng() % 16, 'a');
+        for(auto& c : haystack) c = "ab\r\n-"[rng() % 5];
+        for(auto& c : needle)   c = "ab\r\n-"[rng() % 5];
+
+        assert(WFX::Utils::StringSearch::Find(haystack, needle) == std::string_view{haystack}.find(needle));
+    }
+
+    std::cout << "[PASS] StringSearch (" << WFX::Utils::StringSearch::GetImplName() << ")\n";
+}
+
+void RunMultipartTests()
+{
+    const std::string boundary = "----WfxBoundary7MA4YWxkTrZu0gW";
+
+    // Random file data with a couple of almost-boundaries in it
+    std::mt19937 rng(7);
+    std::string  fileData;
+    for(int i = 0; i < 8000; i++)
+        fileData += static_cast<char>(rng() % 256);
+    fileData += "\r\n--" + boundary.substr(0, 10) + "\r\n--" + boundary.substr(0, boundary.size() - 1);
+
+    const std::string body =
+        "preamble\r\n--" + boundary + "\r\n"
+        "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+        "hello world\r\n--" + boundary + "\r\n"
+        "Content-Disposition: form-data; name=\"file\"; filename=\"a.bin\"\r\n"
+        "Content-Type: application/x-test\r\n\r\n" + fileData + "\r\n--" + boundary + "\r\n"
+        "content-disposition: form-data; name=count\r\n\r\n"
+        "42\r\n--" + boundary + "--\r\n";
+
+    const std::string contentType = "multipart/form-data; boundary=\"" + boundary + "\"";
+    assert(Form::GetMultipartBoundary(contentType) == boundary);
+
+    // In memory, text fields point into body
+    {
+        StringSink                   sink;
+        UploadFormSchema::CleanedType out;
+
+        assert(UploadForm.ParseMultipart(body, boundary, out, &sink) == Form::FormError::NONE);
+        assert(std::get<0>(out).value == "hello world" && std::get<1>(out).value == 42);
+        assert(std::get<0>(out).value.data() > body.data() && std::get<0>(out).value.data() < body.data() + body.size());
+        assert(sink.data == fileData && sink.fileName == "a.bin" && sink.contentType == "application/x-test");
+        assert(sink.begins == 1 && sink.ends == 1);
+
+        // File part without a sink
+        assert(UploadForm.ParseMultipart(body, boundary, out) == Form::FormError::SINK_FAILED);
+    }
+
+    // Streamed in pieces of every size, piece is trashed right after feeding it (buffer reuse)
+    for(std::size_t step : {1, 2, 3, 5, 31, 64, 1000, 100000}) {
+        StringSink                        sink;
+        UploadFormSchema::CleanedType     out;
+        UploadFormSchema::MultipartReader reader{UploadForm, boundary, &sink};
+
+        for(std::size_t pos = 0; pos < body.size(); pos += step) {
+            std::string piece = body.substr(pos, step);
+            assert(reader.Feed(piece) == Form::FormError::NONE);
+            piece.assign(piece.size(), '#');
+        }
+
+        assert(reader.Finish(out) == Form::FormError::NONE);
+        assert(std::get<0>(out).value == "hello world" && std::get<1>(out).value == 42);
+        assert(sink.data == fileData && sink.begins == 1 && sink.ends == 1);
+    }
+
+    // Broken ones
+    {
+        UploadFormSchema::CleanedType out;
+        StringSink                    sink;
+
+        const std::string unknown  = "--" + boundary + "\r\nContent-Disposition: form-data; name=\"x\"\r\n\r\n1\r\n--" + boundary + "--";
+        const std::string missing  = "--" + boundary + "\r\nContent-Disposition: form-data; name=\"title\"\r\n\r\nhi\r\n--" + boundary + "--";
+        const std::string noHeader = "--" + boundary + "\r\n\r\nhi\r\n--" + boundary + "--";
+
+        assert(UploadForm.ParseMultipart(std::string_view{body}.substr(0, body.size() - 10), boundary, out, &sink) == Form::FormError::MALFORMED);
+        assert(UploadForm.ParseMultipart(unknown, boundary, out)  == Form::FormError::MALFORMED);
+        assert(UploadForm.ParseMultipart(missing, boundary, out)  == Form::FormError::CLEAN_FAILED);
+        assert(UploadForm.ParseMultipart(noHeader, boundary, out) == Form::FormError::MALFORMED);
+        assert(UploadForm.ParseMultipart(body, "", out, &sink)    == Form::FormError::MALFORMED);
+    }
+
+    std::cout << "[PASS] Multipart\n";
+}
+
+int main()
+{
+    RunStringSearchTests();
+    RunMultipartTests();
+    return 0;
+}
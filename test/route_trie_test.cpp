@@ -0,0 +1,94 @@
+/*
+ * Build: g++ -std=c++20 -O2 -I. -Iinclude test/route_trie_test.cpp http/routing/route_segment.cpp http/routing/route_trie.cpp
+ *        http/routing/router.cpp utils/logger/logger.cpp utils/uuid/uuid.cpp utils/crypt/hash.cpp utils/crypt/string.cpp -o route_trie_test
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
+
+#include "http/routing/router.hpp"
+
+using namespace WFX::Http;
+
+// Only needed so 'SyncCallbackType' can be formed
+class Response {};
+
+static void Noop(HttpRequest&, Response) {}
+
+void RunRouteTrieTests()
+{
+    Router router;
+
+    const TrieNode* root     = router.RegisterRoute(HttpMethod::GET, "/", Noop);
+    const TrieNode* byId     = router.RegisterRoute(HttpMethod::GET, "/api/v2/users/<id:uint>", Noop);
+    const TrieNode* byName   = router.RegisterRoute(HttpMethod::GET, "/api/v2/users/<name:string>/posts", Noop);
+    const TrieNode* me       = router.RegisterRoute(HttpMethod::GET, "/api/v2/users/me", Noop);
+    const TrieNode* files    = router.RegisterRoute(HttpMethod::GET, "/files/*", Noop);
+    const TrieNode* intX     = router.RegisterRoute(HttpMethod::GET, "/a/<int>/x", Noop);
+    const TrieNode* intY     = router.RegisterRoute(HttpMethod::GET, "/a/<int>/y", Noop);
+
+    router.PushRouteGroup("/group");
+    const TrieNode* grouped  = router.RegisterRoute(HttpMethod::POST, "/sub", Noop);
+    router.PopRouteGroup();
+
+    const TrieNode* putId    = router.RegisterRoute(HttpMethod::PUT, "/api/v2/users/<id:uint>", Noop);
+    const TrieNode* headMe   = router.RegisterRoute(HttpMethod::HEAD, "/api/v2/users/me", Noop);
+    const TrieNode* post99   = router.RegisterRoute(HttpMethod::POST, "/api/v2/users/99", Noop);
+
+    // Route keys are views, so they have to outlive the router
+    std::vector<std::string> bulk;
+    for(int i = 0; i < 600; i++)
+        bulk.push_back("/bulk/r" + std::to_string(i));
+    for(auto& path : bulk)
+        router.RegisterRoute(HttpMethod::GET, path, Noop);
+
+    router.Freeze();
+
+    PathSegments params;
+    auto match = [&](HttpMethod method, std::string_view path) {
+        params.clear();
+        return router.MatchRoute(method, path, params);
+    };
+
+    assert(match(HttpMethod::GET, "/") == root);
+    assert(match(HttpMethod::GET, "/api/v2/users/42") == byId && std::get<std::uint64_t>(params[0]) == 42);
+    assert(match(HttpMethod::GET, "/api/v2/users/bob/posts") == byName && std::get<std::string_view>(params[0]) == "bob");
+    assert(match(HttpMethod::GET, "/api/v2/users/me") == me && params.empty());
+    assert(match(HttpMethod::GET, "/api/v2/users/me?page=1") == me);
+    assert(match(HttpMethod::GET, "/api/v2/users/me/") == me);      // Misses exact table, trie still gets it
+    assert(match(HttpMethod::GET, "/files/a/b/c") == files && std::get<std::string_view>(params[0]) == "a/b/c");
+    assert(match(HttpMethod::GET, "/a/-5/x") == intX && std::get<std::int64_t>(params[0]) == -5);
+    assert(match(HttpMethod::GET, "/a/-5/y") == intY && params.size() == 1);
+    assert(match(HttpMethod::POST, "/group/sub") == grouped);
+
+    assert(match(HttpMethod::GET, "/group/sub") == nullptr);
+    assert(match(HttpMethod::GET, "/api/v2") == nullptr);
+    assert(match(HttpMethod::GET, "/nope") == nullptr);
+
+    for(auto& path : bulk)
+        assert(match(HttpMethod::GET, path) != nullptr);
+    assert(match(HttpMethod::GET, "/bulk/r600") == nullptr);
+
+    // Methods
+    assert(match(HttpMethod::PUT, "/api/v2/users/7") == putId && std::get<std::uint64_t>(params[0]) == 7);
+    assert(match(HttpMethod::HEAD, "/api/v2/users/me") == headMe);
+    assert(match(HttpMethod::HEAD, "/api/v2/users/7") == byId);     // Falls back to GET
+    assert(match(HttpMethod::DELETE, "/api/v2/users/7") == nullptr);
+    assert(match(HttpMethod::POST, "/api/v2/users/99") == post99);
+
+    assert(router.GetAllowedMethods("/api/v2/users/7") == "GET, PUT, HEAD, OPTIONS");
+    assert(router.GetAllowedMethods("/group/sub?x=1") == "POST, OPTIONS");
+    assert(router.GetAllowedMethods("/nope").empty());
+    assert(router.GetAllowedMethods("/api/v2/users/me/") == "GET, HEAD, OPTIONS");
+    assert(router.GetAllowedMethods("/api/v2/users/99") == "GET, POST, PUT, HEAD, OPTIONS"); // Static for POST, param for GET / PUT
+
+    std::cout << "[PASS] RouteTrie\n";
+}
+
+int main()
+{
+    RunRouteTrieTests();
+    return 0;
+}
@@ -139,6 +139,27 @@ std::uint64_t Hasher::Fnv1aCaseInsensitive(std::string_view str) noexcept
     return Fnv1aCaseInsensitive(reinterpret_cast<const std::uint8_t*>(str.data()), str.size());
 }
 
+std::uint64_t Hasher::Fnv1a(const std::uint8_t* data, std::uint64_t len) noexcept
+{
+    constexpr std::uint64_t fnvPrime       = 1099511628211ULL;
+    constexpr std::uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+
+    std::uint64_t hash = fnvOffsetBasis;
+
+    const std::uint8_t* end = data + len;
+    while(data < end) {
+        hash ^= *data++;
+        hash *= fnvPrime;
+    }
+
+    return hash;
+}
+
+std::uint64_t Hasher::Fnv1a(std::string_view str) noexcept
+{
+    return Fnv1a(reinterpret_cast<const std::uint8_t*>(str.data()), str.size());
+}
+
 // vvv TRUE RANDOMIZER vvv
 RandomPool::RandomPool()
 {
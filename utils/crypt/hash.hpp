@@ -25,6 +25,9 @@ namespace Hasher {
 
     std::uint64_t Fnv1aCaseInsensitive(const std::uint8_t* data, std::uint64_t len) noexcept;
     std::uint64_t Fnv1aCaseInsensitive(std::string_view data)                       noexcept;
+
+    std::uint64_t Fnv1a(const std::uint8_t* data, std::uint64_t len) noexcept;
+    std::uint64_t Fnv1a(std::string_view data)                       noexcept;
 } // namespace Hasher
 
 // vvv TRUE RANDOMIZER vvv
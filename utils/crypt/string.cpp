@@ -2,6 +2,13 @@
 
 #include "utils/backport/string.hpp"
 #include <algorithm>
+#include <cstring>
+
+// Same deal as HttpScanner, SIMD paths are compiled per function with target attributes
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define WFX_STRING_X86 1
+    #include <immintrin.h>
+#endif
 
 namespace WFX::Utils {
 
@@ -196,4 +203,128 @@ bool StringCanonical::DecodePercentInplace(std::string_view& buf_) noexcept
     return true;
 }
 
+// vvv Substring Search vvv
+namespace {
+
+// 'last' is the last position a match can start at, so every candidate has all of needle in bounds
+const char* FindScalar(const char* p, const char* last, std::string_view needle) noexcept
+{
+    const char first = needle[0];
+
+    for(; p <= last; ++p) {
+        p = static_cast<const char*>(std::memchr(p, first, last - p + 1));
+        if(!p)
+            return nullptr;
+
+        if(std::memcmp(p + 1, needle.data() + 1, needle.size() - 1) == 0)
+            return p;
+    }
+    return nullptr;
+}
+
+#ifdef WFX_STRING_X86
+// Compares first and last byte of needle at every position in one go, only positions where both-
+// -hit get the full memcmp. Boundaries end in fairly random bytes so false hits are rare
+__attribute__((target("sse2")))
+const char* FindSSE2(const char* p, const char* last, std::string_view needle) noexcept
+{
+    const std::size_t n     = needle.size();
+    const __m128i     first = _mm_set1_epi8(needle[0]);
+    const __m128i     tail  = _mm_set1_epi8(needle[n - 1]);
+
+    for(; p + 15 <= last; p += 16) {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),         first);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - 1)), tail);
+
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_and_si128(a, b)));
+        while(mask) {
+            const char* candidate = p + __builtin_ctz(mask);
+            if(std::memcmp(candidate + 1, needle.data() + 1, n - 2) == 0)
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return FindScalar(p, last, needle);
+}
+
+__attribute__((target("avx2")))
+const char* FindAVX2(const char* p, const char* last, std::string_view needle) noexcept
+{
+    const std::size_t n     = needle.size();
+    const __m256i     first = _mm256_set1_epi8(needle[0]);
+    const __m256i     tail  = _mm256_set1_epi8(needle[n - 1]);
+
+    for(; p + 31 <= last; p += 32) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),         first);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + n - 1)), tail);
+
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(a, b)));
+        while(mask) {
+            const char* candidate = p + __builtin_ctz(mask);
+            if(std::memcmp(candidate + 1, needle.data() + 1, n - 2) == 0)
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return FindSSE2(p, last, needle);
+}
+#endif // WFX_STRING_X86
+
+struct SearchImpl {
+    const char* (*find)(const char*, const char*, std::string_view) noexcept = FindScalar;
+    const char* name                                                          = "scalar";
+};
+
+SearchImpl SelectSearchImpl() noexcept
+{
+    SearchImpl impl{};
+
+#ifdef WFX_STRING_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        impl.find = FindAVX2;
+        impl.name = "avx2";
+    }
+    else if(__builtin_cpu_supports("sse2")) {
+        impl.find = FindSSE2;
+        impl.name = "sse2";
+    }
+#endif
+
+    return impl;
+}
+
+const SearchImpl& GetSearchImpl() noexcept
+{
+    static const SearchImpl impl = SelectSearchImpl();
+    return impl;
+}
+
+} // namespace
+
+std::size_t StringSearch::Find(std::string_view haystack, std::string_view needle) noexcept
+{
+    if(needle.empty())
+        return 0;
+
+    if(needle.size() > haystack.size())
+        return std::string_view::npos;
+
+    // Vector paths compare first and last byte of needle, single byte ones just go to memchr
+    const char* last  = haystack.data() + (haystack.size() - needle.size());
+    const char* match = (needle.size() < 2)
+                            ? FindScalar(haystack.data(), last, needle)
+                            : GetSearchImpl().find(haystack.data(), last, needle);
+
+    return match ? static_cast<std::size_t>(match - haystack.data()) : std::string_view::npos;
+}
+
+const char* StringSearch::GetImplName() noexcept
+{
+    return GetSearchImpl().name;
+}
+
 } // namespace WFX::Utils
\ No newline at end of file
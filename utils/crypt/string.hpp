@@ -22,6 +22,15 @@ namespace StringCanonical {
     bool        DecodePercentInplace(std::string_view& buf)                               noexcept;
 } // namespace StringCanonical
 
+namespace StringSearch {
+    // Index of first occurrence of 'needle' in 'haystack' (npos if none), empty needle matches at 0
+    // Vectorized (AVX2 -> SSE2 -> Scalar, picked at runtime), meant for long needles like multipart boundaries
+    std::size_t Find(std::string_view haystack, std::string_view needle) noexcept;
+
+    // "avx2", "sse2" or "scalar", mostly for logs / benchmarks
+    const char* GetImplName() noexcept;
+} // namespace StringSearch
+
 } // namespace WFX::Utils
 
 
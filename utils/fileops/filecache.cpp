@@ -1,10 +1,12 @@
 #include "filecache.hpp"
+#include "filesystem.hpp"
 #include "utils/logger/logger.hpp"
 
 // For windows, filecache.hpp already includes windows.h anyways
 #ifdef _WIN32
     #define CloseFile(fd) CloseHandle(fd)
 #else
+    #include <sys/inotify.h>
     #include <sys/stat.h>
     #include <sys/resource.h>
     #include <fcntl.h>
@@ -14,9 +16,33 @@
 #endif
 
 #include <cassert>
+#include <chrono>
+#include <climits>
+#include <cstring>
 
 namespace WFX::Utils {
 
+// vvv Internal Helpers vvv
+namespace {
+
+// Watched entries never need a stat, their 'revalidateAt' is never reached
+constexpr std::int64_t NEVER_REVALIDATE = INT64_MAX;
+
+#ifndef _WIN32
+// Anything that can leave a different file (or different content / mtime) behind a path
+constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE
+                                   | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+#endif
+
+std::int64_t SteadyMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+} // namespace
+
 // vvv Constructor & Destructor vvvv
 FileCache& FileCache::GetInstance()
 {
@@ -26,16 +52,33 @@ FileCache& FileCache::GetInstance()
 
 FileCache::~FileCache()
 {
-    for(auto& pair : entries_)
-        CloseFile(pair.second.fd);
+    bool hadEntries = !index_.empty();
+
+    while(freqHead_)
+        Remove(freqHead_->tail);
+
+    while(spareNodes_) {
+        FreqNode* node = spareNodes_;
+        spareNodes_    = node->next;
+        delete node;
+    }
 
-    if(!entries_.empty())
+    // Process is going away, transfers still holding on to retired fds won't finish anyways
+    for(auto& [fd, users] : inUse_)
+        if(users.retired)
+            CloseFile(fd);
+
+#ifndef _WIN32
+    if(watchFd_ >= 0)
+        close(watchFd_);
+#endif
+
+    if(hadEntries)
         Logger::GetInstance().Info("[FileCache]: Closed all cached file descriptors successfully");
 }
 
 void FileCache::Init(std::size_t capacity)
 {
-    minFreq_ = 0;
     std::size_t safe = capacity;
 
 #ifndef _WIN32
@@ -44,21 +87,243 @@ void FileCache::Init(std::size_t capacity)
     if(getrlimit(RLIMIT_NOFILE, &rl) == 0)
         safe = rl.rlim_cur / 2;
 #endif
-    
+
     capacity_ = std::min(capacity, safe);
+    index_.reserve(capacity_);
 }
 
 // vvv User Functions vvv
 std::pair<WFXFileDescriptor, WFXFileSize> FileCache::GetFileDesc(const std::string& path)
 {
-    auto it = entries_.find(path);
-    if(it != entries_.end()) {
-        Touch(it->first);
-        return {it->second.fd, it->second.fileSize};
+    CacheEntry* entry = Acquire(path);
+    if(!entry)
+        return {WFX_INVALID_FILE, 0};
+
+    return {entry->fd, entry->fileSize};
+}
+
+bool FileCache::GetValidator(const std::string& path, FileValidator& out)
+{
+    CacheEntry* entry = Acquire(path);
+    if(!entry)
+        return false;
+
+    out = entry->validator;
+    return true;
+}
+
+std::uint8_t FileCache::GetSidecars(const std::string& path)
+{
+    CacheEntry* entry = Acquire(path);
+    if(!entry)
+        return FileSidecar::NONE;
+
+    if(entry->sidecars == FileSidecar::UNKNOWN)
+        entry->sidecars = ProbeSidecars(path);
+
+    return entry->sidecars;
+}
+
+std::uint8_t FileCache::ProbeSidecars(const std::string& path)
+{
+    std::uint8_t sidecars = FileSidecar::NONE;
+
+    if(FileSystem::FileExists((path + ".br").c_str()))
+        sidecars |= FileSidecar::BROTLI;
+    if(FileSystem::FileExists((path + ".gz").c_str()))
+        sidecars |= FileSidecar::GZIP;
+
+    return sidecars;
+}
+
+bool FileCache::StatValidator(const std::string& path, FileValidator& out)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if(!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+        return false;
+
+    std::int64_t ticks = (static_cast<std::int64_t>(info.ftLastWriteTime.dwHighDateTime) << 32)
+                       | info.ftLastWriteTime.dwLowDateTime;
+
+    // No file index without opening it, size + mtime has to do
+    out.size       = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    out.modifiedNs = (ticks - 116444736000000000LL) * 100;
+#else
+    struct stat st;
+    if(lstat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    out.inode      = static_cast<std::uint64_t>(st.st_ino);
+    out.size       = static_cast<std::uint64_t>(st.st_size);
+    out.modifiedNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000LL + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+void FileCache::Invalidate(std::string_view path)
+{
+    auto it = index_.find(path);
+    if(it != index_.end())
+        Remove(it->second);
+}
+
+// vvv Transfers vvv
+void FileCache::Retain(WFXFileDescriptor fd)
+{
+    inUse_[fd].transfers++;
+}
+
+void FileCache::Release(WFXFileDescriptor fd)
+{
+    auto it = inUse_.find(fd);
+    if(it == inUse_.end())
+        return;
+
+    FdUsers& users = it->second;
+    if(--users.transfers > 0)
+        return;
+
+    // Entry is long gone, this was the last one sending from it
+    if(users.retired)
+        CloseFile(fd);
+
+    inUse_.erase(it);
+}
+
+// vvv Change Notifications vvv
+bool FileCache::Watch(const std::string& dir)
+{
+#ifdef _WIN32
+    // No inotify, entries simply get revalidated every now and then
+    (void)dir;
+    return false;
+#else
+    auto& logger = Logger::GetInstance();
+
+    // Keys are built as '<dir>/<relative path>', so root has to be spelled the same way
+    std::string root = dir;
+    while(root.size() > 1 && root.back() == '/')
+        root.pop_back();
+
+    if(!FileSystem::DirectoryExists(root.c_str()))
+        return false;
+
+    if(watchFd_ < 0) {
+        watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(watchFd_ < 0) {
+            logger.Warn("[FileCache]: inotify unavailable, cached files will be revalidated periodically: ", strerror(errno));
+            return false;
+        }
+    }
+
+    AddWatch(root);
+
+    // inotify isn't recursive, every directory below needs a watch of its own
+    FileSystem::ListDirectory(root, true, [this](std::string path) {
+        if(FileSystem::DirectoryExists(path.c_str()))
+            AddWatch(path);
+    });
+
+    watchRoots_.push_back(std::move(root));
+    return true;
+#endif
+}
+
+int FileCache::GetWatchFd() const noexcept
+{
+    return watchFd_;
+}
+
+void FileCache::ProcessWatchEvents()
+{
+#ifndef _WIN32
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    while(true) {
+        ssize_t len = read(watchFd_, buffer, sizeof(buffer));
+        if(len <= 0)
+            break;
+
+        for(char* ptr = buffer; ptr < buffer + len;) {
+            auto* event = reinterpret_cast<inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            // Kernel dropped events, no telling what changed
+            if(event->mask & IN_Q_OVERFLOW) {
+                InvalidateAll();
+                continue;
+            }
+
+            auto it = watches_.find(event->wd);
+            if(it == watches_.end())
+                continue;
+
+            // Directory itself is gone, its watch went along with it
+            if(event->mask & IN_IGNORED) {
+                watches_.erase(it);
+                continue;
+            }
+
+            if(event->len == 0)
+                continue;
+
+            std::string path = it->second + '/' + event->name;
+
+            if(event->mask & IN_ISDIR) {
+                // New directory (or one moved in), files in it weren't watched till now
+                if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    AddWatch(path);
+                    FileSystem::ListDirectory(path, true, [this](std::string sub) {
+                        if(FileSystem::DirectoryExists(sub.c_str()))
+                            AddWatch(sub);
+                    });
+                }
+
+                InvalidateUnder(path);
+                continue;
+            }
+
+            Invalidate(path);
+            Notify(path);
+
+            // Sidecar showing up / going away changes what its original can be served as
+            if(path.ends_with(".br") || path.ends_with(".gz")) {
+                std::string_view original{path.data(), path.size() - 3};
+                Invalidate(original);
+                Notify(original);
+            }
+        }
+    }
+#endif
+}
+
+void FileCache::SetInvalidationListener(InvalidationListener listener)
+{
+    listener_ = std::move(listener);
+}
+
+// vvv Helper Functions vvv
+CacheEntry* FileCache::Acquire(const std::string& path)
+{
+    // Hit is a single probe, rest of it is pointer juggling
+    auto it = index_.find(path);
+    if(it != index_.end()) {
+        CacheEntry* entry = it->second;
+
+        if(entry->revalidateAt == NEVER_REVALIDATE || Revalidate(entry)) {
+            Touch(entry);
+            return entry;
+        }
+
+        // Replaced / modified behind our back, open whatever is there now
+        Remove(entry);
+        Notify(path);
     }
 
     WFXFileDescriptor fd   = 0;
     WFXFileSize       size = 0;
+    FileValidator     validator;
 
 #ifdef _WIN32
     fd = CreateFileA(
@@ -72,83 +337,277 @@ std::pair<WFXFileDescriptor, WFXFileSize> FileCache::GetFileDesc(const std::stri
     );
 
     if(fd == WFX_INVALID_FILE)
-        return {WFX_INVALID_FILE, 0};
+        return nullptr;
 
-    LARGE_INTEGER fsize;
-    if(!GetFileSizeEx(fd, &fsize)) {
+    BY_HANDLE_FILE_INFORMATION info;
+    if(!GetFileInformationByHandle(fd, &info)) {
         CloseHandle(fd);
-        return {WFX_INVALID_FILE, 0};
+        return nullptr;
     }
 
-    size = static_cast<std::uint64_t>(fsize.QuadPart);
+    size = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+
+    // FILETIME is 100ns ticks since 1601, move it over to unix epoch
+    std::int64_t ticks = (static_cast<std::int64_t>(info.ftLastWriteTime.dwHighDateTime) << 32)
+                       | info.ftLastWriteTime.dwLowDateTime;
+
+    validator.inode      = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    validator.modifiedNs = (ticks - 116444736000000000LL) * 100;
 #else
     fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
     if(fd < 0)
-        return {WFX_INVALID_FILE, 0};
+        return nullptr;
 
     struct stat st;
     if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
         close(fd);
-        return {WFX_INVALID_FILE, 0};
+        return nullptr;
     }
 
     size = st.st_size;
+
+    validator.inode      = static_cast<std::uint64_t>(st.st_ino);
+    validator.modifiedNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000LL + st.st_mtim.tv_nsec;
 #endif
 
-    Insert(path, fd, size);
-    return {fd, size};
+    validator.size = static_cast<std::uint64_t>(size);
+
+    return Insert(path, fd, size, validator);
 }
 
-// vvv Helper Functions vvv
-void FileCache::Touch(const std::string& key)
-{
-    auto &entry = entries_[key];
-    int oldFreq = entry.freq;
-    int newFreq = oldFreq + 1;
-    
-    entry.freq = newFreq;
-
-    // Remove from old bucket
-    freqBuckets_[oldFreq].erase(entry.bucketIter);
-    if(freqBuckets_[oldFreq].empty()) {
-        freqBuckets_.erase(oldFreq);
-        if(minFreq_ == oldFreq)
-            minFreq_ = newFreq;
+bool FileCache::Revalidate(CacheEntry* entry)
+{
+    std::int64_t now = SteadyMs();
+    if(now < entry->revalidateAt)
+        return true;
+
+    FileValidator current;
+    if(!StatValidator(entry->path, current))
+        return false;
+
+    const FileValidator& cached = entry->validator;
+
+#ifdef _WIN32
+    current.inode = cached.inode;
+#endif
+
+    if(current.inode != cached.inode || current.size != cached.size || current.modifiedNs != cached.modifiedNs)
+        return false;
+
+    entry->revalidateAt = now + REVALIDATE_INTERVAL_MS;
+    return true;
+}
+
+void FileCache::Touch(CacheEntry* entry)
+{
+    FreqNode* current = entry->bucket;
+    FreqNode* next    = current->next;
+
+    if(!next || next->freq != current->freq + 1) {
+        // Only one in its bucket, bumping the bucket itself keeps the order intact
+        if(current->head == entry && current->tail == entry) {
+            current->freq++;
+            return;
+        }
+
+        next = NewFreqNode(current->freq + 1, current);
     }
 
-    // Insert into new bucket at front (most recently used among same freq)
-    freqBuckets_[newFreq].push_front(key);
-    entry.bucketIter = freqBuckets_[newFreq].begin();
+    Unlink(entry);
+
+    // Front of new bucket (most recently used among same freq)
+    entry->bucket = next;
+    entry->prev   = nullptr;
+    entry->next   = next->head;
+
+    if(next->head)
+        next->head->prev = entry;
+    else
+        next->tail = entry;
+
+    next->head = entry;
+
+    if(!current->head)
+        DropFreqNode(current);
 }
 
-void FileCache::Insert(const std::string& key, WFXFileDescriptor fd, WFXFileSize size)
+CacheEntry* FileCache::Insert(const std::string& key, WFXFileDescriptor fd, WFXFileSize size, const FileValidator& validator)
 {
-    if(entries_.size() >= capacity_)
+    if(index_.size() >= capacity_ && freqHead_)
         Evict();
 
-    // Insert with freq = 1
-    freqBuckets_[1].push_front(key);
-    entries_[key] = {fd, 1, size, freqBuckets_[1].begin()};
-    minFreq_ = 1;
+    // New entries start at freq = 1, which is the lowest there is
+    FreqNode* bucket = (freqHead_ && freqHead_->freq == 1) ? freqHead_ : NewFreqNode(1, nullptr);
+
+    auto* entry = new CacheEntry{
+        key, fd, size, validator,
+        IsWatched(key) ? NEVER_REVALIDATE : SteadyMs() + REVALIDATE_INTERVAL_MS,
+        FileSidecar::UNKNOWN
+    };
+
+    entry->bucket = bucket;
+    entry->next   = bucket->head;
+
+    if(bucket->head)
+        bucket->head->prev = entry;
+    else
+        bucket->tail = entry;
+
+    bucket->head = entry;
+
+    // Key views into the entry's own copy of path, so path is stored exactly once
+    index_.emplace(entry->path, entry);
+    return entry;
 }
 
 void FileCache::Evict()
 {
-    assert(!freqBuckets_.empty());
+    assert(freqHead_ && freqHead_->tail);
 
-    // Evict from minFreq bucket, oldest entry (back of list)
-    auto &bucket = freqBuckets_[minFreq_];
-    std::string keyToEvict = bucket.back();
-    bucket.pop_back();
+    // Least frequently used bucket, oldest entry in it
+    Remove(freqHead_->tail);
+}
 
-    WFXFileDescriptor fd = entries_[keyToEvict].fd;
-    CloseFile(fd); // Close FD
+void FileCache::Remove(CacheEntry* entry)
+{
+    FreqNode* bucket = entry->bucket;
+
+    Unlink(entry);
+    if(!bucket->head)
+        DropFreqNode(bucket);
+
+    index_.erase(entry->path);
 
-    entries_.erase(keyToEvict);
+    // Someone might still be mid sendfile on it (evicted, or file changed while being downloaded)
+    // Last 'Release' closes it then
+    auto it = inUse_.find(entry->fd);
+    if(it != inUse_.end())
+        it->second.retired = true;
+    else
+        CloseFile(entry->fd);
+
+    delete entry;
+}
 
-    // minFreq_ will be reset on next insertion
-    if(bucket.empty())
-        freqBuckets_.erase(minFreq_);
+// vvv Frequency List vvv
+FreqNode* FileCache::NewFreqNode(std::uint64_t freq, FreqNode* after)
+{
+    FreqNode* node = spareNodes_;
+    if(node)
+        spareNodes_ = node->next;
+    else
+        node = new FreqNode{};
+
+    *node      = FreqNode{};
+    node->freq = freq;
+
+    // 'after' being nullptr means it becomes the new head
+    node->prev = after;
+    node->next = after ? after->next : freqHead_;
+
+    if(node->next)
+        node->next->prev = node;
+
+    if(after)
+        after->next = node;
+    else
+        freqHead_ = node;
+
+    return node;
+}
+
+void FileCache::DropFreqNode(FreqNode* node)
+{
+    if(node->prev)
+        node->prev->next = node->next;
+    else
+        freqHead_ = node->next;
+
+    if(node->next)
+        node->next->prev = node->prev;
+
+    node->next  = spareNodes_;
+    spareNodes_ = node;
+}
+
+void FileCache::Unlink(CacheEntry* entry)
+{
+    FreqNode* bucket = entry->bucket;
+
+    if(entry->prev)
+        entry->prev->next = entry->next;
+    else
+        bucket->head = entry->next;
+
+    if(entry->next)
+        entry->next->prev = entry->prev;
+    else
+        bucket->tail = entry->prev;
+
+    entry->prev = nullptr;
+    entry->next = nullptr;
+}
+
+// vvv Watching vvv
+bool FileCache::IsWatched(std::string_view path) const noexcept
+{
+    for(const auto& root : watchRoots_)
+        if(path.size() > root.size() && path.starts_with(root) && path[root.size()] == '/')
+            return true;
+
+    return false;
+}
+
+void FileCache::AddWatch(const std::string& dir)
+{
+#ifndef _WIN32
+    int wd = inotify_add_watch(watchFd_, dir.c_str(), WATCH_MASK);
+    if(wd < 0) {
+        Logger::GetInstance().Warn("[FileCache]: Failed to watch '", dir, "': ", strerror(errno));
+        return;
+    }
+
+    // Same directory added twice gives back the same wd, map just gets overwritten
+    watches_[wd] = dir;
+#else
+    (void)dir;
+#endif
+}
+
+void FileCache::InvalidateUnder(std::string_view dir)
+{
+    // Whole directory moved / removed, rare enough that a full walk is fine
+    for(FreqNode* node = freqHead_; node;) {
+        FreqNode*   nextNode = node->next;
+        CacheEntry* entry    = node->head;
+
+        while(entry) {
+            CacheEntry*      nextEntry = entry->next;
+            std::string_view path      = entry->path;
+
+            if(path.size() > dir.size() && path.starts_with(dir) && path[dir.size()] == '/')
+                Remove(entry);
+
+            entry = nextEntry;
+        }
+        node = nextNode;
+    }
+
+    Notify({});
+}
+
+void FileCache::InvalidateAll()
+{
+    while(freqHead_)
+        Remove(freqHead_->tail);
+
+    Notify({});
+}
+
+void FileCache::Notify(std::string_view path)
+{
+    if(listener_)
+        listener_(path);
 }
 
 } // namespace WFX::Utils
\ No newline at end of file
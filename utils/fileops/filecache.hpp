@@ -2,20 +2,64 @@
 #define WFX_UTILS_FILE_CACHE_HPP
 
 #include "utils/common/file.hpp"
-#include <list>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <cstdint>
 
 namespace WFX::Utils {
 
+// What cache validators (ETag / Last-Modified) of a file are built from, grabbed once when its-
+// -fd is opened so revalidating a cached file never needs a stat
+struct FileValidator {
+    std::uint64_t inode      = 0;
+    std::uint64_t size       = 0;
+    std::int64_t  modifiedNs = 0; // Last modification time (In nanoseconds)
+};
+
+// Precompressed copies of a file sitting right next to it ('foo.js.br', 'foo.js.gz')
+namespace FileSidecar {
+    constexpr std::uint8_t NONE    = 0;
+    constexpr std::uint8_t BROTLI  = 1 << 0;
+    constexpr std::uint8_t GZIP    = 1 << 1;
+    constexpr std::uint8_t UNKNOWN = 1 << 7; // Not looked for yet
+} // namespace FileSidecar
+
+struct FreqNode;
+
 struct CacheEntry {
-    int           fd;                            // Actual file descriptor
-    std::uint64_t freq;                          // Access frequency
-    off_t         fileSize;                      // File size in bytes
-    std::list<std::string>::iterator bucketIter; // Position in the frequency bucket list
+    std::string       path;                          // Interned key, index views into this
+    WFXFileDescriptor fd;                            // Actual file descriptor
+    WFXFileSize       fileSize;                      // File size in bytes
+    FileValidator     validator;
+    std::int64_t      revalidateAt;                  // When to stat it again (steady ms), never if its watched
+    std::uint8_t      sidecars;                      // 'FileSidecar' bits, looked for on first use
+
+    // Intrusive links, entries with the same access frequency hang off the same 'FreqNode'
+    FreqNode*   bucket = nullptr;
+    CacheEntry* prev   = nullptr;
+    CacheEntry* next   = nullptr;
 };
 
+// One per distinct access frequency, kept in ascending order so the least frequently used-
+// -bucket is always the first one
+struct FreqNode {
+    std::uint64_t freq = 0;
+    FreqNode*     prev = nullptr;
+    FreqNode*     next = nullptr;
+    CacheEntry*   head = nullptr; // Most recently used among the same frequency
+    CacheEntry*   tail = nullptr; // Least recently used, first to go
+};
+
+// Path of a file which changed on disk, empty if pretty much anything might have changed
+using InvalidationListener = std::function<void(std::string_view path)>;
+
+// LFU cache of open fds (+ validators) of files we serve, O(1) for hits, inserts and evictions
+// Files under watched directories are dropped as soon as they change (inotify), rest of them-
+// -are re-stat'd at most once every 'REVALIDATE_INTERVAL_MS'
+// One per worker process, so no locking needed
 class FileCache final {
 public:
     static FileCache& GetInstance();
@@ -23,6 +67,44 @@ public:
 
 public:
     std::pair<WFXFileDescriptor, WFXFileSize> GetFileDesc(const std::string& path);
+    bool GetValidator(const std::string& path, FileValidator& out);
+
+    // 'FileSidecar' bits of sidecars which exist for 'path', only checked once per cached file
+    std::uint8_t GetSidecars(const std::string& path);
+    static std::uint8_t ProbeSidecars(const std::string& path);
+
+    // Drops cached entry of 'path' (if any), next access opens the file again
+    void Invalidate(std::string_view path);
+
+public: // Validation
+    // Files not covered by a watch are checked against disk at most this often
+    static constexpr std::int64_t REVALIDATE_INTERVAL_MS = 2000;
+
+    // Validators of whatever currently sits at 'path', without opening it (or following symlinks)
+    static bool StatValidator(const std::string& path, FileValidator& out);
+
+    // Changes to files under a watched directory reach the invalidation listener right away
+    bool IsWatched(std::string_view path) const noexcept;
+
+public: // Transfers
+    // fd handed out by this cache is about to be sent from (sendfile / splice / stream), it stays-
+    // -open until the matching 'Release' even if its entry gets evicted or invalidated meanwhile
+    // Only the Linux backends send out of cached fds, IOCP opens its own handle per transfer
+    void Retain(WFXFileDescriptor fd);
+    void Release(WFXFileDescriptor fd);
+
+public: // Change notifications
+    // Watches 'dir' and everything under it, files replaced in there are invalidated right away
+    // Must be called after fork, every worker needs its own watch. false if it can't be watched
+    bool Watch(const std::string& dir);
+
+    // fd connection backend polls for readability, calling 'ProcessWatchEvents' when it is
+    // -1 if nothing is being watched
+    int  GetWatchFd() const noexcept;
+    void ProcessWatchEvents();
+
+    // Called for every invalidated path, so stuff built on top of cached files can follow along
+    void SetInvalidationListener(InvalidationListener listener);
 
 private:
     FileCache() = default;
@@ -35,19 +117,47 @@ private:
     FileCache& operator=(FileCache&&)      = delete;
 
 private: // Helper Functions
-    void Touch(const std::string& key);
-    void Insert(const std::string& key, WFXFileDescriptor fd, WFXFileSize size);
-    void Evict();
+    CacheEntry* Acquire(const std::string& path); // Cached entry or a freshly opened one, nullptr on failure
+    bool        Revalidate(CacheEntry* entry);    // false if file changed since it was opened
+    void        Touch(CacheEntry* entry);
+    CacheEntry* Insert(const std::string& key, WFXFileDescriptor fd, WFXFileSize size, const FileValidator& validator);
+    void        Evict();
+    void        Remove(CacheEntry* entry);
+
+    // vvv Frequency list vvv
+    FreqNode* NewFreqNode(std::uint64_t freq, FreqNode* after);
+    void      DropFreqNode(FreqNode* node);
+    void      Unlink(CacheEntry* entry);
+
+    // vvv Watching vvv
+    void AddWatch(const std::string& dir);
+    void InvalidateUnder(std::string_view dir);
+    void InvalidateAll();
+    void Notify(std::string_view path);
 
 private:
-    std::size_t   capacity_;
-    std::uint64_t minFreq_;
+    std::size_t capacity_ = 0;
+
+    // Path (viewing into 'CacheEntry::path') -> Entry, the only lookup a hit does
+    std::unordered_map<std::string_view, CacheEntry*> index_;
+
+    // Ascending frequency, 'freqHead_' is the least frequently used bucket
+    FreqNode* freqHead_   = nullptr;
+    FreqNode* spareNodes_ = nullptr; // Unused nodes, so hits don't allocate
 
-    // Key -> CacheEntry
-    std::unordered_map<std::string, CacheEntry> entries_;
+    // Watch descriptor -> Directory path
+    int                                  watchFd_ = -1;
+    std::unordered_map<int, std::string> watches_;
+    std::vector<std::string>             watchRoots_;
+    InvalidationListener                 listener_;
 
-    // Frequency -> list of keys (for LFU eviction)
-    std::unordered_map<std::uint64_t, std::list<std::string>> freqBuckets_;
+    // fd -> Transfers still sending from it. Entries removed while their fd is in here only-
+    // -mark it retired, whoever releases it last closes it
+    struct FdUsers {
+        std::uint32_t transfers = 0;
+        bool          retired   = false;
+    };
+    std::unordered_map<WFXFileDescriptor, FdUsers> inUse_;
 };
 
 } // namespace WFX::Utils
@@ -1,4 +1,5 @@
 #include "filemanip.hpp"
+#include "utils/fileops/filecache.hpp"
 
 namespace WFX::Utils {
 
@@ -11,6 +12,16 @@ LinuxFile::~LinuxFile()
 
 void LinuxFile::Close()
 {
+    // Borrowed from 'FileCache', hand it back so cache closes it once nobody sends from it anymore
+    if(fd_ >= 0 && existing_ && cached_) {
+        FileCache::GetInstance().Release(fd_);
+        fd_       = -1;
+        size_     = 0;
+        existing_ = false;
+        cached_   = false;
+        return;
+    }
+
     // If u open from existing, u cannot close it like this
     if(fd_ >= 0 && !existing_) {
         ::close(fd_);
@@ -129,6 +140,10 @@ void LinuxFile::OpenExisting(int fd, std::size_t size, bool cached)
     existing_ = true;
     cached_   = cached;
     size_     = size;
+
+    // Cache might evict / invalidate it while we are still reading, keep it open till 'Close'
+    if(cached_)
+        FileCache::GetInstance().Retain(fd_);
 }
 
 } // namespace WFX::Utils
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "arena.hpp"
+#include "buffer_pool.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace WFX::Utils {
+
+Arena::Arena(std::size_t blockSize) noexcept
+    : blockSize_(blockSize)
+{}
+
+Arena::~Arena()
+{
+    Release();
+}
+
+// vvv Allocators vvv
+void* Arena::Allocate(std::size_t size, std::size_t alignment)
+{
+    std::uintptr_t cursor  = reinterpret_cast<std::uintptr_t>(cursor_);
+    std::uintptr_t aligned = (cursor + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+
+    if(!head_ || aligned + size > reinterpret_cast<std::uintptr_t>(end_)) {
+        // Worst case padding goes in as well, so the new block surely fits it
+        AddBlock(size + alignment);
+
+        cursor  = reinterpret_cast<std::uintptr_t>(cursor_);
+        aligned = (cursor + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+    }
+
+    cursor_ = reinterpret_cast<char*>(aligned + size);
+    used_  += size;
+
+    return reinterpret_cast<void*>(aligned);
+}
+
+std::string_view Arena::CopyString(std::string_view str)
+{
+    if(str.empty())
+        return {};
+
+    char* dst = static_cast<char*>(Allocate(str.size(), 1));
+    std::memcpy(dst, str.data(), str.size());
+
+    return std::string_view(dst, str.size());
+}
+
+void Arena::Reset() noexcept
+{
+    if(!head_)
+        return;
+
+    // Keep only the first block, anything chained in front of it was for an unusually big request
+    while(head_->next) {
+        Block* next = head_->next;
+        ReleaseMemory(head_);
+        head_ = next;
+    }
+
+    // Same goes for first block if it was made for one huge allocation
+    if(head_->size > blockSize_) {
+        Release();
+        return;
+    }
+
+    cursor_ = reinterpret_cast<char*>(head_ + 1);
+    end_    = cursor_ + head_->size;
+    used_   = 0;
+}
+
+void Arena::Release() noexcept
+{
+    while(head_) {
+        Block* next = head_->next;
+        ReleaseMemory(head_);
+        head_ = next;
+    }
+
+    cursor_ = nullptr;
+    end_    = nullptr;
+    used_   = 0;
+}
+
+// vvv std::pmr::memory_resource vvv
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    return Allocate(bytes, alignment);
+}
+
+// vvv Helper Functions vvv
+void Arena::AddBlock(std::size_t minSize)
+{
+    std::size_t size  = minSize > blockSize_ ? minSize : blockSize_;
+    Block*      block = static_cast<Block*>(LeaseMemory(sizeof(Block) + size));
+
+    if(!block)
+        throw std::bad_alloc();
+
+    block->next = head_;
+    block->size = size;
+
+    head_   = block;
+    cursor_ = reinterpret_cast<char*>(block + 1);
+    end_    = cursor_ + size;
+}
+
+void* Arena::LeaseMemory(std::size_t size)
+{
+    // Pool only exists inside of worker processes, anywhere else (master, tools) plain malloc does it
+    BufferPool& pool = BufferPool::GetInstance();
+    return pool.IsInitialized() ? pool.Lease(size) : std::malloc(size);
+}
+
+void Arena::ReleaseMemory(void* ptr)
+{
+    BufferPool& pool = BufferPool::GetInstance();
+    if(pool.IsInitialized())
+        pool.Release(ptr);
+    else
+        std::free(ptr);
+}
+
+} // namespace WFX::Utils
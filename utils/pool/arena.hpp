@@ -0,0 +1,75 @@
+#ifndef WFX_UTILS_ARENA_HPP
+#define WFX_UTILS_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace WFX::Utils {
+
+// Monotonic (bump) allocator, blocks are leased from 'BufferPool'
+// Nothing is freed one by one, 'Reset' drops everything at once but keeps the first block around-
+// -so an arena which is reset after every request never goes back to the pool in steady state
+// Also a std::pmr::memory_resource, so std::pmr containers can sit on top of it
+class Arena final : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 4096;
+
+public:
+    explicit Arena(std::size_t blockSize = DEFAULT_BLOCK_SIZE) noexcept;
+    ~Arena();
+
+public:
+    void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+    // Destructor of 'T' is never called, so keep it to stuff which doesn't own anything
+    template<typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        return ::new(Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copy of 'str' which lives as long as the arena (till next 'Reset')
+    std::string_view CopyString(std::string_view str);
+
+    // Everything handed out till now is invalid after these
+    void Reset() noexcept;   // Keeps first block for reuse
+    void Release() noexcept; // Gives every block back
+
+    std::size_t BytesUsed() const noexcept { return used_; }
+
+private: // std::pmr::memory_resource
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void  do_deallocate(void*, std::size_t, std::size_t) override {} // Monotonic, see 'Reset'
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct Block {
+        Block*      next;
+        std::size_t size; // Usable bytes right after this header
+    };
+
+    void  AddBlock(std::size_t minSize);
+    void* LeaseMemory(std::size_t size);
+    void  ReleaseMemory(void* ptr);
+
+    // No need for copy / move semantics, containers hold pointers to us
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&)                 = delete;
+    Arena& operator=(Arena&&)      = delete;
+
+private:
+    std::size_t blockSize_;
+    std::size_t used_   = 0;
+    Block*      head_   = nullptr; // Current block, older ones chained behind it (first block is last)
+    char*       cursor_ = nullptr;
+    char*       end_    = nullptr;
+};
+
+} // namespace WFX::Utils
+
+#endif // WFX_UTILS_ARENA_HPP
@@ -55,6 +55,9 @@ bool RWBuffer::InitWriteBuffer(std::uint32_t size)
     writeMeta->bufferSize    = size;
     writeMeta->dataLength    = 0;
     writeMeta->writtenLength = 0;
+    writeMeta->bodyLength    = 0;
+    writeMeta->bodyWritten   = 0;
+    writeMeta->bodyData      = nullptr;
 
     return true;
 }
@@ -74,17 +77,24 @@ void RWBuffer::ResetBuffer()
     }
 }
 
-void RWBuffer::ClearBuffer()
+void RWBuffer::ClearBuffer(std::uint32_t readConsumed)
 {
     auto* readMeta  = GetReadMeta();
     auto* writeMeta = GetWriteMeta();
 
-    if(readMeta)
-        readMeta->dataLength = 0;
+    if(readMeta) {
+        if(readConsumed > 0)
+            ConsumeReadData(readConsumed);
+        else
+            readMeta->dataLength = 0;
+    }
 
     if(writeMeta) {
         writeMeta->dataLength    = 0;
         writeMeta->writtenLength = 0;
+        writeMeta->bodyLength    = 0;
+        writeMeta->bodyWritten   = 0;
+        writeMeta->bodyData      = nullptr;
     }
 }
 
@@ -150,6 +160,16 @@ bool RWBuffer::GrowReadBuffer(std::uint32_t defaultSize, std::uint32_t maxSize)
     return true;
 }
 
+void RWBuffer::ReleaseReadBuffer()
+{
+    // Gives read buffer back to pool, next 'InitReadBuffer' leases a fresh one
+    // Useful for idle connections which don't need to hold onto memory
+    if(!readBuffer_) return;
+
+    BufferPool::GetInstance().Release(readBuffer_);
+    readBuffer_ = nullptr;
+}
+
 ValidRegion RWBuffer::GetWritableReadRegion() const noexcept
 {
     if(!readBuffer_) return {nullptr, 0};
@@ -180,6 +200,22 @@ void RWBuffer::AdvanceReadLength(std::uint32_t n) noexcept
     meta->dataLength = std::min(meta->dataLength + n, meta->bufferSize);
 }
 
+void RWBuffer::ConsumeReadData(std::uint32_t n) noexcept
+{
+    if(!readBuffer_) return;
+
+    auto* meta = reinterpret_cast<ReadMetadata*>(readBuffer_);
+    if(n >= meta->dataLength) {
+        meta->dataLength = 0;
+        return;
+    }
+
+    // Whatever is left (next pipelined request mostly) moves to the front, its usually tiny
+    char* data = readBuffer_ + sizeof(ReadMetadata);
+    std::memmove(data, data + n, meta->dataLength - n);
+    meta->dataLength -= n;
+}
+
 void RWBuffer::AdvanceWriteLength(std::uint32_t n) noexcept
 {
     if(!writeBuffer_) return;
@@ -209,4 +245,45 @@ bool RWBuffer::AppendData(const char* data, std::uint32_t size)
     return true;
 }
 
+bool RWBuffer::AttachBody(const char* data, std::uint32_t size) noexcept
+{
+    if(!writeBuffer_ || !data || size == 0)
+        return false;
+
+    auto* meta = GetWriteMeta();
+
+    // Only one external body at a time, its always the last thing to go out
+    if(meta->bodyData)
+        return false;
+
+    meta->bodyData    = data;
+    meta->bodyLength  = size;
+    meta->bodyWritten = 0;
+    return true;
+}
+
+void RWBuffer::AdvanceGatherLength(std::size_t n) noexcept
+{
+    if(!writeBuffer_) return;
+
+    // Buffered data goes out first, whatever is left over is from the external body
+    auto* meta = reinterpret_cast<WriteMetadata*>(writeBuffer_);
+
+    std::uint32_t fromBuffer = static_cast<std::uint32_t>(
+        std::min<std::size_t>(n, meta->dataLength - meta->writtenLength)
+    );
+    meta->writtenLength += fromBuffer;
+
+    std::size_t fromBody = std::min<std::size_t>(n - fromBuffer, meta->bodyLength - meta->bodyWritten);
+    meta->bodyWritten += static_cast<std::uint32_t>(fromBody);
+}
+
+bool RWBuffer::HasPendingWrite() const noexcept
+{
+    if(!writeBuffer_) return false;
+
+    auto* meta = reinterpret_cast<WriteMetadata*>(writeBuffer_);
+    return meta->writtenLength < meta->dataLength || meta->bodyWritten < meta->bodyLength;
+}
+
 } // namespace WFX::Utils
\ No newline at end of file
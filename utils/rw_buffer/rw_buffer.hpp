@@ -10,6 +10,9 @@
 //
 // Write buffer is constant-sized
 // Read buffer is dynamically grown/shrunk
+//
+// Write side can also reference a body living outside of the write buffer, which gets-
+// -sent right after the buffered data (gather write) so large bodies never get copied
 
 namespace WFX::Utils {
 
@@ -24,6 +27,9 @@ struct alignas(8) WriteMetadata {
     std::uint32_t bufferSize    = 0;
     std::uint32_t dataLength    = 0;
     std::uint32_t writtenLength = 0;
+    std::uint32_t bodyLength    = 0;       // |
+    std::uint32_t bodyWritten   = 0;       // |
+    const char*   bodyData      = nullptr; // |-> External body, not owned by us (caller keeps it alive till its sent)
 };
 
 // For read buffer: includes buffer pool pointer
@@ -42,7 +48,8 @@ public: // Init / Reset
     bool InitReadBuffer(std::uint32_t size);
 
     void ResetBuffer();
-    void ClearBuffer();
+    // 'readConsumed' > 0 keeps whatever read data comes after it (pipelined requests)
+    void ClearBuffer(std::uint32_t readConsumed = 0);
 
 public: // Getter functions
     char*          GetWriteData()        const noexcept;
@@ -56,12 +63,17 @@ public: // Getter functions
 
 public: // Read buffer management
     bool        GrowReadBuffer(std::uint32_t defaultSize, std::uint32_t maxSize);
+    void        ReleaseReadBuffer();
     ValidRegion GetWritableReadRegion()       const noexcept;
     void        AdvanceReadLength(std::uint32_t n)  noexcept;
+    void        ConsumeReadData(std::uint32_t n)    noexcept;
     
 public: // Write buffer management
     bool        AppendData(const char* data, std::uint32_t size);
+    bool        AttachBody(const char* data, std::uint32_t size) noexcept;
     void        AdvanceWriteLength(std::uint32_t n) noexcept;
+    void        AdvanceGatherLength(std::size_t n)  noexcept;
+    bool        HasPendingWrite()             const noexcept;
     ValidRegion GetWritableWriteRegion()      const noexcept;
 
 private: